@@ -0,0 +1,220 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ObjectGrid.h"
+
+namespace Ida
+{
+    // What DECORS.CPP keeps of the decors of an exterior cube from one frame to the next:
+    //  - their display order of the last frame: the list of a frame is built in that order, so it is
+    //    nearly sorted and an insertion sort puts it back in order, far from the cost of a qsort. The order
+    //    is Zrot far to near, then the lowest index first (qsort left the ties in any order).
+    //  - the bounds of their bodies (a vertical cylinder around the hot point), to skip BodyDisplay() for
+    //    the decors out of the screen: only when every point of the body would project on a same side of
+    //    the clip window, so BodyDisplay() would have returned FALSE.
+    //  - the XZ grid of their ZVs (ObjectGrid), for the collision loops.
+    class DecorsCube
+    {
+    public:
+        // camera of AffichageObjetDecorsZBuf()
+        struct View
+        {
+            float mat[9];                   // MatriceWorld rotation
+            int32_t camx, camy, camz;       // CameraXr, CameraYr, CameraZr
+            float ratiox, ratioy;           // FRatioX, FRatioY
+            int32_t xcentre, ycentre;       // XCentre, YCentre
+            int32_t clipxmin, clipymin, clipxmax, clipymax;
+        };
+
+        explicit DecorsCube(int capacity = 0)
+        {
+            reset(capacity, 0);
+        }
+
+        // new cube of count decors: index order, bounds unknown, grid empty
+        void reset(int capacity, int count)
+        {
+            if (capacity != mGrid.capacity())
+            {
+                mGrid.reset(capacity);
+                mOrder.assign(capacity, 0);
+                mNext.assign(capacity, 0);
+                mMark.assign(capacity, 0);
+                mBounds.assign(capacity, Bounds());
+            }
+            else
+            {
+                mGrid.clear();
+            }
+
+            mCount = count;
+            for (int n = 0; n < count; n++)
+            {
+                mOrder[n] = (uint8_t)n;
+                mBounds[n] = Bounds();
+            }
+        }
+
+        int count() const
+        {
+            return mCount;
+        }
+
+        // the decors, the ones displayed last frame first, in their order
+        const uint8_t *order() const
+        {
+            return mOrder.data();
+        }
+
+        // list[0, nb) built in order(), with Zrot and Num: sorted far to near, then becomes the order
+        template <typename T>
+        void sort(T *list, int nb)
+        {
+            for (int n = 1; n < nb; n++)
+            {
+                T item = list[n];
+                int i = n;
+                for (; i > 0 && before(item, list[i - 1]); i--)
+                {
+                    list[i] = list[i - 1];
+                }
+                list[i] = item;
+            }
+
+            // displayed ones first, then the others in their previous order
+            memset(mMark.data(), 0, mCount);
+            for (int n = 0; n < nb; n++)
+            {
+                mMark[list[n].Num] = 1;
+            }
+            int count = 0;
+            for (int n = 0; n < nb; n++)
+            {
+                mNext[count++] = (uint8_t)list[n].Num;
+            }
+            for (int n = 0; n < mCount; n++)
+            {
+                if (!mMark[mOrder[n]])
+                {
+                    mNext[count++] = mOrder[n];
+                }
+            }
+            mOrder.swap(mNext);
+        }
+
+        bool hasBounds(int index) const
+        {
+            return mBounds[index].known;
+        }
+
+        // points of the body (X, Y, Z), around the hot point, turned by Beta only
+        template <typename P>
+        void setBounds(int index, const P *points, int nb)
+        {
+            Bounds &b = mBounds[index];
+            int32_t r2 = 0;
+            b.ymin = nb ? INT32_MAX : 0;
+            b.ymax = nb ? INT32_MIN : 0;
+            for (int n = 0; n < nb; n++)
+            {
+                int32_t x = points[n].X, y = points[n].Y, z = points[n].Z;
+                r2 = x * x + z * z > r2 ? x * x + z * z : r2;
+                b.ymin = y < b.ymin ? y : b.ymin;
+                b.ymax = y > b.ymax ? y : b.ymax;
+            }
+            b.radius = (int32_t)sqrt((double)r2) + 1;
+            b.known = true;
+        }
+
+        // the body of index at (x, y, z) can't reach the clip window of view
+        bool offScreen(const View &v, int index, int32_t x, int32_t y, int32_t z) const
+        {
+            const Bounds &b = mBounds[index];
+            if (!b.known)
+            {
+                return false;
+            }
+
+            // Xp = X * ratiox / zr + xcentre, Yp = Y * ratiox * ratioy / zr + ycentre: out of a side when
+            // a * X + b * zr < 0 for every point, points and position rounded by 2 at most
+            double rx = v.ratiox, ry = (double)v.ratiox * v.ratioy;
+            double edges[4] = {v.clipxmin - 1.0, v.clipxmax + 1.0, v.clipymin - 1.0, v.clipymax + 1.0};
+            double a[4], c[4], out[4];
+            for (int s = 0; s < 4; s++)
+            {
+                double sign = s & 1 ? -1.0 : 1.0;
+                a[s] = sign * (s >= 2 ? ry : rx);
+                c[s] = sign * ((s >= 2 ? v.ycentre : v.xcentre) - edges[s]);
+                out[s] = -1e300;
+            }
+
+            double zrmin = 1e300;
+            for (int k = 0; k < 8; k++)
+            {
+                double px = x + (k & 1 ? b.radius : -b.radius);
+                double py = y + (k & 2 ? b.ymax : b.ymin);
+                double pz = z + (k & 4 ? b.radius : -b.radius);
+
+                double X = px * v.mat[0] + py * v.mat[1] + pz * v.mat[2] - v.camx;
+                double Y = px * v.mat[3] + py * v.mat[4] + pz * v.mat[5] - v.camy;
+                double zr = v.camz - (px * v.mat[6] + py * v.mat[7] + pz * v.mat[8]);
+                zrmin = zr < zrmin ? zr : zrmin;
+
+                for (int s = 0; s < 4; s++)
+                {
+                    double d = a[s] * (s >= 2 ? Y : X) + c[s] * zr;
+                    out[s] = d > out[s] ? d : out[s];
+                }
+            }
+
+            // in front of the camera only: behind it the sides turn over
+            if (zrmin <= 4)
+            {
+                return false;
+            }
+
+            for (int s = 0; s < 4; s++)
+            {
+                if (out[s] + 2 * (fabs(a[s]) + fabs(c[s])) < 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        ObjectGrid &grid()
+        {
+            return mGrid;
+        }
+
+    private:
+        struct Bounds
+        {
+            bool known = false;
+            int32_t radius = 0, ymin = 0, ymax = 0;
+        };
+
+        // far to near, then lowest index
+        template <typename T>
+        static bool before(const T &a, const T &b)
+        {
+            return a.Zrot != b.Zrot ? a.Zrot > b.Zrot : a.Num < b.Num;
+        }
+
+        int mCount = 0;
+        std::vector<uint8_t> mOrder;
+        std::vector<uint8_t> mNext;
+        std::vector<uint8_t> mMark;
+        std::vector<Bounds> mBounds;
+        ObjectGrid mGrid;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -0,0 +1,255 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cstdint>
+#include <vector>
+
+namespace Ida
+{
+    // Display order of the sorted objects of AffScene (SORT.CPP): elements [0, count) and "a before b"
+    // relations, kept as the list of the elements to display before each one (its preds, by index).
+    //
+    // The order is the one of the old bit matrix walk: from the first element not displayed yet, go to its
+    // first pred, then to the first pred of that one... the element without preds is displayed, and the
+    // walk starts again. That walk is kept on a stack between two displays: only the top changes, so the
+    // whole sort is a depth first walk, O(elements + relations).
+    //
+    // A walk coming back on one of its elements is a loop: the relation of the walk with the largest
+    // distance (the first one on ties) is removed, and the walk starts again from its pred, as before.
+    class DepthSort
+    {
+    public:
+        explicit DepthSort(int capacity = 0)
+        {
+            reset(capacity);
+        }
+
+        void reset(int capacity)
+        {
+            mCapacity = capacity;
+            mCount = 0;
+            mPreds.assign(capacity * capacity, 0);
+            mElems.assign(capacity, Elem());
+            mStack.assign(capacity, Level());
+        }
+
+        // every element removed
+        void clear()
+        {
+            mCount = 0;
+        }
+
+        int count() const
+        {
+            return mCount;
+        }
+
+        // new element, returns its index (capacity elements at most)
+        int add()
+        {
+            mElems[mCount] = Elem();
+            return mCount++;
+        }
+
+        // first must be displayed before second
+        void addBefore(int first, int second)
+        {
+            Elem &e = mElems[second];
+            int16_t *preds = &mPreds[second * mCapacity];
+
+            // lowest index first, elements are mostly added in order
+            int n = e.nbPreds++;
+            for (; n > 0 && preds[n - 1] > first; n--)
+            {
+                preds[n] = preds[n - 1];
+            }
+            preds[n] = (int16_t)first;
+        }
+
+        // elements to display before index, lowest first
+        int nbPreds(int index) const
+        {
+            return mElems[index].nbPreds;
+        }
+
+        const int16_t *preds(int index) const
+        {
+            return &mPreds[index * mCapacity];
+        }
+
+        // display(index) for every element, in order, stops when it returns true (and returns true)
+        // distance(after, before): how far the two elements are, a loop loses its farthest relation
+        template <typename Distance, typename Display>
+        bool sort(Distance distance, Display display)
+        {
+            mFirst = 0;
+            mDepth = 0;
+
+            for (int n = 0; n < mCount; n++)
+            {
+                int index = findFirst(distance);
+                mElems[index].present = false;
+
+                if (display(index))
+                {
+                    flush();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Elem
+        {
+            bool present = true;
+            bool walked = false;  // on the stack
+            int16_t nbPreds = 0;
+            int16_t firstPred = 0;  // the ones before are displayed or removed
+        };
+
+        // element of the walk, with the farthest relation walked to reach it
+        struct Level
+        {
+            int16_t index = 0;
+            int16_t bestAfter = -1;
+            int16_t bestBefore = -1;
+            int32_t bestDistance = -1;
+        };
+
+        // first pred of index not displayed yet, -1 if none
+        int firstPred(int index)
+        {
+            Elem &e = mElems[index];
+            const int16_t *preds = &mPreds[index * mCapacity];
+
+            while (e.firstPred < e.nbPreds && !mElems[preds[e.firstPred]].present)
+            {
+                e.firstPred++;
+            }
+            return e.firstPred < e.nbPreds ? preds[e.firstPred] : -1;
+        }
+
+        void removePred(int index, int pred)
+        {
+            Elem &e = mElems[index];
+            int16_t *preds = &mPreds[index * mCapacity];
+
+            for (int n = e.firstPred; n < e.nbPreds; n++)
+            {
+                if (preds[n] == pred)
+                {
+                    for (e.nbPreds--; n < e.nbPreds; n++)
+                    {
+                        preds[n] = preds[n + 1];
+                    }
+                    return;
+                }
+            }
+        }
+
+        void push(int index, int after, int32_t distance)
+        {
+            Level &l = mStack[mDepth];
+            l.index = (int16_t)index;
+
+            if (mDepth && distance > mStack[mDepth - 1].bestDistance)
+            {
+                l.bestAfter = (int16_t)after;
+                l.bestBefore = (int16_t)index;
+                l.bestDistance = distance;
+            }
+            else if (mDepth)
+            {
+                l.bestAfter = mStack[mDepth - 1].bestAfter;
+                l.bestBefore = mStack[mDepth - 1].bestBefore;
+                l.bestDistance = mStack[mDepth - 1].bestDistance;
+            }
+            else
+            {
+                l.bestAfter = l.bestBefore = -1;
+                l.bestDistance = -1;
+            }
+
+            mElems[index].walked = true;
+            mDepth++;
+        }
+
+        void flush()
+        {
+            while (mDepth)
+            {
+                mElems[mStack[--mDepth].index].walked = false;
+            }
+        }
+
+        template <typename Distance>
+        int findFirst(Distance distance)
+        {
+            bool restarted = false;
+
+            if (!mDepth)
+            {
+                while (!mElems[mFirst].present)
+                {
+                    mFirst++;
+                }
+                push(mFirst, -1, -1);
+            }
+
+            for (;;)
+            {
+                const Level &top = mStack[mDepth - 1];
+                int after = top.index;
+                int before = firstPred(after);
+
+                if (before < 0)
+                {
+                    mElems[after].walked = false;
+                    mDepth--;
+
+                    // the stack is the walk from the first element only if nothing was removed
+                    if (restarted)
+                    {
+                        flush();
+                    }
+                    return after;
+                }
+
+                int32_t d = distance(after, before);
+
+                if (!mElems[before].walked)
+                {
+                    push(before, after, d);
+                    continue;
+                }
+
+                // loop
+                int bestAfter = top.bestAfter;
+                int bestBefore = top.bestBefore;
+                if (d > top.bestDistance)
+                {
+                    bestAfter = after;
+                    bestBefore = before;
+                }
+
+                removePred(bestAfter, bestBefore);
+
+                flush();
+                push(bestBefore, -1, -1);
+                restarted = true;
+            }
+        }
+
+        int mCapacity = 0;
+        int mCount = 0;
+        int mFirst = 0;
+        int mDepth = 0;
+        std::vector<int16_t> mPreds;  // capacity preds for each element
+        std::vector<Elem> mElems;
+        std::vector<Level> mStack;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -0,0 +1,172 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Ida
+{
+    // What AffGrille (GRILLE.CPP) leaves behind for one camera position of an interior cube: the bricks drawn
+    // in the clip window of Log, and the bricks of each screen column that DrawOverBrick and co. mask over
+    // the sprites (NbBrickColon, ListBrickColon). The grid is always drawn on a cleared screen, so the same
+    // position gives the same layer as long as the grid and its bricks don't change.
+    struct GrilleKey
+    {
+        uint32_t generation;                              // of the grid (InitGrille, GRM incrusted or not)
+        int32_t startx, starty, startz;                   // StartXCube, StartYCube, StartZCube
+        int32_t clipxmin, clipymin, clipxmax, clipymax;   // where AffGraph can draw
+
+        bool operator==(const GrilleKey &k) const
+        {
+            return generation == k.generation && startx == k.startx && starty == k.starty &&
+                   startz == k.startz && clipxmin == k.clipxmin && clipymin == k.clipymin &&
+                   clipxmax == k.clipxmax && clipymax == k.clipymax;
+        }
+    };
+
+    // a block of the caller kept with the layer (the columns)
+    struct GrillePart
+    {
+        void *data;
+        size_t size;
+    };
+
+    class GrilleLayer
+    {
+    public:
+        // copies the clip window of screen (rows at offLine[y]) and the parts
+        void assign(const GrilleKey &key, const uint8_t *screen, const uint32_t *offLine, const GrillePart *parts,
+                    int nbParts)
+        {
+            mKey = key;
+            mValid = true;
+
+            int width = key.clipxmax - key.clipxmin + 1;
+            int height = key.clipymax - key.clipymin + 1;
+            mWidth = width > 0 && height > 0 ? width : 0;
+            mPixels.resize((size_t)mWidth * (mWidth ? height : 0));
+            for (int y = 0; mWidth && y < height; y++)
+            {
+                memcpy(&mPixels[(size_t)y * mWidth], screen + offLine[key.clipymin + y] + key.clipxmin, mWidth);
+            }
+
+            size_t size = 0;
+            for (int n = 0; n < nbParts; n++) size += parts[n].size;
+            mParts.resize(size);
+            size = 0;
+            for (int n = 0; n < nbParts; n++)
+            {
+                memcpy(mParts.data() + size, parts[n].data, parts[n].size);
+                size += parts[n].size;
+            }
+        }
+
+        // puts the layer back: the clip window of screen and the parts
+        void restore(uint8_t *screen, const uint32_t *offLine, const GrillePart *parts, int nbParts) const
+        {
+            for (size_t y = 0; mWidth && y < mPixels.size() / mWidth; y++)
+            {
+                memcpy(screen + offLine[mKey.clipymin + y] + mKey.clipxmin, &mPixels[y * mWidth], mWidth);
+            }
+
+            size_t size = 0;
+            for (int n = 0; n < nbParts; n++)
+            {
+                memcpy(parts[n].data, mParts.data() + size, parts[n].size);
+                size += parts[n].size;
+            }
+        }
+
+        bool is(const GrilleKey &key) const
+        {
+            return mValid && mKey == key;
+        }
+
+    private:
+        friend class GrilleCache;
+
+        GrilleKey mKey = {};
+        bool mValid = false;
+        int mWidth = 0;
+        uint32_t mLastUse = 0;
+        std::vector<uint8_t> mPixels;
+        std::vector<uint8_t> mParts;
+    };
+
+    // The layers of the last camera positions, so a full redraw at a position seen before (back from a
+    // menu, the camera going back and forth between two places) is a copy instead of the whole grid.
+    // The generation changes with the grid: the layers of the old one are never found again.
+    class GrilleCache
+    {
+    public:
+        explicit GrilleCache(int capacity) : mLayers(capacity) {}
+
+        // nullptr if the grid must be drawn
+        const GrilleLayer *find(const GrilleKey &key)
+        {
+            for (GrilleLayer &layer : mLayers)
+            {
+                if (layer.is(key))
+                {
+                    layer.mLastUse = ++mClock;
+                    mHits++;
+                    return &layer;
+                }
+            }
+            mMisses++;
+            return nullptr;
+        }
+
+        // keeps a freshly drawn layer in the least recently used slot
+        const GrilleLayer &insert(const GrilleKey &key, const uint8_t *screen, const uint32_t *offLine,
+                                  const GrillePart *parts, int nbParts)
+        {
+            GrilleLayer *slot = &mLayers[0];
+            for (GrilleLayer &layer : mLayers)
+            {
+                if (!layer.mValid || layer.mKey.generation != mGeneration)
+                {
+                    slot = &layer;
+                    break;
+                }
+                if (layer.mLastUse < slot->mLastUse) slot = &layer;
+            }
+
+            slot->assign(key, screen, offLine, parts, nbParts);
+            slot->mLastUse = ++mClock;
+            return *slot;
+        }
+
+        // the grid changed
+        void invalidate()
+        {
+            mGeneration++;
+        }
+
+        uint32_t generation() const
+        {
+            return mGeneration;
+        }
+
+        uint32_t hits() const
+        {
+            return mHits;
+        }
+
+        uint32_t misses() const
+        {
+            return mMisses;
+        }
+
+    private:
+        std::vector<GrilleLayer> mLayers;
+        uint32_t mGeneration = 0;
+        uint32_t mClock = 0;
+        uint32_t mHits = 0;
+        uint32_t mMisses = 0;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
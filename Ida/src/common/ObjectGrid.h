@@ -0,0 +1,182 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Ida
+{
+    // Broadphase of the object collisions and index of the scene zones: a uniform grid over the XZ boxes of
+    // objects [0, capacity). Each cell holds a bitset of the objects whose box touches it, a query ORs the
+    // bitsets of the cells under its box, so the candidates come out in ascending index order, the order of
+    // the old loops.
+    //
+    // Cell coordinates wrap around the table: far objects can share a cell, they are only extra
+    // candidates. Boxes are inclusive on both ends: every box overlapping the query box, even by a
+    // border, is returned. The caller still does the exact test.
+    class ObjectGrid
+    {
+    public:
+        static const int CellShift = 10;  // 1024, two bricks
+        static const int TableShift = 5;  // 32 x 32 cells, a whole exterior cube
+        static const int TableSize = 1 << TableShift;
+        static const int TableMask = TableSize - 1;
+
+        explicit ObjectGrid(int capacity = 0)
+        {
+            reset(capacity);
+        }
+
+        // every object removed
+        void reset(int capacity)
+        {
+            mCapacity = capacity;
+            mWords = (capacity + 31) / 32;
+            mCells.assign(TableSize * TableSize * mWords, 0);
+            mEntries.assign(capacity, Entry());
+            mResult.assign(mWords, 0);
+        }
+
+        // every object removed, without giving the memory back
+        void clear()
+        {
+            for (int index = 0; index < mCapacity; index++)
+            {
+                remove(index);
+            }
+        }
+
+        int capacity() const
+        {
+            return mCapacity;
+        }
+
+        // (re)places index on the box [x0, x1] x [z0, z1]
+        void insert(int index, int32_t x0, int32_t z0, int32_t x1, int32_t z1)
+        {
+            Entry e = range(x0, z0, x1, z1);
+            Entry &old = mEntries[index];
+
+            if (old.used && old.cx0 == e.cx0 && old.cz0 == e.cz0 && old.nx == e.nx && old.nz == e.nz)
+            {
+                return;  // same cells
+            }
+
+            remove(index);
+            e.used = true;
+            old = e;
+
+            uint32_t bit = 1u << (index & 31);
+            forCells(e, [&](uint32_t *cell) { cell[index >> 5] |= bit; });
+        }
+
+        void remove(int index)
+        {
+            Entry &e = mEntries[index];
+            if (!e.used)
+            {
+                return;
+            }
+
+            uint32_t bit = ~(1u << (index & 31));
+            forCells(e, [&](uint32_t *cell) { cell[index >> 5] &= bit; });
+            e.used = false;
+        }
+
+        // objects which may overlap the box [x0, x1] x [z0, z1], plus the nbAlways indexes of always
+        // (the ones not to be trusted to their cells), in ascending order without duplicates, written to out
+        // (capacity entries at most), returns their count
+        template <typename T, typename E = int>
+        int query(int32_t x0, int32_t z0, int32_t x1, int32_t z1, T *out, const E *always = nullptr,
+                  int nbAlways = 0)
+        {
+            uint32_t *result = mResult.data();
+            memset(result, 0, mWords * sizeof(uint32_t));
+
+            forCells(range(x0, z0, x1, z1), [&](const uint32_t *cell) {
+                for (int w = 0; w < mWords; w++)
+                {
+                    result[w] |= cell[w];
+                }
+            });
+
+            for (int n = 0; n < nbAlways; n++)
+            {
+                if (always[n] >= 0 && always[n] < mCapacity)
+                {
+                    result[always[n] >> 5] |= 1u << (always[n] & 31);
+                }
+            }
+
+            int count = 0;
+            for (int w = 0; w < mWords; w++)
+            {
+                for (uint32_t bits = result[w]; bits; bits &= bits - 1)
+                {
+                    out[count++] = (T)((w << 5) + lowestBit(bits));
+                }
+            }
+            return count;
+        }
+
+    private:
+        struct Entry
+        {
+            bool used = false;
+            int32_t cx0 = 0, cz0 = 0;  // first cell
+            int32_t nx = 0, nz = 0;    // cells covered, TableSize at most
+        };
+
+        static Entry range(int32_t x0, int32_t z0, int32_t x1, int32_t z1)
+        {
+            Entry e;
+            e.cx0 = x0 >> CellShift;
+            e.cz0 = z0 >> CellShift;
+
+            // a box of the table or more covers every cell
+            int64_t nx = (int64_t)(x1 >> CellShift) - e.cx0 + 1;
+            int64_t nz = (int64_t)(z1 >> CellShift) - e.cz0 + 1;
+            e.nx = nx < 1 ? 1 : nx > TableSize ? TableSize : (int32_t)nx;
+            e.nz = nz < 1 ? 1 : nz > TableSize ? TableSize : (int32_t)nz;
+            return e;
+        }
+
+        template <typename F>
+        void forCells(const Entry &e, F f)
+        {
+            for (int32_t z = 0; z < e.nz; z++)
+            {
+                int32_t row = ((e.cz0 + z) & TableMask) << TableShift;
+                for (int32_t x = 0; x < e.nx; x++)
+                {
+                    f(&mCells[(row + ((e.cx0 + x) & TableMask)) * mWords]);
+                }
+            }
+        }
+
+        static int lowestBit(uint32_t bits)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return (int)index;
+#else
+            return __builtin_ctz(bits);
+#endif
+        }
+
+        int mCapacity = 0;
+        int mWords = 0;
+        std::vector<uint32_t> mCells;  // TableSize * TableSize bitsets of mWords words
+        std::vector<Entry> mEntries;
+        std::vector<uint32_t> mResult;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -0,0 +1,255 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cstdint>
+#include <vector>
+
+namespace Ida
+{
+    // The dots of the pixel flows (FLOW.CPP), one array per field: flow slot s owns the dots
+    // [s * perSlot, s * perSlot + NbDot). The loops over a flow read and write whole arrays with no call
+    // and no branch the compiler can't turn into a select, so they vectorize. The results are the ones of
+    // the loops over S_ONE_DOT, 32 bits products wrapping like the x86 ones.
+    class FlowDots
+    {
+    public:
+        static const int32_t Dead = 0;     // DOT_DEAD
+        static const int32_t Display = 1;  // DOT_DISPLAY
+        static const int32_t Wait = 2;     // DOT_WAIT
+
+        FlowDots(int slots, int perSlot) : mPerSlot(perSlot)
+        {
+            int size = slots * perSlot;
+            mX.assign(size, 0);
+            mY.assign(size, 0);
+            mZ.assign(size, 0);
+            mVx.assign(size, 0);
+            mVy.assign(size, 0);
+            mVz.assign(size, 0);
+            mDelay.assign(size, 0);
+            mPoids.assign(size, 0);
+            mCouleur.assign(size, 0);
+            mMode.assign(size, (int32_t)Dead);
+        }
+
+        int first(int slot) const
+        {
+            return slot * mPerSlot;
+        }
+
+        // dots[0, nb) (X, Y, Z, Vx, Vy, Vz, Delay, Poids, Couleur, Mode) into index, index + 1...
+        template <typename D>
+        void load(int index, const D *dots, int nb)
+        {
+            for (int n = 0; n < nb; n++, index++)
+            {
+                mX[index] = dots[n].X;
+                mY[index] = dots[n].Y;
+                mZ[index] = dots[n].Z;
+                mVx[index] = dots[n].Vx;
+                mVy[index] = dots[n].Vy;
+                mVz[index] = dots[n].Vz;
+                mDelay[index] = dots[n].Delay;
+                mPoids[index] = dots[n].Poids;
+                mCouleur[index] = dots[n].Couleur;
+                mMode[index] = dots[n].Mode;
+            }
+        }
+
+        // the other way
+        template <typename D>
+        void store(int index, D *dots, int nb) const
+        {
+            for (int n = 0; n < nb; n++, index++)
+            {
+                dots[n].X = mX[index];
+                dots[n].Y = mY[index];
+                dots[n].Z = mZ[index];
+                dots[n].Vx = mVx[index];
+                dots[n].Vy = mVy[index];
+                dots[n].Vz = mVz[index];
+                dots[n].Delay = mDelay[index];
+                dots[n].Poids = mPoids[index];
+                dots[n].Couleur = mCouleur[index];
+                dots[n].Mode = mMode[index];
+            }
+        }
+
+        // a dot of CreateParticleFlow(), waiting to be thrown
+        void spawn(int index, int32_t vx, int32_t vy, int32_t vz, int32_t delay, int32_t poids, int32_t couleur)
+        {
+            mVx[index] = vx;
+            mVy[index] = vy;
+            mVz[index] = vz;
+            mDelay[index] = delay;
+            mPoids[index] = poids;
+            mCouleur[index] = couleur;
+            mMode[index] = Wait;
+        }
+
+        void place(int index, int32_t x, int32_t y, int32_t z)
+        {
+            mX[index] = x;
+            mY[index] = y;
+            mZ[index] = z;
+        }
+
+        void kill(int index, int nb)
+        {
+            for (int n = index; n < index + nb; n++)
+            {
+                mMode[n] = Dead;
+            }
+        }
+
+        // AnimParticleFlow() of the dots [index, index + nb) time ticks after the start of the flow, thrown
+        // from org, killed out of zv (xmin, ymin, zmin, xmax, ymax, zmax). False when they are all dead.
+        bool animate(int index, int nb, int32_t time, const int32_t org[3], const int32_t zv[6])
+        {
+            return animateDots(nb, time, org, zv, &mX[index], &mY[index], &mZ[index], &mMode[index], &mVx[index],
+                               &mVy[index], &mVz[index], &mDelay[index], &mPoids[index]);
+        }
+
+        // the displayed dots of [index, index + nb), packed in x, y, z, couleur. Returns their number.
+        int visible(int index, int nb, int32_t *x, int32_t *y, int32_t *z, int32_t *couleur) const
+        {
+            int count = 0;
+            for (int n = index; n < index + nb; n++)
+            {
+                x[count] = mX[n];
+                y[count] = mY[n];
+                z[count] = mZ[n];
+                couleur[count] = mCouleur[n];
+                count += mMode[n] == Display;
+            }
+            return count;
+        }
+
+    private:
+        // the loop of animate(), masks of 0 or -1 with & and | only: no short circuit. The arrays are separate:
+        // __restrict (MSVC, gcc, clang) on the parameters saves the run-time overlap tests.
+        static bool animateDots(int nb, int32_t time, const int32_t org[3], const int32_t zv[6],
+                                int32_t *__restrict x, int32_t *__restrict y, int32_t *__restrict z,
+                                int32_t *__restrict mode, const int32_t *__restrict vx, const int32_t *__restrict vy,
+                                const int32_t *__restrict vz, const int32_t *__restrict delay,
+                                const int32_t *__restrict poids)
+        {
+            const int32_t ox = org[0], oy = org[1], oz = org[2];
+            const int32_t xmin = zv[0], ymin = zv[1], zmin = zv[2], xmax = zv[3], ymax = zv[4], zmax = zv[5];
+            int32_t alive = 0;
+
+            for (int n = 0; n < nb; n++)
+            {
+                int32_t timew = (time - delay[n]) / 20;
+                int32_t X = (int32_t)((uint32_t)vx[n] * (uint32_t)timew + (uint32_t)ox);
+                int32_t fall = (int32_t)((uint32_t)poids[n] * (uint32_t)timew * (uint32_t)timew) / 20;
+                int32_t Y = (int32_t)((uint32_t)vy[n] * (uint32_t)timew + (uint32_t)oy - (uint32_t)fall);
+                int32_t Z = (int32_t)((uint32_t)vz[n] * (uint32_t)timew + (uint32_t)oz);
+
+                int32_t live = -(int32_t)(mode[n] != Dead);
+                int32_t started = -(int32_t)(time >= delay[n]);
+                int32_t inside = -(int32_t)((X >= xmin) & (X <= xmax) & (Y >= ymin) & (Y <= ymax) & (Z >= zmin) &
+                                            (Z <= zmax));
+                int32_t moved = live & started & inside;
+
+                x[n] = (X & moved) | (x[n] & ~moved);
+                y[n] = (Y & moved) | (y[n] & ~moved);
+                z[n] = (Z & moved) | (z[n] & ~moved);
+                mode[n] = (Display & moved) | (mode[n] & ~(live & started));
+                alive |= live & (~started | inside);
+            }
+            return alive != 0;
+        }
+
+        int mPerSlot;
+        std::vector<int32_t> mX, mY, mZ;
+        std::vector<int32_t> mVx, mVy, mVz;
+        std::vector<int32_t> mDelay, mPoids, mCouleur;
+        std::vector<int32_t> mMode;
+    };
+
+    // The rain drops (RAIN.CPP), one array per field. A falling drop is at (x, y, z) in the world with a
+    // null timer. A drop splashing on something has the timer of its impact, x its screen X (16 bits) and
+    // color (16 bits up), y its screen Y and z its depth.
+    class RainDrops
+    {
+    public:
+        explicit RainDrops(int count) : mX(count, 0), mY(count, 0), mZ(count, 0), mTimer(count, 0) {}
+
+        int count() const
+        {
+            return (int)mTimer.size();
+        }
+
+        // SetRainDrops(): the drops added are null, to be placed by InitOneRain()
+        void resize(int count)
+        {
+            mX.resize(count, 0);
+            mY.resize(count, 0);
+            mZ.resize(count, 0);
+            mTimer.resize(count, 0);
+        }
+
+        int32_t *x()
+        {
+            return mX.data();
+        }
+
+        int32_t *y()
+        {
+            return mY.data();
+        }
+
+        int32_t *z()
+        {
+            return mZ.data();
+        }
+
+        int32_t *timer()
+        {
+            return mTimer.data();
+        }
+
+        // GereRain(): the falling drops go down by delta, and half of it along X and Z
+        void fall(int32_t delta)
+        {
+            int32_t half = delta / 2;
+            for (int n = 0; n < count(); n++)
+            {
+                int32_t falling = mTimer[n] ? 0 : -1;
+                mX[n] += half & falling;
+                mZ[n] += half & falling;
+                mY[n] -= delta & falling;
+            }
+        }
+
+        // the falling drops above stop, in order, for AffRain() to project them at once: the points 2k and
+        // 2k + 1 get the top (x + dx, y + dy, z + dz) and the bottom (x, y, z) of the k-th. Returns the
+        // number of drops.
+        int gather(int32_t stop, int32_t dx, int32_t dy, int32_t dz, int32_t *px, int32_t *py, int32_t *pz) const
+        {
+            int count = 0;
+            for (int n = 0; n < (int)mTimer.size(); n++)
+            {
+                if (mTimer[n] || mY[n] <= stop)
+                {
+                    continue;
+                }
+                px[2 * count] = mX[n] + dx;
+                py[2 * count] = mY[n] + dy;
+                pz[2 * count] = mZ[n] + dz;
+                px[2 * count + 1] = mX[n];
+                py[2 * count + 1] = mY[n];
+                pz[2 * count + 1] = mZ[n];
+                count++;
+            }
+            return count;
+        }
+
+    private:
+        std::vector<int32_t> mX, mY, mZ, mTimer;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -0,0 +1,101 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace Ida
+{
+    // Fixed capacity ring for one producer thread and one consumer thread, no lock.
+    // The indices only grow: the producer publishes what it wrote with a release store of mHead,
+    // the consumer gives the room back with a release store of mTail.
+    // T must be trivially copyable (data is moved with memcpy).
+    template <typename T>
+    class SpscRingBuffer
+    {
+    public:
+        // capacity is rounded up to a power of two
+        explicit SpscRingBuffer(size_t capacity)
+        {
+            size_t size = 1;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            mBuffer.resize(size);
+            mMask = size - 1;
+        }
+
+        // producer thread: copies up to count elements, returns how many fit
+        size_t write(const T *data, size_t count)
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t tail = mTail.load(std::memory_order_acquire);
+
+            count = std::min(count, mBuffer.size() - (head - tail));
+            copyIn(head, data, count);
+
+            mHead.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        // consumer thread: copies up to count elements, returns how many were available
+        size_t read(T *data, size_t count)
+        {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            size_t head = mHead.load(std::memory_order_acquire);
+
+            count = std::min(count, head - tail);
+            copyOut(tail, data, count);
+
+            mTail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        // consumer thread (approximate from the producer side)
+        size_t size() const
+        {
+            return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const
+        {
+            return mBuffer.size();
+        }
+
+    private:
+        void copyIn(size_t index, const T *data, size_t count)
+        {
+            size_t start = index & mMask;
+            size_t first = std::min(count, mBuffer.size() - start);
+
+            memcpy(mBuffer.data() + start, data, first * sizeof(T));
+            memcpy(mBuffer.data(), data + first, (count - first) * sizeof(T));
+        }
+
+        void copyOut(size_t index, T *data, size_t count) const
+        {
+            size_t start = index & mMask;
+            size_t first = std::min(count, mBuffer.size() - start);
+
+            memcpy(data, mBuffer.data() + start, first * sizeof(T));
+            memcpy(data + first, mBuffer.data(), (count - first) * sizeof(T));
+        }
+
+        std::vector<T> mBuffer;
+        size_t mMask = 0;
+
+        // each index on its own cache line: the two threads don't fight over it
+        char mPad0[64];
+        std::atomic<size_t> mHead{0};  // written by the producer
+        char mPad1[64];
+        std::atomic<size_t> mTail{0};  // written by the consumer
+        char mPad2[64];
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
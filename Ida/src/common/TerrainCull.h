@@ -0,0 +1,237 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Ida
+{
+    // Squares of the terrain of a cube (AffichageTerrainZBuf, TERRAIN.CPP) which can't draw anything, found
+    // before the projection of their points.
+    //
+    // The 64 x 64 quads are split in a quadtree down to squares of 4 x 4 quads, each node with the box of
+    // its points (heights of MapSommetY). A quad draws nothing when the flags of its 4 points are all 32
+    // (behind NearClip), or none is 32 and they are all 0 (far or not projected) or out on a same side of
+    // the clip window. A node is rejected only when its box gives that for every point, whatever the
+    // roundings of LongWorldRotatePoint() and LongProjectPoint(): the planes are moved by the largest
+    // error. The image is the same, only the points and quads of the rejected squares are not computed.
+    class TerrainCull
+    {
+    public:
+        static const int SIDE = 64;     // NB_COTE
+        static const int LEAF = 4;      // quads per side of a square
+        static const int SQUARES = SIDE / LEAF;
+        static const int POINTS = SIDE + 1;
+        static const int STEP = 512;    // of the grid, in world units
+
+        // camera of AffichageTerrainZBuf()
+        struct View
+        {
+            float mat[9];                   // MatriceWorld rotation (LongWorldRotatePoint)
+            int32_t camx, camy, camz;       // CameraXr, CameraYr, CameraZr
+            float ratiox, ratioy;           // FRatioX, FRatioY
+            int32_t xcentre, ycentre;       // XCentre, YCentre
+            int32_t nearclip, zfar;         // NearClip, ClipZFar
+            int32_t clipxmin, clipymin, clipxmax, clipymax;
+        };
+
+        // heights of the 65 x 65 points, row by row (MapSommetY)
+        void build(const int16_t *heights)
+        {
+            for (int sz = 0; sz < SQUARES; sz++)
+            {
+                for (int sx = 0; sx < SQUARES; sx++)
+                {
+                    Node &node = mNodes[LEVEL_LEAVES + sz * SQUARES + sx];
+                    node.ymin = INT16_MAX;
+                    node.ymax = INT16_MIN;
+                    for (int z = sz * LEAF; z <= (sz + 1) * LEAF; z++)
+                    {
+                        for (int x = sx * LEAF; x <= (sx + 1) * LEAF; x++)
+                        {
+                            int16_t y = heights[z * POINTS + x];
+                            if (y < node.ymin) node.ymin = y;
+                            if (y > node.ymax) node.ymax = y;
+                        }
+                    }
+                }
+            }
+
+            // parents: the 4 children below
+            for (int level = LEVELS - 2, side = SQUARES / 2; level >= 0; level--, side /= 2)
+            {
+                for (int z = 0; z < side; z++)
+                {
+                    for (int x = 0; x < side; x++)
+                    {
+                        Node &node = mNodes[first(level) + z * side + x];
+                        node.ymin = INT16_MAX;
+                        node.ymax = INT16_MIN;
+                        for (int c = 0; c < 4; c++)
+                        {
+                            const Node &child =
+                                mNodes[first(level + 1) + (z * 2 + (c >> 1)) * side * 2 + x * 2 + (c & 1)];
+                            if (child.ymin < node.ymin) node.ymin = child.ymin;
+                            if (child.ymax > node.ymax) node.ymax = child.ymax;
+                        }
+                    }
+                }
+            }
+        }
+
+        // visible[SQUARES * SQUARES], row by row: 1 for the squares to draw. Returns their number.
+        int cull(const View &view, uint8_t *visible) const
+        {
+            Planes planes;
+            makePlanes(view, planes);
+            return walk(planes, 0, 0, 0, visible);
+        }
+
+        // needed[POINTS * POINTS]: 1 for the points of the visible squares
+        static void points(const uint8_t *visible, uint8_t *needed)
+        {
+            memset(needed, 0, POINTS * POINTS);
+            for (int sz = 0; sz < SQUARES; sz++)
+            {
+                for (int sx = 0; sx < SQUARES; sx++)
+                {
+                    if (!visible[sz * SQUARES + sx]) continue;
+                    for (int z = sz * LEAF; z <= (sz + 1) * LEAF; z++)
+                    {
+                        memset(&needed[z * POINTS + sx * LEAF], 1, LEAF + 1);
+                    }
+                }
+            }
+        }
+
+    private:
+        static const int LEVELS = 5;            // 1, 2, 4, 8, 16 nodes per side
+        static const int LEVEL_LEAVES = 85;     // first leaf: 1 + 4 + 16 + 64
+        static const int NODES = LEVEL_LEAVES + SQUARES * SQUARES;
+
+        enum
+        {
+            REJECT,
+            PARTIAL,
+            INSIDE
+        };
+
+        struct Node
+        {
+            int16_t ymin, ymax;
+        };
+
+        // a*X + b*zr of the camera space, with X = X0 - CameraXr (or Y), zr = CameraZr - Z0, and the error
+        // of the rounded points
+        struct Plane
+        {
+            double a, b, margin;
+            bool y;
+        };
+
+        struct Planes
+        {
+            View view;
+            Plane sides[4];     // < 0: out (left, right, top, bottom)
+        };
+
+        static int first(int level)
+        {
+            return ((1 << (2 * level)) - 1) / 3;
+        }
+
+        static void makePlanes(const View &v, Planes &p)
+        {
+            p.view = v;
+
+            // Xp = X * ratiox / zr + xcentre < ClipXMin  <=>  X * ratiox + (xcentre - ClipXMin) * zr < 0
+            // Yp = Y * ratiox * ratioy / zr + ycentre, then rounded (one more pixel)
+            double rx = v.ratiox, ry = (double)v.ratiox * v.ratioy;
+            double edges[4] = {v.clipxmin - 1.0, v.clipxmax + 1.0, v.clipymin - 1.0, v.clipymax + 1.0};
+            for (int s = 0; s < 4; s++)
+            {
+                double sign = s & 1 ? -1.0 : 1.0;
+                Plane &pl = p.sides[s];
+                pl.y = s >= 2;
+                pl.a = sign * (pl.y ? ry : rx);
+                pl.b = sign * ((pl.y ? v.ycentre : v.xcentre) - edges[s]);
+                pl.margin = fabs(pl.a) + fabs(pl.b) + 1.0;
+            }
+        }
+
+        int classify(const Planes &p, int level, int x, int z) const
+        {
+            const View &v = p.view;
+            const Node &node = mNodes[first(level) + z * (1 << level) + x];
+            int size = (SIDE >> level) * STEP;
+            double wx = (double)x * size, wz = (double)z * size;
+
+            double zrmin = 1e300, zrmax = -1e300, out[4] = {-1e300, -1e300, -1e300, -1e300};
+            double in[4] = {1e300, 1e300, 1e300, 1e300};
+            for (int c = 0; c < 8; c++)
+            {
+                double px = wx + (c & 1 ? size : 0);
+                double py = c & 2 ? node.ymax : node.ymin;
+                double pz = wz + (c & 4 ? size : 0);
+
+                double X = px * v.mat[0] + py * v.mat[1] + pz * v.mat[2] - v.camx;
+                double Y = px * v.mat[3] + py * v.mat[4] + pz * v.mat[5] - v.camy;
+                double zr = v.camz - (px * v.mat[6] + py * v.mat[7] + pz * v.mat[8]);
+
+                zrmin = zr < zrmin ? zr : zrmin;
+                zrmax = zr > zrmax ? zr : zrmax;
+                for (int s = 0; s < 4; s++)
+                {
+                    const Plane &pl = p.sides[s];
+                    double d = pl.a * (pl.y ? Y : X) + pl.b * zr;
+                    out[s] = d > out[s] ? d : out[s];
+                    in[s] = d < in[s] ? d : in[s];
+                }
+            }
+
+            // all the points behind NearClip: flags 32
+            if (zrmax + 2 <= v.nearclip) return REJECT;
+
+            // none behind NearClip and all far (flags 0), or all out on a side
+            if (zrmin - 2 <= v.nearclip) return PARTIAL;
+            if (zrmin - 2 >= v.zfar) return REJECT;
+
+            bool inside = zrmax + 2 < v.zfar;
+            for (int s = 0; s < 4; s++)
+            {
+                const Plane &pl = p.sides[s];
+                if (out[s] + pl.margin < 0) return REJECT;
+                inside = inside && in[s] - pl.margin > 0;
+            }
+            return inside ? INSIDE : PARTIAL;
+        }
+
+        int walk(const Planes &p, int level, int x, int z, uint8_t *visible) const
+        {
+            int state = classify(p, level, x, z);
+            int span = SQUARES >> level;
+
+            if (state == PARTIAL && level < LEVELS - 1)
+            {
+                int nb = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    nb += walk(p, level + 1, x * 2 + (c & 1), z * 2 + (c >> 1), visible);
+                }
+                return nb;
+            }
+
+            for (int sz = z * span; sz < (z + 1) * span; sz++)
+            {
+                memset(&visible[sz * SQUARES + x * span], state != REJECT, span);
+            }
+            return state != REJECT ? span * span : 0;
+        }
+
+        Node mNodes[NODES];
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -0,0 +1,144 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Ida
+{
+    // One text file of TEXT.HQR (sys, cre, gam, one per island) for one language: the order block
+    // (text id of each text) and the text block (U16 offsets, then the texts), as loaded by InitDial.
+    // The id -> text number table is built once, a lookup is one array read instead of a scan.
+    class TextBank
+    {
+    public:
+        void assign(int language, int file, const uint16_t *order, int count, const uint8_t *text, size_t size)
+        {
+            mLanguage = language;
+            mFile = file;
+            mOrder.assign(order, order + count);
+            mText.assign(text, text + size);
+
+            mMaxId = -1;
+            for (uint16_t id : mOrder)
+            {
+                if (id > mMaxId) mMaxId = id;
+            }
+
+            // first text of an id wins, like the scan did
+            mIndex.assign(mMaxId + 1, -1);
+            for (int num = count - 1; num >= 0; num--)
+            {
+                mIndex[mOrder[num]] = (int16_t)num;
+            }
+        }
+
+        // text number of id, -1 if the file doesn't have it
+        int find(int id) const
+        {
+            return id >= 0 && id <= mMaxId ? mIndex[id] : -1;
+        }
+
+        int maxId() const
+        {
+            return mMaxId;
+        }
+
+        int count() const
+        {
+            return (int)mOrder.size();
+        }
+
+        const std::vector<uint16_t> &order() const
+        {
+            return mOrder;
+        }
+
+        const std::vector<uint8_t> &text() const
+        {
+            return mText;
+        }
+
+        bool is(int language, int file) const
+        {
+            return mLanguage == language && mFile == file;
+        }
+
+    private:
+        friend class TextBankCache;
+
+        int mLanguage = -1;
+        int mFile = -1;
+        int mMaxId = -1;
+        uint32_t mLastUse = 0;
+        std::vector<uint16_t> mOrder;
+        std::vector<uint8_t> mText;
+        std::vector<int16_t> mIndex;
+    };
+
+    // The last text banks used, so going back to a file (sys, gam, the island) doesn't reload it.
+    // Banks live in fixed slots: a pointer stays valid until its slot is given to another file.
+    class TextBankCache
+    {
+    public:
+        explicit TextBankCache(int capacity) : mBanks(capacity) {}
+
+        // nullptr if the bank must be loaded
+        TextBank *find(int language, int file)
+        {
+            for (TextBank &bank : mBanks)
+            {
+                if (bank.is(language, file))
+                {
+                    bank.mLastUse = ++mClock;
+                    mHits++;
+                    return &bank;
+                }
+            }
+            mMisses++;
+            return nullptr;
+        }
+
+        // keeps a freshly loaded bank in the least recently used slot
+        TextBank &insert(int language, int file, const uint16_t *order, int count, const uint8_t *text, size_t size)
+        {
+            TextBank *slot = &mBanks[0];
+            for (TextBank &bank : mBanks)
+            {
+                if (bank.mLastUse < slot->mLastUse) slot = &bank;
+            }
+
+            slot->assign(language, file, order, count, text, size);
+            slot->mLastUse = ++mClock;
+            return *slot;
+        }
+
+        void clear()
+        {
+            for (TextBank &bank : mBanks)
+            {
+                bank = TextBank();
+            }
+        }
+
+        uint32_t hits() const
+        {
+            return mHits;
+        }
+
+        uint32_t misses() const
+        {
+            return mMisses;
+        }
+
+    private:
+        std::vector<TextBank> mBanks;
+        uint32_t mClock = 0;
+        uint32_t mHits = 0;
+        uint32_t mMisses = 0;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
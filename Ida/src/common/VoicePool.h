@@ -0,0 +1,330 @@
+#pragma once
+
+#pragma pack(push, 8)
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Ida
+{
+    // Bookkeeping of a fixed set of voices [0, capacity) for the sample player: free voices on a stack,
+    // the voices of each user number chained from a hash table, and the voices in use kept per steal class
+    // in play order. Everything is O(1) but the walks over the voices in use, and nothing is allocated
+    // after reset(): the hash table is open addressing over a fixed array.
+    //
+    // When all the voices are busy, victim() is the oldest voice of the lowest class in use.
+    //
+    // Voices ending on another thread (the mixer) are reported with finished(), lock and allocation free:
+    // the serial goes to the slot of the voice. The owner thread releases them in collect(). Each
+    // allocation gets a new serial: a late report about a voice already stopped and reused by the owner
+    // is ignored.
+    class VoicePool
+    {
+    public:
+        static const int None = -1;
+        static const int MaxCapacity = 256;
+
+        explicit VoicePool(int capacity = 0, int classes = 1)
+        {
+            reset(capacity, classes);
+        }
+
+        // all voices free, pending reports dropped; not while finished() may be called
+        void reset(int capacity, int classes)
+        {
+            if (capacity > MaxCapacity)
+            {
+                capacity = MaxCapacity;
+            }
+
+            mVoices.assign(capacity, Voice());
+            mClasses.assign(classes, List());
+
+            // at most a quarter full: a probe seldom goes past its first slot
+            int size = 1;
+            mUserShift = 32;
+            while (size < capacity * 4)
+            {
+                size *= 2;
+                mUserShift--;
+            }
+            mUsers.assign(size, User());
+            mUserMask = size - 1;
+
+            mFree.resize(capacity);
+            for (int n = 0; n < capacity; n++)
+            {
+                mFree[n] = capacity - 1 - n;  // voice 0 first
+            }
+            mNbFree = capacity;
+
+            mEnded.reset(new std::atomic<uint32_t>[capacity]);
+            for (int n = 0; n < capacity; n++)
+            {
+                mEnded[n].store(0, std::memory_order_relaxed);
+            }
+            mNbPending = (capacity + 63) / 64;
+            for (std::atomic<uint64_t> &word : mPending)
+            {
+                word.store(0, std::memory_order_release);
+            }
+        }
+
+        int capacity() const
+        {
+            return (int)mVoices.size();
+        }
+
+        int used() const
+        {
+            return capacity() - mNbFree;
+        }
+
+        // takes a free voice for user in steal class klass, None if all are busy
+        int allocate(uint32_t user, int klass)
+        {
+            if (!mNbFree)
+            {
+                return None;
+            }
+
+            int voice = mFree[--mNbFree];
+            Voice &v = mVoices[voice];
+
+            v.inUse = true;
+            v.user = user;
+            v.klass = klass;
+            v.serial = ++mSerial ? mSerial : ++mSerial;  // never 0
+
+            // newest at the tail of its class
+            List &list = mClasses[klass];
+            v.prev = list.tail;
+            v.next = None;
+            if (list.tail != None) mVoices[list.tail].next = voice;
+            else list.head = voice;
+            list.tail = voice;
+
+            // newest at the head of its user chain
+            User &u = mUsers[userSlot(user)];
+            v.userPrev = None;
+            v.userNext = u.voice;
+            if (u.voice != None)
+            {
+                mVoices[u.voice].userPrev = voice;
+            }
+            u.user = user;
+            u.voice = voice;
+
+            return voice;
+        }
+
+        // oldest voice of the lowest class in use, None if no voice is used
+        int victim() const
+        {
+            for (const List &list : mClasses)
+            {
+                if (list.head != None)
+                {
+                    return list.head;
+                }
+            }
+            return None;
+        }
+
+        void release(int voice)
+        {
+            Voice &v = mVoices[voice];
+            if (!v.inUse)
+            {
+                return;
+            }
+
+            List &list = mClasses[v.klass];
+            if (v.prev != None) mVoices[v.prev].next = v.next;
+            else list.head = v.next;
+            if (v.next != None) mVoices[v.next].prev = v.prev;
+            else list.tail = v.prev;
+
+            if (v.userNext != None)
+            {
+                mVoices[v.userNext].userPrev = v.userPrev;
+            }
+            if (v.userPrev != None)
+            {
+                mVoices[v.userPrev].userNext = v.userNext;
+            }
+            else if (v.userNext != None)
+            {
+                mUsers[userSlot(v.user)].voice = v.userNext;
+            }
+            else
+            {
+                eraseUser(userSlot(v.user));
+            }
+
+            v.inUse = false;
+            mFree[mNbFree++] = voice;
+        }
+
+        bool inUse(int voice) const
+        {
+            return voice >= 0 && voice < capacity() && mVoices[voice].inUse;
+        }
+
+        uint32_t serial(int voice) const
+        {
+            return mVoices[voice].serial;
+        }
+
+        // most recent voice playing user, None if there is none
+        int findUser(uint32_t user) const
+        {
+            return mUsers[userSlot(user)].voice;
+        }
+
+        // f(voice) on every voice in use, lowest class first, oldest first; f may release the voice
+        template <typename F>
+        void forEach(F f) const
+        {
+            for (const List &list : mClasses)
+            {
+                for (int voice = list.head; voice != None;)
+                {
+                    int next = mVoices[voice].next;
+                    f(voice);
+                    voice = next;
+                }
+            }
+        }
+
+        // any thread: the voice given this serial has ended
+        void finished(int voice, uint32_t serial)
+        {
+            mEnded[voice].store(serial, std::memory_order_relaxed);
+            mPending[voice >> 6].fetch_or(uint64_t(1) << (voice & 63), std::memory_order_release);
+        }
+
+        // owner thread: f(voice) then release() on every reported voice still holding its serial,
+        // returns how many were released
+        template <typename F>
+        int collect(F f)
+        {
+            int count = 0;
+            for (int word = 0; word < mNbPending; word++)
+            {
+                if (!mPending[word].load(std::memory_order_relaxed))
+                {
+                    continue;
+                }
+
+                // a report made from now on sets its bit again: seen by the next collect()
+                uint64_t bits = mPending[word].exchange(0, std::memory_order_acquire);
+                while (bits)
+                {
+                    int voice = word * 64 + ctz(bits);
+                    bits &= bits - 1;
+
+                    uint32_t serial = mEnded[voice].load(std::memory_order_relaxed);
+                    if (mVoices[voice].inUse && mVoices[voice].serial == serial)
+                    {
+                        f(voice);
+                        release(voice);
+                        count++;
+                    }
+                }
+            }
+            return count;
+        }
+
+    private:
+        struct Voice
+        {
+            bool inUse = false;
+            int klass = 0;
+            uint32_t user = 0;
+            uint32_t serial = 0;
+            int prev = None, next = None;          // in its class, play order
+            int userPrev = None, userNext = None;  // same user, newest first
+        };
+
+        struct List
+        {
+            int head = None;  // oldest
+            int tail = None;
+        };
+
+        struct User
+        {
+            uint32_t user = 0;
+            int voice = None;  // newest voice of user, None: empty slot
+        };
+
+        static int ctz(uint64_t bits)
+        {
+            int n = 0;
+            while (!(bits & 1))
+            {
+                bits >>= 1;
+                n++;
+            }
+            return n;
+        }
+
+        // first slot probed for user (Fibonacci hashing: the top bits of the product)
+        int userHome(uint32_t user) const
+        {
+            return mUserShift < 32 ? (int)((user * 2654435761u) >> mUserShift) : 0;
+        }
+
+        // slot of user, or the empty slot ending its probe (linear probing)
+        int userSlot(uint32_t user) const
+        {
+            int slot = userHome(user);
+            while (mUsers[slot].voice != None && mUsers[slot].user != user)
+            {
+                slot = (slot + 1) & mUserMask;
+            }
+            return slot;
+        }
+
+        // backward shift: the entries probed past slot move back, no tombstones
+        void eraseUser(int slot)
+        {
+            int next = slot;
+            for (;;)
+            {
+                next = (next + 1) & mUserMask;
+                if (mUsers[next].voice == None)
+                {
+                    break;
+                }
+
+                int home = userHome(mUsers[next].user);
+                if (((next - home) & mUserMask) >= ((next - slot) & mUserMask))
+                {
+                    mUsers[slot] = mUsers[next];
+                    slot = next;
+                }
+            }
+            mUsers[slot] = User();
+        }
+
+        std::vector<Voice> mVoices;
+        std::vector<List> mClasses;
+        std::vector<int> mFree;
+        int mNbFree = 0;
+        std::vector<User> mUsers;  // user -> newest voice
+        int mUserMask = 0;
+        int mUserShift = 32;
+        uint32_t mSerial = 0;
+
+        // per voice: last serial reported ended, and a bit set until collect() sees it
+        std::unique_ptr<std::atomic<uint32_t>[]> mEnded;
+        alignas(64) std::atomic<uint64_t> mPending[MaxCapacity / 64];  // own cache line: written by the mixer
+        int mNbPending = 0;
+    };
+}  // namespace Ida
+
+#pragma pack(pop)
@@ -21,13 +21,9 @@ public:
 
     int getNumZones();
 
-    inline int getMaxZones()
-    {
-        // Memory wise we can have more, but the game performance may suffer as there are O(N^2) loops with zone
-        // checks. Also we need to check if the types that store zone index somewhere can exceed this.
-        // Experiment with this value if you want to have more zones per scene.
-        return 128;
-    }
+    // MAX_ZONES of the game. The zone checks go through a spatial index (CheckZoneSce), their cost doesn't
+    // grow with the number of zones. Zones are referenced by pointer or by their Num, not by index.
+    int getMaxZones();
 
     inline int getMaxWaypoints()
     {
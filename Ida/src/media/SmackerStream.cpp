@@ -1,5 +1,6 @@
 #include "SmackerStream.h"
 
+#include <algorithm>
 #include <string>
 
 #include "SmackerStreamInstance.h"
@@ -9,8 +10,11 @@ using namespace SoLoud;
 
 namespace Ida
 {
+    // ring capacity: the game pushes one chunk per video frame, a few seconds leave room for the lead-in
+    constexpr unsigned int RING_SECONDS = 4;
+
     SmackerStream::SmackerStream(unsigned char bitDepth, float sampleRate, unsigned char numChannels)
-        : mBitDepth(bitDepth)
+        : mBitDepth(bitDepth), mBuffer(static_cast<size_t>(sampleRate * max<unsigned char>(numChannels, 1) * RING_SECONDS))
     {
         if (bitDepth != 16 && bitDepth != 8)
         {
@@ -61,22 +65,46 @@ namespace Ida
             }
         }
 
-        lock_guard<mutex> lock(mMutex);
-        mBuffer.insert(mBuffer.end(), sampleBuffer, sampleBuffer + sampleCount);
+        // whole frames only: the ring capacity is a power of two and every read/write is a multiple of mChannels,
+        // so the free room always is too and a stereo pair is never split
+        sampleCount -= sampleCount % mChannels;
+
+        // the samples held back by an earlier overrun go first, in order
+        if (mPendingStart < mPending.size())
+        {
+            mPendingStart += mBuffer.write(mPending.data() + mPendingStart, mPending.size() - mPendingStart);
+            if (mPendingStart == mPending.size())
+            {
+                mPending.clear();
+                mPendingStart = 0;
+            }
+        }
+
+        size_t written = mPending.empty() ? mBuffer.write(sampleBuffer, sampleCount) : 0;
+
+        // no room in the ring (the mixer is late or not started yet): kept for later, unbounded like the
+        // deque it replaced
+        if (written < sampleCount)
+        {
+            mOverruns++;
+            mPending.insert(mPending.end(), sampleBuffer + written, sampleBuffer + sampleCount);
+            mMaxPending = max(mMaxPending, mPending.size() - mPendingStart);
+        }
     }
 
     unsigned int SmackerStream::readNext(float *buffer, unsigned int numberOfSamples)
     {
-        lock_guard<mutex> lock(mMutex);
+        numberOfSamples -= numberOfSamples % mChannels;
 
-        if (mBuffer.empty()) return 0;
+        auto samplesRead = static_cast<unsigned int>(mBuffer.read(buffer, numberOfSamples));
 
-        unsigned int samplesToRead = min(numberOfSamples, mBuffer.size());
-        copy(mBuffer.begin(), mBuffer.begin() + samplesToRead, buffer);
-
-        mBuffer.erase(mBuffer.begin(), mBuffer.begin() + samplesToRead);
+        if (samplesRead < numberOfSamples && mLastReadFull)
+        {
+            mUnderruns++;
+        }
+        mLastReadFull = samplesRead == numberOfSamples;
 
-        return samplesToRead;
+        return samplesRead;
     }
 
     AudioSourceInstance *SmackerStream::createInstance()
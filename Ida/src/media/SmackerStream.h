@@ -2,10 +2,11 @@
 
 #pragma pack(push, 8)
 
-#include <deque>
-#include <mutex>
+#include <atomic>
+#include <vector>
 
 #include "common/ElasticBuffer.h"
+#include "common/SpscRingBuffer.h"
 #include "soloud.h"
 
 namespace Ida
@@ -16,15 +17,31 @@ namespace Ida
 
         SoLoud::AudioSourceInstance *mInstance = nullptr;
 
-        std::mutex mMutex;
-        std::deque<float> mBuffer;
+        // interleaved float frames: the game thread writes, the SoLoud mixer thread reads
+        SpscRingBuffer<float> mBuffer;
         ElasticBuffer<float> mSampleBuffer;
 
+        // game thread only: what didn't fit in the ring, written first at the next chunk
+        std::vector<float> mPending;
+        size_t mPendingStart = 0;
+        size_t mMaxPending = 0;
+
+        std::atomic<unsigned int> mUnderruns{0};
+        std::atomic<unsigned int> mOverruns{0};
+        bool mLastReadFull = false;
+
     public:
         SmackerStream(unsigned char bitDepth, float sampleRate, unsigned char numChannels);
         virtual ~SmackerStream();
         void addNextChunk(const unsigned char *buffer, unsigned int bufferSize);
         unsigned int readNext(float *buffer, unsigned int numberOfSamples);
+
+        // mixer reads that came up short after a full one (the end of the video counts once)
+        unsigned int getUnderruns() const { return mUnderruns; }
+        // chunks that didn't fit in the ring (the samples left out wait in mPending, none is dropped)
+        unsigned int getOverruns() const { return mOverruns; }
+        // most samples held back in mPending at once
+        unsigned int getMaxPending() const { return static_cast<unsigned int>(mMaxPending); }
         virtual SoLoud::AudioSourceInstance *createInstance();
     };
 };  // namespace Ida
@@ -23,8 +23,15 @@ COMPRESSED_HEADER *GetPtrBlockMemoryHQR(void *ptrhqr, S32 index)
 	// recupere offset bloc
 	seekindex	= *(U32*)((U8*)ptrhqr + index)	;
 
-	// saute header
-	return	(COMPRESSED_HEADER*)((U8*)ptrhqr + seekindex + sizeof(T_HQR_HEADER));
+	// bloc vide
+	if( !seekindex )
+	{
+		return NULL 		;
+	}
+
+	// l'offset pointe directement sur le COMPRESSED_HEADER du bloc: le hqr
+	// est en mémoire tel quel sur le disque (chargé ou mappé, cf MapFile)
+	return	(COMPRESSED_HEADER*)((U8*)ptrhqr + seekindex);
 }
 
 //──────────────────────────────────────────────────────────────────────────
@@ -0,0 +1,251 @@
+#include "dirtytiles.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// index of the lowest bit set, v != 0
+static inline int dirtytiles_ctz(unsigned int v)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return (int)index;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+// first column >= c (and < cols) whose bit is set (or clear), cols if none
+static int dirtytiles_next(const unsigned int *row, int c, int cols, int set)
+{
+    for (int w = c >> 5; (w << 5) < cols; w++)
+    {
+        unsigned int bits = set ? row[w] : ~row[w];
+        if (w == (c >> 5)) bits &= ~0u << (c & 31);
+        if (bits)
+        {
+            c = (w << 5) + dirtytiles_ctz(bits);
+            return c < cols ? c : cols;
+        }
+    }
+    return cols;
+}
+
+void dirtytiles_clear(dirtytiles *t)
+{
+    if (t->rowmin <= t->rowmax)
+    {
+        memset(t->bits[t->rowmin], 0, (t->rowmax - t->rowmin + 1) * sizeof(t->bits[0]));
+    }
+    t->rowmin = DIRTYTILES_ROWS;
+    t->rowmax = -1;
+    t->nbox = 0;
+}
+
+int dirtytiles_empty(const dirtytiles *t)
+{
+    return t->rowmin > t->rowmax && t->nbox == 0;
+}
+
+// sets the tiles of the box b
+static void dirtytiles_tiles(dirtytiles *t, const int *b)
+{
+    int x0 = b[0], y0 = b[1], x1 = b[2], y1 = b[3];
+
+    int c0 = x0 >> DIRTYTILES_SHIFT_X, c1 = (x1 - 1) >> DIRTYTILES_SHIFT_X;
+    int r0 = y0 >> DIRTYTILES_SHIFT_Y, r1 = (y1 - 1) >> DIRTYTILES_SHIFT_Y;
+
+    // columns c0..c1 in each word
+    unsigned int masks[DIRTYTILES_WORDS];
+    for (int w = 0; w < DIRTYTILES_WORDS; w++)
+    {
+        int lo = c0 > (w << 5) ? c0 : (w << 5);
+        int hi = c1 < (w << 5) + 31 ? c1 : (w << 5) + 31;
+        masks[w] = lo <= hi ? (~0u >> (31 - (hi - lo))) << (lo & 31) : 0;
+    }
+
+    for (int r = r0; r <= r1; r++)
+    {
+        for (int w = c0 >> 5; w <= c1 >> 5; w++)
+        {
+            t->bits[r][w] |= masks[w];
+        }
+    }
+
+    if (r0 < t->rowmin) t->rowmin = r0;
+    if (r1 > t->rowmax) t->rowmax = r1;
+}
+
+// the boxes go to the tiles
+static void dirtytiles_spill(dirtytiles *t)
+{
+    for (int i = 0; i < t->nbox; i++)
+    {
+        dirtytiles_tiles(t, t->box[i]);
+    }
+    t->nbox = 0;
+}
+
+// NewBox() of the old DIRTYBOX.CPP: b is dropped when a box has it, merged
+// with the boxes whose bounding box is not bigger than the two of them, and
+// added. Returns 0 when there is no room left for it (b merged).
+static int dirtytiles_box(dirtytiles *t, int *b)
+{
+    int area = (b[2] - b[0]) * (b[3] - b[1]);
+
+    for (int i = 0; i < t->nbox; i++)
+    {
+        int *c = t->box[i];
+        if (c[0] <= b[0] && c[1] <= b[1] && c[2] >= b[2] && c[3] >= b[3]) return 1;
+
+        int u0 = c[0] < b[0] ? c[0] : b[0], u1 = c[1] < b[1] ? c[1] : b[1];
+        int u2 = c[2] > b[2] ? c[2] : b[2], u3 = c[3] > b[3] ? c[3] : b[3];
+        int union_area = (u2 - u0) * (u3 - u1);
+
+        if (union_area <= area + (c[2] - c[0]) * (c[3] - c[1]))
+        {
+            b[0] = u0, b[1] = u1, b[2] = u2, b[3] = u3;
+            area = union_area;
+            memcpy(c, t->box[--t->nbox], sizeof(t->box[0]));
+            i = -1;    // the bigger box may take others
+        }
+    }
+
+    if (t->nbox == DIRTYTILES_BOXES) return 0;
+
+    memcpy(t->box[t->nbox++], b, sizeof(t->box[0]));
+    return 1;
+}
+
+void dirtytiles_add(dirtytiles *t, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > DIRTYTILES_COLS << DIRTYTILES_SHIFT_X) x1 = DIRTYTILES_COLS << DIRTYTILES_SHIFT_X;
+    if (y1 > DIRTYTILES_ROWS << DIRTYTILES_SHIFT_Y) y1 = DIRTYTILES_ROWS << DIRTYTILES_SHIFT_Y;
+    if (x1 <= x0 || y1 <= y0) return;
+
+    int b[4] = {x0, y0, x1, y1};
+
+    // exact boxes as long as they fit, the tiles after
+    if (t->rowmin > t->rowmax)
+    {
+        if (dirtytiles_box(t, b)) return;
+        dirtytiles_spill(t);
+    }
+
+    dirtytiles_tiles(t, b);
+}
+
+void dirtytiles_merge(dirtytiles *dst, const dirtytiles *src)
+{
+    if (src->rowmin <= src->rowmax)
+    {
+        dirtytiles_spill(dst);
+
+        for (int r = src->rowmin; r <= src->rowmax; r++)
+        {
+            for (int w = 0; w < DIRTYTILES_WORDS; w++)
+            {
+                dst->bits[r][w] |= src->bits[r][w];
+            }
+        }
+
+        if (src->rowmin < dst->rowmin) dst->rowmin = src->rowmin;
+        if (src->rowmax > dst->rowmax) dst->rowmax = src->rowmax;
+    }
+
+    for (int i = 0; i < src->nbox; i++)
+    {
+        const int *b = src->box[i];
+        dirtytiles_add(dst, b[0], b[1], b[2], b[3]);
+    }
+}
+
+int dirtytiles_rects(const dirtytiles *t, int width, int height, dirtytiles_func *func, void *user)
+{
+    // columns c0..c1-1 set on the rows from r0 down to the current one
+    struct span
+    {
+        int c0, c1, r0;
+    };
+
+    span open[DIRTYTILES_COLS / 2 + 1], next[DIRTYTILES_COLS / 2 + 1], runs[DIRTYTILES_COLS / 2 + 1];
+    int nopen = 0, count = 0;
+
+    for (int i = 0; i < t->nbox; i++)
+    {
+        const int *b = t->box[i];
+        int x1 = b[2] < width ? b[2] : width, y1 = b[3] < height ? b[3] : height;
+        if (x1 > b[0] && y1 > b[1])
+        {
+            func(user, b[0], b[1], x1, y1);
+            count++;
+        }
+    }
+
+    int cols = (width + (1 << DIRTYTILES_SHIFT_X) - 1) >> DIRTYTILES_SHIFT_X;
+    int rows = (height + (1 << DIRTYTILES_SHIFT_Y) - 1) >> DIRTYTILES_SHIFT_Y;
+    if (cols > DIRTYTILES_COLS) cols = DIRTYTILES_COLS;
+    if (rows > DIRTYTILES_ROWS) rows = DIRTYTILES_ROWS;
+
+    int rowmax = t->rowmax < rows - 1 ? t->rowmax : rows - 1;
+
+#define DIRTYTILES_EMIT(s, r1)                                                                   \
+    {                                                                                            \
+        int ex1 = (s).c1 << DIRTYTILES_SHIFT_X, ey1 = (r1) << DIRTYTILES_SHIFT_Y;                \
+        func(user, (s).c0 << DIRTYTILES_SHIFT_X, (s).r0 << DIRTYTILES_SHIFT_Y,                   \
+             ex1 < width ? ex1 : width, ey1 < height ? ey1 : height);                            \
+        count++;                                                                                 \
+    }
+
+    for (int r = t->rowmin; r <= rowmax; r++)
+    {
+        // the runs of the row
+        int nruns = 0;
+        for (int c = dirtytiles_next(t->bits[r], 0, cols, 1); c < cols;
+             c = dirtytiles_next(t->bits[r], c, cols, 1))
+        {
+            runs[nruns].c0 = c;
+            c = dirtytiles_next(t->bits[r], c, cols, 0);
+            runs[nruns].c1 = c;
+            runs[nruns].r0 = r;
+            nruns++;
+        }
+
+        // a run with the columns of an open rectangle makes it one row longer, the others close
+        int i = 0, j = 0, nnext = 0;
+        while (i < nopen || j < nruns)
+        {
+            if (i < nopen && j < nruns && open[i].c0 == runs[j].c0 && open[i].c1 == runs[j].c1)
+            {
+                next[nnext++] = open[i++];
+                j++;
+            }
+            else if (j >= nruns || (i < nopen && open[i].c0 <= runs[j].c0))
+            {
+                DIRTYTILES_EMIT(open[i], r);
+                i++;
+            }
+            else
+            {
+                next[nnext++] = runs[j++];
+            }
+        }
+
+        memcpy(open, next, nnext * sizeof(span));
+        nopen = nnext;
+    }
+
+    for (int i = 0; i < nopen; i++)
+    {
+        DIRTYTILES_EMIT(open[i], rowmax + 1);
+    }
+
+#undef DIRTYTILES_EMIT
+
+    return count;
+}
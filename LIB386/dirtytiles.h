@@ -0,0 +1,44 @@
+#ifndef __DIRTYTILES_H__
+#define __DIRTYTILES_H__
+
+// Dirty area of the screen (DIRTYBOX.CPP). The first boxes are kept as they
+// are, merged like NewBox() did when the merge is not bigger than the two
+// boxes. Past DIRTYTILES_BOXES boxes they go to a bitmap of 16x8 tiles:
+// adding a box sets the bits of the tiles it touches, whatever the number of
+// boxes already there, and the blits are the rectangles of the set tiles,
+// each row cut in runs and the runs of the same columns on consecutive rows
+// put together.
+
+#define DIRTYTILES_SHIFT_X  4                           // 16 pixels
+#define DIRTYTILES_SHIFT_Y  3                           // 8 lines
+#define DIRTYTILES_COLS     128                         // up to 2048 pixels
+#define DIRTYTILES_ROWS     256                         // up to 2048 lines
+#define DIRTYTILES_WORDS    (DIRTYTILES_COLS / 32)
+#define DIRTYTILES_BOXES    16                          // exact boxes before the tiles
+
+struct dirtytiles
+{
+    unsigned int bits[DIRTYTILES_ROWS][DIRTYTILES_WORDS];
+    int rowmin, rowmax;                                 // rows with bits, rowmin > rowmax when empty
+    int nbox;                                           // exact boxes, none once the tiles are in use
+    int box[DIRTYTILES_BOXES][4];                       // x0, y0, x1, y1
+};
+
+// called for each rectangle, x1 and y1 excluded
+typedef void dirtytiles_func(void *user, int x0, int y0, int x1, int y1);
+
+void dirtytiles_clear(dirtytiles *t);
+
+int dirtytiles_empty(const dirtytiles *t);
+
+// adds the box x0..x1-1, y0..y1-1
+void dirtytiles_add(dirtytiles *t, int x0, int y0, int x1, int y1);
+
+// dst gets the boxes and tiles of src too
+void dirtytiles_merge(dirtytiles *dst, const dirtytiles *src);
+
+// calls func for the boxes, or the rectangles covering the tiles, cut to
+// width x height. Returns the number of rectangles.
+int dirtytiles_rects(const dirtytiles *t, int width, int height, dirtytiles_func *func, void *user);
+
+#endif // __DIRTYTILES_H__
@@ -0,0 +1,102 @@
+#include "ima_adpcm.h"
+
+/* step_table[] and index_table[] are from the ADPCM reference source (see adpcm.cpp) */
+static const int ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static const int ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+// indexed by step_index*16 + nibble:
+// signed predictor difference, and the next step_index (already *16)
+static int ima_diff_table[89 * 16];
+static int ima_next_table[89 * 16];
+
+static bool ima_build_tables()
+{
+    for (int index = 0; index < 89; index++)
+    {
+        for (int nibble = 0; nibble < 16; nibble++)
+        {
+            int diff = ((2 * (nibble & 7) + 1) * ima_step_table[index]) >> 3;
+            int next = index + ima_index_table[nibble];
+
+            if (next < 0) next = 0;
+            if (next > 88) next = 88;
+
+            ima_diff_table[index * 16 + nibble] = (nibble & 8) ? -diff : diff;
+            ima_next_table[index * 16 + nibble] = next * 16;
+        }
+    }
+    return true;
+}
+
+static const bool ima_tables_ready = ima_build_tables();
+
+static inline int ima_clamp(int value)
+{
+    value = value > 32767 ? 32767 : value;
+    return value < -32768 ? -32768 : value;
+}
+
+static short *ima_decode_block(short *out, const unsigned char *in, int size)
+{
+    int predictor = (short)(in[0] | (in[1] << 8));
+    int index = (in[2] > 88 ? 88 : in[2]) * 16;
+
+    // in[3] unused
+
+    for (in += 4, size -= 4; size > 0; size--, in++)
+    {
+        int code = index + (*in & 0x0F);
+        predictor = ima_clamp(predictor + ima_diff_table[code]);
+        index = ima_next_table[code];
+        out[0] = (short)predictor;
+
+        code = index + (*in >> 4);
+        predictor = ima_clamp(predictor + ima_diff_table[code]);
+        index = ima_next_table[code];
+        out[1] = (short)predictor;
+
+        out += 2;
+    }
+    return out;
+}
+
+int ima_adpcm_decode(short *out, const unsigned char *in, int size, int blocksize)
+{
+    short *start = out;
+
+    while (size > 0)
+    {
+        int len = size < blocksize ? size : blocksize;
+
+        // a block smaller than its header decodes to nothing
+        if (len > 4)
+        {
+            out = ima_decode_block(out, in, len);
+        }
+
+        in += len;
+        size -= len;
+    }
+    return (int)(out - start);
+}
+
+int ima_adpcm_decoded_samples(int size, int blocksize)
+{
+    int last = size % blocksize;
+
+    return (size / blocksize) * (blocksize - 4) * 2 + (last > 4 ? (last - 4) * 2 : 0);
+}
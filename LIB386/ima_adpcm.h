@@ -0,0 +1,16 @@
+#ifndef __IMA_ADPCM_H__
+#define __IMA_ADPCM_H__
+
+// IMA ADPCM (WAV, mono) decoder working on whole buffers.
+// Same output as adpcm_decode_frame() (adpcm.cpp) called on each block,
+// but driven by a [step index][nibble] table: no branch per nibble except
+// the 16 bits clamping.
+
+// Decodes size bytes cut in blocks of blocksize bytes (4 bytes header each,
+// the last block may be shorter). Returns the number of samples written.
+int ima_adpcm_decode(short *out, const unsigned char *in, int size, int blocksize);
+
+// Number of samples ima_adpcm_decode() writes for this input.
+int ima_adpcm_decoded_samples(int size, int blocksize);
+
+#endif // __IMA_ADPCM_H__
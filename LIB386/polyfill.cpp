@@ -0,0 +1,2154 @@
+#include "polyfill.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(POLYFILL_NOSIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define POLYFILL_AVX2
+#define POLYFILL_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POLYFILL_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define POLYFILL_NEON
+#endif
+
+// Banks of Switch_Fillers (Table_Switch of POLY.ASM)
+enum
+{
+    BANK_FOG = 1,
+    BANK_ZBUF = 2,
+    BANK_NZW = 4
+};
+
+static const unsigned char Bank_Flags[8] = {
+    0, 0, BANK_FOG, 0, BANK_ZBUF, BANK_FOG | BANK_ZBUF, BANK_NZW, BANK_FOG | BANK_NZW,
+};
+
+// Fill_ClipFlag
+enum
+{
+    CLIP_FLAT = 1,
+    CLIP_LIGHT = 2,
+    CLIP_TEXTURE = 4,
+    CLIP_TEXTUREZ = 8,
+    CLIP_ZBUFFER = 16
+};
+
+// The fillers, by family
+enum
+{
+    F_FLAT,
+    F_TRANS,
+    F_TRAME,
+    F_FLAG,
+    F_GOURAUD,
+    F_DITHER,
+    F_TEX,
+    F_TEXG,
+    F_TEXD,
+    F_TZ,
+    F_TZG,
+    F_TZF
+};
+
+// How the gouraud and texture fillers get their colors
+enum
+{
+    OP_SOLID,  // the texel, or the gouraud byte
+    OP_FLAT,   // Fill_Color table of PtrCLUTGouraud
+    OP_FOG,    // Fill_Logical_Palette
+    OP_TABLE   // gouraud byte in the Fill_Color table of PtrCLUTGouraud
+};
+
+// Jmp_XSlope and Jmp_LeftSlope, by Type_Poly (the same in every bank, the
+// zbuffer banks run the ZBuf slopes first for the types 0 to 23)
+enum
+{
+    XS_NONE,
+    XS_GOURAUD,
+    XS_DITHER,
+    XS_TEXTURE,
+    XS_TEXGOURAUD,
+    XS_TEXDITHER,
+    XS_TEXZ,
+    XS_TEXZGOURAUD,
+    XS_TEXZZBUF,
+    XS_ZBUF
+};
+
+static const unsigned char XSlope_Type[26] = {
+    XS_NONE,     XS_NONE,     XS_NONE,          XS_NONE,          XS_GOURAUD,  XS_DITHER,   XS_GOURAUD,
+    XS_DITHER,   XS_TEXTURE,  XS_TEXTURE,       XS_TEXGOURAUD,    XS_TEXDITHER, XS_TEXTURE, XS_TEXTURE,
+    XS_TEXGOURAUD, XS_TEXDITHER, XS_TEXZ,       XS_TEXZ,          XS_TEXZGOURAUD, XS_TEXZGOURAUD, XS_TEXZ,
+    XS_TEXZ,     XS_TEXZGOURAUD, XS_TEXZGOURAUD, XS_TEXZZBUF,     XS_ZBUF,
+};
+
+enum
+{
+    LS_NONE,
+    LS_GOURAUD,
+    LS_GOURAUDTABLE,
+    LS_TEXTURE,
+    LS_TEXGOURAUD,
+    LS_TEXZ,
+    LS_TEXZGOURAUD,
+    LS_TEXZZBUF,
+    LS_ZBUF
+};
+
+static const unsigned char LeftSlope_Type[26] = {
+    LS_NONE,        LS_NONE,        LS_NONE,        LS_NONE,        LS_GOURAUD,     LS_GOURAUD,
+    LS_GOURAUDTABLE, LS_GOURAUDTABLE, LS_TEXTURE,   LS_TEXTURE,     LS_TEXGOURAUD,  LS_TEXGOURAUD,
+    LS_TEXTURE,     LS_TEXTURE,     LS_TEXGOURAUD,  LS_TEXGOURAUD,  LS_TEXZ,        LS_TEXZ,
+    LS_TEXZGOURAUD, LS_TEXZGOURAUD, LS_TEXZ,        LS_TEXZ,        LS_TEXZGOURAUD, LS_TEXZGOURAUD,
+    LS_TEXZZBUF,    LS_ZBUF,
+};
+
+// Attributes stepped along the left edge
+enum
+{
+    A_G = 1,
+    A_U = 2,
+    A_V = 4,
+    A_W = 8,
+    A_Z = 16
+};
+
+enum
+{
+    READ_L = 1,
+    READ_R = 2
+};
+
+#define MAX_POINTS 64 // points of a polygon, before and after each clip plane
+#define CHUNK 64      // pixels of a span computed at a time
+
+struct fill_state
+{
+    polyfill_context *ctx;
+    int type;
+    int filler, op, ck; // F_, OP_, chroma key
+    int zmode;          // 0 no zbuffer, 1 ZBuf, 2 NZW
+    uint32_t color;     // Fill_Color
+    const unsigned char *table; // Fill_Color as a pointer in PtrCLUTGouraud
+    int clipflag;
+    int attrs;
+
+    int patch;
+    uint32_t parity; // Fill_Trame_Parity
+    polyfill_point *first, *last, *leftp, *rightp;
+    int readflag;
+    int32_t leftslope, rightslope;
+    int32_t cury;
+    uint32_t xmin, xmax;
+    intptr_t offline;
+
+    int32_t yb_ya, yc_ya, denom;
+
+    // Fill_Cur*Min, *_LeftSlope and *_XSlope
+    uint32_t g, u, v, w, z;
+    int32_t gls, uls, vls, wls, zls;
+    int32_t gxs, uxs, vxs, wxs, zxs;
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The arithmetic of the ASM
+
+static inline uint32_t dw(const polyfill_point *p)
+{
+    return (uint16_t)p->x | ((uint32_t)(uint16_t)p->y << 16);
+}
+
+static inline void set_dw(polyfill_point *p, uint32_t v)
+{
+    p->x = (short)(uint16_t)v;
+    p->y = (short)(uint16_t)(v >> 16);
+}
+
+// ROUND_CHOP of FILLER.INC
+static inline int32_t chop(int32_t r)
+{
+    return (int32_t)((uint32_t)r + ((uint32_t)r >> 31));
+}
+
+// idiv: the ASM faults on a divide by 0 or a quotient out of 32 bits, both
+// are truncated here
+static inline int32_t idiv64(int64_t n, int32_t d)
+{
+    if (!d)
+    {
+        return 0;
+    }
+    if (d == -1)
+    {
+        return (int32_t)(uint32_t)(0 - (uint64_t)n);
+    }
+    return (int32_t)(uint32_t)(uint64_t)(n / d);
+}
+
+// U or V times W, imul then shr eax,8 / shl edx,24
+static inline int32_t mul_w(uint32_t a, uint32_t w)
+{
+    return (int32_t)(uint32_t)((int64_t)a * (int32_t)w >> 8);
+}
+
+// Attribute step of the prestep: imul by the fraction of XMin, >> 16
+static inline uint32_t prestep(int32_t slope, uint32_t frac)
+{
+    return (uint32_t)((int64_t)slope * (int64_t)frac >> 16);
+}
+
+// Init_PerspINT / Loop_PerspINT
+static inline int32_t persp_w(int32_t w)
+{
+    return (w == 0 || w == -1 || w == 1) ? 2 : w;
+}
+
+static inline int32_t persp_inv(int32_t w)
+{
+    return (int32_t)(4294967295LL / w);
+}
+
+static inline uint32_t persp_mul(int32_t a, int32_t inv, int shift)
+{
+    return (uint32_t)((int64_t)a * inv >> shift);
+}
+
+static inline uint8_t rol8(uint32_t b, uint32_t n)
+{
+    n = (n & 31) & 7;
+    b &= 0xFF;
+    return (uint8_t)((b << n) | (b >> ((8 - n) & 7)));
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Span values, N pixels at a time: the same generators run on scalar_ops
+// for the tails and the builds without SIMD.
+
+struct scalar_ops
+{
+    enum { N = 1 };
+    typedef uint32_t v;
+
+    static v ramp(uint32_t a, uint32_t) { return a; }
+    static v set(uint32_t a) { return a; }
+    static v add(v a, v b) { return a + b; }
+    static v and_(v a, v b) { return a & b; }
+    static v or_(v a, v b) { return a | b; }
+    static v srl(v a, int n) { return a >> n; }
+    static void store8(unsigned char *p, v a) { *p = (unsigned char)a; }
+    static void store16(unsigned short *p, v a) { *p = (unsigned short)a; }
+};
+
+#if defined(POLYFILL_AVX2)
+struct simd_ops
+{
+    enum { N = 8 };
+    typedef __m256i v;
+
+    static v ramp(uint32_t a, uint32_t s)
+    {
+        return _mm256_setr_epi32(a, a + s, a + 2 * s, a + 3 * s, a + 4 * s, a + 5 * s, a + 6 * s, a + 7 * s);
+    }
+    static v set(uint32_t a) { return _mm256_set1_epi32(a); }
+    static v add(v a, v b) { return _mm256_add_epi32(a, b); }
+    static v and_(v a, v b) { return _mm256_and_si256(a, b); }
+    static v or_(v a, v b) { return _mm256_or_si256(a, b); }
+    static v srl(v a, int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+
+    // values of 0..255
+    static void store8(unsigned char *p, v a)
+    {
+        __m256i b = _mm256_packus_epi16(_mm256_packs_epi32(a, a), a);
+        int lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(b));
+        int hi = _mm_cvtsi128_si32(_mm256_extracti128_si256(b, 1));
+        memcpy(p, &lo, 4);
+        memcpy(p + 4, &hi, 4);
+    }
+    static void store16(unsigned short *p, v a)
+    {
+        a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+        a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, a), 0xD8);
+        _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(a));
+    }
+};
+#elif defined(POLYFILL_SSE2)
+struct simd_ops
+{
+    enum { N = 4 };
+    typedef __m128i v;
+
+    static v ramp(uint32_t a, uint32_t s) { return _mm_setr_epi32(a, a + s, a + 2 * s, a + 3 * s); }
+    static v set(uint32_t a) { return _mm_set1_epi32(a); }
+    static v add(v a, v b) { return _mm_add_epi32(a, b); }
+    static v and_(v a, v b) { return _mm_and_si128(a, b); }
+    static v or_(v a, v b) { return _mm_or_si128(a, b); }
+    static v srl(v a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+
+    static void store8(unsigned char *p, v a)
+    {
+        int b = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(a, a), a));
+        memcpy(p, &b, 4);
+    }
+    static void store16(unsigned short *p, v a)
+    {
+        a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        _mm_storel_epi64((__m128i *)p, _mm_packs_epi32(a, a));
+    }
+};
+#elif defined(POLYFILL_NEON)
+struct simd_ops
+{
+    enum { N = 4 };
+    typedef uint32x4_t v;
+
+    static v ramp(uint32_t a, uint32_t s)
+    {
+        const uint32_t r[4] = {a, a + s, a + 2 * s, a + 3 * s};
+        return vld1q_u32(r);
+    }
+    static v set(uint32_t a) { return vdupq_n_u32(a); }
+    static v add(v a, v b) { return vaddq_u32(a, b); }
+    static v and_(v a, v b) { return vandq_u32(a, b); }
+    static v or_(v a, v b) { return vorrq_u32(a, b); }
+    static v srl(v a, int n) { return vshlq_u32(a, vdupq_n_s32(-n)); }
+
+    static void store8(unsigned char *p, v a)
+    {
+        uint16x4_t h = vmovn_u32(a);
+        uint32_t b = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(h, h))), 0);
+        memcpy(p, &b, 4);
+    }
+    static void store16(unsigned short *p, v a) { vst1_u16(p, vmovn_u32(a)); }
+};
+#else
+typedef scalar_ops simd_ops;
+#endif
+
+// zbuffer values: (z + k * zs) >> 8
+template <class ops> static int z_block(unsigned short *out, uint32_t z, uint32_t zs, int n)
+{
+    typename ops::v x = ops::ramp(z, zs), step = ops::set(zs * ops::N);
+    int k = 0;
+    for (; k + ops::N <= n; k += ops::N)
+    {
+        ops::store16(out + k, ops::srl(x, 8));
+        x = ops::add(x, step);
+    }
+    return k;
+}
+
+// gouraud bytes: (g + k * gs) >> 16
+template <class ops> static int gouraud_block(unsigned char *out, uint32_t g, uint32_t gs, int n)
+{
+    typename ops::v x = ops::ramp(g, gs), step = ops::set(gs * ops::N), m = ops::set(0xFF);
+    int k = 0;
+    for (; k + ops::N <= n; k += ops::N)
+    {
+        ops::store8(out + k, ops::and_(ops::srl(x, 16), m));
+        x = ops::add(x, step);
+    }
+    return k;
+}
+
+// Affine texture offsets, V and U 8.16 (RepMask of 2^n - 1 bytes only)
+template <class ops>
+static int affine_block(unsigned short *out, uint32_t u, uint32_t v, uint32_t us, uint32_t vs, uint32_t mask, int n)
+{
+    typename ops::v xu = ops::ramp(u, us), xv = ops::ramp(v, vs);
+    typename ops::v su = ops::set(us * ops::N), sv = ops::set(vs * ops::N);
+    typename ops::v mu = ops::set(mask & 0xFF), mv = ops::set(mask & 0xFF00);
+    int k = 0;
+    for (; k + ops::N <= n; k += ops::N)
+    {
+        ops::store16(out + k, ops::or_(ops::and_(ops::srl(xv, 8), mv), ops::and_(ops::srl(xu, 16), mu)));
+        xu = ops::add(xu, su);
+        xv = ops::add(xv, sv);
+    }
+    return k;
+}
+
+// Perspective texture offsets: V 8.8 in the high word, U 8.8 in the low one
+template <class ops> static int persp_block(unsigned short *out, uint32_t e, uint32_t es, uint32_t mask, int n)
+{
+    typename ops::v x = ops::ramp(e, es), step = ops::set(es * ops::N);
+    typename ops::v mu = ops::set(mask & 0xFF), mv = ops::set(mask & 0xFF00);
+    int k = 0;
+    for (; k + ops::N <= n; k += ops::N)
+    {
+        ops::store16(out + k, ops::or_(ops::and_(ops::srl(x, 16), mv), ops::and_(ops::srl(x, 8), mu)));
+        x = ops::add(x, step);
+    }
+    return k;
+}
+
+static void span_z(unsigned short *out, uint32_t z, uint32_t zs, int n)
+{
+    int k = z_block<simd_ops>(out, z, zs, n);
+    z_block<scalar_ops>(out + k, z + k * zs, zs, n - k);
+}
+
+static void span_gouraud(unsigned char *out, uint32_t g, uint32_t gs, int n)
+{
+    int k = gouraud_block<simd_ops>(out, g, gs, n);
+    gouraud_block<scalar_ops>(out + k, g + k * gs, gs, n - k);
+}
+
+static void span_persp(unsigned short *out, uint32_t e, uint32_t es, uint32_t mask, int n)
+{
+    int k = persp_block<simd_ops>(out, e, es, mask, n);
+    persp_block<scalar_ops>(out + k, e + k * es, es, mask, n - k);
+}
+
+// Offsets of Filler_Texture: al and ah stepped with the carries of their
+// fractions, masked by RepMask at each pixel. The masked steps are the
+// closed form ones when the two bytes of RepMask are 2^n - 1.
+struct affine
+{
+    uint32_t ufrac, vfrac, usfrac, vsfrac;
+    uint32_t al, ah, ui, vi;
+    uint32_t mask;
+    int linear;
+    uint32_t u, v, us, vs;
+};
+
+static void affine_init(affine *a, uint32_t u, uint32_t v, uint32_t us, uint32_t vs, uint32_t mask)
+{
+    uint32_t mu = mask & 0xFF, mv = (mask >> 8) & 0xFF;
+
+    a->mask = mask;
+    a->linear = !(mu & (mu + 1)) && !(mv & (mv + 1));
+    a->u = u;
+    a->v = v;
+    a->us = us;
+    a->vs = vs;
+    a->ufrac = u << 16;
+    a->vfrac = v << 16;
+    a->usfrac = us << 16;
+    a->vsfrac = vs << 16;
+    a->ui = (us >> 16) & 0xFF;
+    a->vi = (vs >> 16) & 0xFF;
+    uint32_t e = (((u >> 16) & 0xFF) | (((v >> 16) & 0xFF) << 8)) & mask;
+    a->al = e & 0xFF;
+    a->ah = (e >> 8) & 0xFF;
+}
+
+static void span_affine(unsigned short *out, affine *a, int n)
+{
+    if (a->linear)
+    {
+        int k = affine_block<simd_ops>(out, a->u, a->v, a->us, a->vs, a->mask, n);
+        affine_block<scalar_ops>(out + k, a->u + k * a->us, a->v + k * a->vs, a->us, a->vs, a->mask, n - k);
+        a->u += n * a->us;
+        a->v += n * a->vs;
+        return;
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+        out[k] = (unsigned short)(a->al | (a->ah << 8));
+
+        uint32_t f = a->vfrac + a->vsfrac;
+        a->ah += a->vi + (f < a->vfrac);
+        a->vfrac = f;
+        f = a->ufrac + a->usfrac;
+        a->al += a->ui + (f < a->ufrac);
+        a->ufrac = f;
+
+        uint32_t e = ((a->al & 0xFF) | ((a->ah & 0xFF) << 8)) & a->mask;
+        a->al = e & 0xFF;
+        a->ah = (e >> 8) & 0xFF;
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Span writes
+
+enum
+{
+    ZM_WRITE = 1, // ZBuf: write the z of the pixels that pass
+    ZM_CK = 2,    // skip the pixels of texel 0
+    ZM_CKZ = 4    // ... without writing their z
+};
+
+// Pixels of col where the zbuffer passes (z <= zbuffer)
+static void span_zmerge(unsigned char *dst, unsigned short *zb, const unsigned short *z, const unsigned char *col,
+                        const unsigned char *tex, int n, int flags)
+{
+    int k = 0;
+
+#if defined(POLYFILL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; k + 8 <= n; k += 8)
+    {
+        __m128i zv = _mm_loadu_si128((const __m128i *)(z + k));
+        __m128i zbv = _mm_loadu_si128((const __m128i *)(zb + k));
+        __m128i pass = _mm_cmpeq_epi16(_mm_subs_epu16(zv, zbv), zero);
+        __m128i pix = pass, zw = pass;
+
+        if (flags & ZM_CK)
+        {
+            __m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(tex + k)), zero);
+            __m128i ck = _mm_cmpeq_epi16(t, zero);
+            pix = _mm_andnot_si128(ck, pix);
+            if (flags & ZM_CKZ)
+            {
+                zw = pix;
+            }
+        }
+
+        if (flags & ZM_WRITE)
+        {
+            _mm_storeu_si128((__m128i *)(zb + k), _mm_or_si128(_mm_and_si128(zw, zv), _mm_andnot_si128(zw, zbv)));
+        }
+
+        __m128i m = _mm_packs_epi16(pix, pix);
+        __m128i d = _mm_loadl_epi64((const __m128i *)(dst + k));
+        __m128i c = _mm_loadl_epi64((const __m128i *)(col + k));
+        _mm_storel_epi64((__m128i *)(dst + k), _mm_or_si128(_mm_and_si128(m, c), _mm_andnot_si128(m, d)));
+    }
+#elif defined(POLYFILL_NEON)
+    for (; k + 8 <= n; k += 8)
+    {
+        uint16x8_t zv = vld1q_u16(z + k);
+        uint16x8_t zbv = vld1q_u16(zb + k);
+        uint16x8_t pass = vcleq_u16(zv, zbv);
+        uint16x8_t pix = pass, zw = pass;
+
+        if (flags & ZM_CK)
+        {
+            uint16x8_t ck = vceqq_u16(vmovl_u8(vld1_u8(tex + k)), vdupq_n_u16(0));
+            pix = vbicq_u16(pix, ck);
+            if (flags & ZM_CKZ)
+            {
+                zw = pix;
+            }
+        }
+
+        if (flags & ZM_WRITE)
+        {
+            vst1q_u16(zb + k, vbslq_u16(zw, zv, zbv));
+        }
+
+        vst1_u8(dst + k, vbsl_u8(vmovn_u16(pix), vld1_u8(col + k), vld1_u8(dst + k)));
+    }
+#endif
+
+    for (; k < n; k++)
+    {
+        int key = (flags & ZM_CK) && !tex[k];
+
+        if (key && (flags & ZM_CKZ))
+        {
+            continue;
+        }
+        if (zb[k] < z[k])
+        {
+            continue;
+        }
+        if (flags & ZM_WRITE)
+        {
+            zb[k] = z[k];
+        }
+        if (!key)
+        {
+            dst[k] = col[k];
+        }
+    }
+}
+
+// Pixels of col, but the ones of texel 0 with ck
+static void span_write(unsigned char *dst, const unsigned char *col, const unsigned char *tex, int n, int ck)
+{
+    if (!ck)
+    {
+        memcpy(dst, col, n);
+        return;
+    }
+
+    int k = 0;
+
+#if defined(POLYFILL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; k + 16 <= n; k += 16)
+    {
+        __m128i key = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(tex + k)), zero);
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + k));
+        __m128i c = _mm_loadu_si128((const __m128i *)(col + k));
+        _mm_storeu_si128((__m128i *)(dst + k), _mm_or_si128(_mm_and_si128(key, d), _mm_andnot_si128(key, c)));
+    }
+#elif defined(POLYFILL_NEON)
+    for (; k + 16 <= n; k += 16)
+    {
+        uint8x16_t key = vceqq_u8(vld1q_u8(tex + k), vdupq_n_u8(0));
+        vst1q_u8(dst + k, vbslq_u8(key, vld1q_u8(dst + k), vld1q_u8(col + k)));
+    }
+#endif
+
+    for (; k < n; k++)
+    {
+        if (tex[k])
+        {
+            dst[k] = col[k];
+        }
+    }
+}
+
+// Filler_Transparent: (dst & 0x0F) | color
+static void span_trans(unsigned char *dst, unsigned char c, int n)
+{
+    int k = 0;
+
+#if defined(POLYFILL_SSE2)
+    const __m128i lo = _mm_set1_epi8(0x0F), cv = _mm_set1_epi8((char)c);
+
+    for (; k + 16 <= n; k += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + k));
+        _mm_storeu_si128((__m128i *)(dst + k), _mm_or_si128(_mm_and_si128(d, lo), cv));
+    }
+#elif defined(POLYFILL_NEON)
+    const uint8x16_t lo = vdupq_n_u8(0x0F), cv = vdupq_n_u8(c);
+
+    for (; k + 16 <= n; k += 16)
+    {
+        vst1q_u8(dst + k, vorrq_u8(vandq_u8(vld1q_u8(dst + k), lo), cv));
+    }
+#endif
+
+    for (; k < n; k++)
+    {
+        dst[k] = (unsigned char)((dst[k] & 0x0F) | c);
+    }
+}
+
+// The color of each texel
+static void texel_colors(unsigned char *col, const unsigned char *tex, int n, const fill_state *st)
+{
+    switch (st->op)
+    {
+    case OP_SOLID:
+        memcpy(col, tex, n);
+        break;
+    case OP_FLAT:
+        for (int k = 0; k < n; k++)
+        {
+            col[k] = st->table[tex[k]];
+        }
+        break;
+    default:
+        for (int k = 0; k < n; k++)
+        {
+            col[k] = st->ctx->palette[tex[k]];
+        }
+        break;
+    }
+}
+
+static void texels(unsigned char *tex, const unsigned short *idx, int n, const unsigned char *map)
+{
+    for (int k = 0; k < n; k++)
+    {
+        tex[k] = map[idx[k]];
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The scanlines of the fillers: dst and zb at XMin, count pixels, frac the
+// fraction of XMin for the prestep.
+
+struct scanline
+{
+    unsigned char *dst;
+    unsigned short *zb;
+    int count;
+    uint32_t frac;
+};
+
+static void line_flat(fill_state *st, const scanline *l)
+{
+    unsigned char c = (unsigned char)st->color;
+
+    if (!st->zmode)
+    {
+        if (st->filler == F_TRANS)
+        {
+            span_trans(l->dst, c, l->count);
+        }
+        else
+        {
+            memset(l->dst, c, l->count);
+        }
+        return;
+    }
+
+    unsigned short z[CHUNK];
+    unsigned char col[CHUNK];
+    int flags = st->zmode == 1 ? ZM_WRITE : 0;
+
+    for (int x = 0; x < l->count; x += CHUNK)
+    {
+        int n = l->count - x < CHUNK ? l->count - x : CHUNK;
+
+        span_z(z, st->z + x * st->zxs, st->zxs, n);
+        if (st->filler == F_TRANS)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                col[k] = (unsigned char)((l->dst[x + k] & 0x0F) | c);
+            }
+        }
+        else
+        {
+            memset(col, c, n);
+        }
+        span_zmerge(l->dst + x, l->zb + x, z, col, 0, n, flags);
+    }
+}
+
+// Filler_Trame: every other pixel, starting on the parity of the address
+// and of the line
+static void line_trame(fill_state *st, const scanline *l)
+{
+    int n = l->count >> 1;
+
+    if (!n)
+    {
+        return;
+    }
+
+    st->parity ^= 1;
+    int start = (int)(((uintptr_t)l->dst & 1) ^ st->parity);
+    unsigned char c = (unsigned char)st->color;
+
+    if (!st->zmode)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            l->dst[start + 2 * k] = c;
+        }
+        return;
+    }
+
+    // the zbuffer values go by 2 pixels, from the first pixel of the line
+    uint32_t zs2 = 2 * st->zxs;
+    for (int k = 0; k < n; k++)
+    {
+        int j = (n & 1) ? k >> 1 : (k + 1) >> 1;
+        unsigned short z = (unsigned short)((st->z + j * zs2) >> 8);
+        unsigned short *zb = l->zb + start + 2 * k;
+
+        if (*zb >= z)
+        {
+            if (st->zmode == 1)
+            {
+                *zb = z;
+            }
+            l->dst[start + 2 * k] = c;
+        }
+    }
+}
+
+// Filler_FlagZBuffer: clears IsPolygonHidden when a pixel would be seen
+static void line_flag(fill_state *st, const scanline *l)
+{
+    if (!l->zb || !st->ctx->hidden)
+    {
+        return;
+    }
+
+    unsigned short z[CHUNK];
+
+    for (int x = 0; x < l->count; x += CHUNK)
+    {
+        int n = l->count - x < CHUNK ? l->count - x : CHUNK;
+
+        span_z(z, st->z + x * st->zxs, st->zxs, n);
+        for (int k = 0; k < n; k++)
+        {
+            if (l->zb[x + k] >= z[k])
+            {
+                st->ctx->hidden = 0;
+                return;
+            }
+        }
+    }
+}
+
+static void gouraud_colors(unsigned char *col, const unsigned char *b, int n, const fill_state *st)
+{
+    switch (st->op)
+    {
+    case OP_SOLID:
+        memcpy(col, b, n);
+        break;
+    case OP_TABLE:
+        for (int k = 0; k < n; k++)
+        {
+            col[k] = st->table[b[k] << 8];
+        }
+        break;
+    default:
+        for (int k = 0; k < n; k++)
+        {
+            col[k] = st->ctx->palette[b[k]];
+        }
+        break;
+    }
+}
+
+static void line_gouraud(fill_state *st, const scanline *l)
+{
+    uint32_t g = st->g;
+
+    if (l->count > 16)
+    {
+        g += prestep(st->gxs, l->frac);
+    }
+
+    unsigned char b[CHUNK], col[CHUNK];
+    unsigned short z[CHUNK];
+    int flags = st->zmode == 1 ? ZM_WRITE : 0;
+
+    for (int x = 0; x < l->count; x += CHUNK)
+    {
+        int n = l->count - x < CHUNK ? l->count - x : CHUNK;
+
+        span_gouraud(b, g + x * st->gxs, st->gxs, n);
+        if (!st->zmode)
+        {
+            gouraud_colors(l->dst + x, b, n, st);
+            continue;
+        }
+        gouraud_colors(col, b, n, st);
+        span_z(z, st->z + x * st->zxs, st->zxs, n);
+        span_zmerge(l->dst + x, l->zb + x, z, col, 0, n, flags);
+    }
+}
+
+// Dithered gouraud bytes (ah of the error accumulator): the low byte is
+// carried from pixel to pixel and rotated after each pair, at places that
+// differ between the fillers.
+enum
+{
+    DITHER_A, // Filler_Dither, DitherFog, DitherZBuf, DitherNZW
+    DITHER_B, // Filler_DitherTable
+    DITHER_C  // DitherTableZBuf/NZW, DitherFogZBuf/NZW
+};
+
+static void dither_bytes(unsigned char *out, uint32_t d, uint32_t ds, int n, int pattern)
+{
+    int pairs = n >> 1, odd = n & 1, k = 0;
+    uint32_t a, cl;
+
+    switch (pattern)
+    {
+    case DITHER_A:
+        a = d & 0xFF;
+        if (odd && pairs)
+        {
+            a = rol8(a, pairs);
+        }
+        for (cl = pairs; cl > 0; cl--)
+        {
+            a = (a & 0xFF) + d;
+            d += ds;
+            out[k++] = (unsigned char)(a >> 8);
+            a = (a & 0xFF) + d;
+            d += ds;
+            out[k++] = (unsigned char)(a >> 8);
+            a = rol8(a, cl);
+        }
+        if (odd)
+        {
+            a = (a & 0xFF) + d;
+            out[k++] = (unsigned char)(a >> 8);
+        }
+        break;
+
+    case DITHER_B:
+        a = (d & 0xFF) + d;
+        if (odd && pairs)
+        {
+            a = (a & ~0xFFu) | rol8(a, pairs);
+        }
+        for (cl = pairs; cl > 0; cl--)
+        {
+            out[k++] = (unsigned char)(a >> 8);
+            d += ds;
+            a = (a & 0xFF) + d;
+            d += ds;
+            out[k++] = (unsigned char)(a >> 8);
+            a = rol8(a, cl) + d;
+        }
+        if (odd)
+        {
+            out[k++] = (unsigned char)(a >> 8);
+        }
+        break;
+
+    default:
+    {
+        a = (d & 0xFF) + d;
+        uint32_t idx = a >> 8;
+        if (odd && pairs)
+        {
+            a = (a & ~0xFFu) | rol8(a, pairs);
+        }
+        for (cl = pairs; cl > 0; cl--)
+        {
+            out[k++] = (unsigned char)idx;
+            d += ds;
+            a = (a & 0xFF) + d;
+            out[k++] = (unsigned char)(a >> 8);
+            d += ds;
+            a = (a & 0xFF) + d;
+            idx = a >> 8;
+            a = (a & ~0xFFu) | rol8(a, cl);
+        }
+        if (odd)
+        {
+            out[k++] = (unsigned char)idx;
+        }
+        break;
+    }
+    }
+}
+
+static void line_dither(fill_state *st, const scanline *l)
+{
+    int n = l->count;
+    int pattern = DITHER_A;
+
+    if (st->zmode)
+    {
+        pattern = st->op == OP_SOLID ? DITHER_A : DITHER_C;
+    }
+    else if (st->op == OP_TABLE)
+    {
+        pattern = DITHER_B;
+    }
+
+    // spans are at most the clip width, taken whole for the error carry
+    unsigned char sb[1024], scol[1024];
+    unsigned short sz[1024];
+    unsigned char *b = n <= 1024 ? sb : new unsigned char[n];
+    unsigned char *col = n <= 1024 ? scol : new unsigned char[n];
+    unsigned short *z = n <= 1024 ? sz : new unsigned short[n];
+
+    dither_bytes(b, (uint32_t)((int32_t)st->g >> 8), (uint32_t)(st->gxs >> 8), n, pattern);
+
+    if (!st->zmode)
+    {
+        gouraud_colors(l->dst, b, n, st);
+    }
+    else
+    {
+        gouraud_colors(col, b, n, st);
+
+        if (st->op == OP_FOG)
+        {
+            // Filler_DitherFogZBuf: z carried in the high byte of the gouraud
+            uint32_t s = ((st->g >> 8) & 0xFFFF) | (st->z << 24), zi = st->z >> 8;
+            uint32_t stepc = ((uint32_t)(st->gxs >> 8) & 0xFFFF) | ((uint32_t)st->zxs << 24);
+            uint32_t zstep = (uint32_t)st->zxs >> 8;
+
+            for (int k = 0; k < n; k++)
+            {
+                z[k] = (unsigned short)zi;
+                uint32_t t = s + stepc;
+                zi += zstep + (t < s);
+                s = t;
+            }
+        }
+        else
+        {
+            span_z(z, st->z, st->zxs, n);
+        }
+
+        if (st->zmode == 2 && st->op != OP_FOG)
+        {
+            // Filler_DitherNZW and DitherTableNZW test the second pixel of
+            // each pair on the zbuffer of the first one
+            for (int k = 0; k < n; k++)
+            {
+                int zk = (k < (n & ~1) && (k & 1)) ? k - 1 : k;
+                if (l->zb[zk] >= z[k])
+                {
+                    l->dst[k] = col[k];
+                }
+            }
+        }
+        else
+        {
+            span_zmerge(l->dst, l->zb, z, col, 0, n, st->zmode == 1 ? ZM_WRITE : 0);
+        }
+    }
+
+    if (b != sb)
+    {
+        delete[] b;
+        delete[] col;
+        delete[] z;
+    }
+}
+
+static void line_texture(fill_state *st, const scanline *l)
+{
+    uint32_t u = st->u, v = st->v;
+
+    if (l->count > 16)
+    {
+        u += prestep(st->uxs, l->frac);
+        v += prestep(st->vxs, l->frac);
+    }
+
+    const unsigned char *map = st->ctx->map;
+    uint32_t mask = st->ctx->repmask;
+
+    if (st->zmode && st->op != OP_SOLID)
+    {
+        // Filler_TextureFlatZBuf, FogZBuf and their chroma key: z carried
+        // in the low word of the U fraction
+        uint32_t edx = ((st->z >> 8) & 0xFFFF) | (u << 16), esi = st->z << 24, ebp = v << 16;
+        uint32_t zlo = (uint32_t)st->zxs << 24, zhi = ((uint32_t)st->zxs >> 8) & 0xFFFF;
+        uint32_t ustep = ((uint32_t)st->uxs << 16) | zhi, vstep = (uint32_t)st->vxs << 16;
+        uint32_t ui = (st->uxs >> 16) & 0xFF, vi = (st->vxs >> 16) & 0xFF;
+        uint32_t e = (((u >> 16) & 0xFF) | (((v >> 16) & 0xFF) << 8)) & mask;
+        uint32_t al = e & 0xFF, ah = (e >> 8) & 0xFF;
+
+        for (int k = 0; k < l->count; k++)
+        {
+            unsigned short z = (unsigned short)edx;
+            unsigned short *zb = l->zb + k;
+
+            if (*zb >= z)
+            {
+                unsigned char t = map[al | (ah << 8)];
+                if (!st->ck || t)
+                {
+                    if (st->zmode == 1)
+                    {
+                        *zb = z;
+                    }
+                    l->dst[k] = st->op == OP_FLAT ? st->table[t] : st->ctx->palette[t];
+                }
+            }
+
+            uint32_t f = esi + zlo;
+            uint32_t c = f < esi;
+            esi = f;
+            uint64_t s = (uint64_t)edx + ustep + c;
+            edx = (uint32_t)s;
+            al += ui + (uint32_t)(s >> 32);
+            f = ebp + vstep;
+            ah += vi + (f < ebp);
+            ebp = f;
+            e = ((al & 0xFF) | ((ah & 0xFF) << 8)) & mask;
+            al = e & 0xFF;
+            ah = (e >> 8) & 0xFF;
+        }
+        return;
+    }
+
+    affine a;
+    unsigned short idx[CHUNK], z[CHUNK];
+    unsigned char tex[CHUNK], col[CHUNK];
+
+    affine_init(&a, u, v, st->uxs, st->vxs, mask);
+
+    for (int x = 0; x < l->count; x += CHUNK)
+    {
+        int n = l->count - x < CHUNK ? l->count - x : CHUNK;
+
+        span_affine(idx, &a, n);
+        texels(tex, idx, n, map);
+        texel_colors(col, tex, n, st);
+
+        if (!st->zmode)
+        {
+            span_write(l->dst + x, col, tex, n, st->ck);
+            continue;
+        }
+
+        // Filler_TextureZBuf: z written before the chroma key test
+        span_z(z, st->z + x * st->zxs, st->zxs, n);
+        span_zmerge(l->dst + x, l->zb + x, z, col, tex, n, (st->zmode == 1 ? ZM_WRITE : 0) | (st->ck ? ZM_CK : 0));
+    }
+}
+
+// Filler_TextureGouraud (POLYGTEX.ASM): the V fraction shares edx with the
+// gouraud, and with the zbuffer in the ZBuf fillers
+static void line_texgouraud(fill_state *st, const scanline *l)
+{
+    uint32_t u = st->u, v = st->v, g = st->g;
+    int dither = st->filler == F_TEXD;
+
+    if (l->count > 16)
+    {
+        u += prestep(st->uxs, l->frac);
+        v += prestep(st->vxs, l->frac);
+        if (!dither)
+        {
+            g += prestep(st->gxs, l->frac);
+        }
+    }
+
+    const unsigned char *map = st->ctx->map, *clut = st->ctx->clutgouraud;
+    uint32_t mask = st->ctx->repmask;
+    uint32_t e = (((u >> 16) & 0xFF) | (((v >> 16) & 0xFF) << 8)) & mask;
+    uint32_t al = e & 0xFF, ah = (e >> 8) & 0xFF;
+    uint32_t esi = u << 16, usf = (uint32_t)st->uxs << 16;
+    uint32_t ui = (st->uxs >> 16) & 0xFF, vi = (st->vxs >> 16) & 0xFF;
+    uint32_t gs = ((uint32_t)st->gxs >> 8) & 0xFFFF;
+
+    if (dither)
+    {
+        uint32_t ebp = (v << 16) | ((g >> 8) & 0xFFFF), stp = ((uint32_t)st->vxs << 16) | gs;
+        uint32_t dl = (g >> 8) & 0xFF, bh = (g >> 16) & 0xFF;
+
+        for (int k = 0; k < l->count; k++)
+        {
+            unsigned char t = map[al | (ah << 8)];
+            uint32_t f = esi + usf;
+            al += ui + (f < esi);
+            esi = f;
+            f = ebp + stp;
+            ah += vi + (f < ebp);
+            ebp = f;
+            if (!st->ck || t)
+            {
+                l->dst[k] = clut[(bh << 8) | t];
+            }
+            uint32_t acc = dl + (ebp & 0xFFFF);
+            bh = (acc >> 8) & 0xFF;
+            dl = acc & 0xFF;
+            e = ((al & 0xFF) | ((ah & 0xFF) << 8)) & mask;
+            al = e & 0xFF;
+            ah = (e >> 8) & 0xFF;
+        }
+        return;
+    }
+
+    if (!st->zmode)
+    {
+        uint32_t edx = ((g >> 8) & 0xFFFF) | (v << 16), stp = ((uint32_t)st->vxs << 16) | gs;
+        uint32_t bh = (edx >> 8) & 0xFF;
+
+        for (int k = 0; k < l->count; k++)
+        {
+            unsigned char t = map[al | (ah << 8)];
+            uint32_t f = esi + usf;
+            al += ui + (f < esi);
+            esi = f;
+            f = edx + stp;
+            ah += vi + (f < edx);
+            edx = f;
+            if (!st->ck || t)
+            {
+                l->dst[k] = clut[(bh << 8) | t];
+            }
+            bh = (edx >> 8) & 0xFF;
+            e = ((al & 0xFF) | ((ah & 0xFF) << 8)) & mask;
+            al = e & 0xFF;
+            ah = (e >> 8) & 0xFF;
+        }
+        return;
+    }
+
+    uint32_t ebp = (v << 16) | (st->z >> 8), edx = (g >> 8) | (st->z << 24);
+    uint32_t gstep = ((uint32_t)st->zxs << 24) | gs;
+    uint32_t vstep = ((uint32_t)st->vxs << 16) | ((uint32_t)st->zxs >> 8);
+    uint32_t bh = (edx >> 8) & 0xFF;
+
+    for (int k = 0; k < l->count; k++)
+    {
+        unsigned char t = map[al | (ah << 8)];
+        unsigned short z = (unsigned short)ebp;
+        unsigned short *zb = l->zb + k;
+
+        if ((!st->ck || t) && *zb >= z)
+        {
+            if (st->zmode == 1)
+            {
+                *zb = z;
+            }
+            l->dst[k] = clut[(bh << 8) | t];
+        }
+
+        uint32_t f = esi + usf;
+        al += ui + (f < esi);
+        esi = f;
+        f = edx + gstep;
+        uint32_t c = f < edx;
+        edx = f;
+        uint64_t s = (uint64_t)ebp + vstep + c;
+        ebp = (uint32_t)s;
+        ah += vi + (uint32_t)(s >> 32);
+        bh = (edx >> 8) & 0xFF;
+        e = ((al & 0xFF) | ((ah & 0xFF) << 8)) & mask;
+        al = e & 0xFF;
+        ah = (e >> 8) & 0xFF;
+    }
+}
+
+// Filler_TextureZ, TextureZGouraud and TextureZFogSmooth: U and V exact
+// every 2^shift pixels, linear between
+struct persp
+{
+    int32_t w, uow, vow, zow;
+    uint32_t u, v, z;
+};
+
+static void persp_next(persp *n, const persp *c, const fill_state *st, int shift, int fog)
+{
+    n->w = persp_w((int32_t)((uint32_t)c->w + ((uint32_t)st->wxs << shift)));
+    int32_t inv = persp_inv(n->w);
+    if (fog)
+    {
+        n->zow = (int32_t)((uint32_t)c->zow + ((uint32_t)st->zxs << shift));
+        n->z = persp_mul(n->zow, inv, 16);
+    }
+    n->uow = (int32_t)((uint32_t)c->uow + ((uint32_t)st->uxs << shift));
+    n->u = persp_mul(n->uow, inv, 24);
+    n->vow = (int32_t)((uint32_t)c->vow + ((uint32_t)st->vxs << shift));
+    n->v = persp_mul(n->vow, inv, 24);
+}
+
+static void line_texz(fill_state *st, const scanline *l)
+{
+    int fog = st->filler == F_TZF;
+    int shift = fog ? 5 : 4, block = 1 << shift;
+    persp c, nx = persp();
+
+    c.w = (int32_t)st->w;
+    c.uow = (int32_t)st->u;
+    c.vow = (int32_t)st->v;
+    c.zow = (int32_t)st->z;
+    if (l->count > block)
+    {
+        c.w += (int32_t)prestep(st->wxs, l->frac);
+        c.uow += (int32_t)prestep(st->uxs, l->frac);
+        c.vow += (int32_t)prestep(st->vxs, l->frac);
+    }
+
+    int32_t inv = persp_inv(persp_w(c.w));
+    c.u = persp_mul(c.uow, inv, 24);
+    c.v = persp_mul(c.vow, inv, 24);
+    c.z = fog ? persp_mul(c.zow, inv, 16) : 0;
+
+    const unsigned char *map = st->ctx->map, *clut = st->ctx->clutgouraud;
+    uint32_t mask = st->ctx->repmask;
+    int flags = (st->zmode == 1 ? ZM_WRITE : 0) | (st->ck ? ZM_CK | ZM_CKZ : 0);
+
+    // Filler_TextureZGouraudZBuf: gouraud and z carried together
+    uint32_t gz = (st->g >> 8) | (st->z << 24), zi = st->z >> 8;
+    uint32_t gzstep = (((uint32_t)st->gxs >> 8) & 0xFFFF) | ((uint32_t)st->zxs << 24);
+    uint32_t zstep = (uint32_t)st->zxs >> 8;
+
+    unsigned short idx[32], z[32];
+    unsigned char tex[32], col[32], b[32];
+
+    for (int x = 0, rem = l->count;; x += block, rem -= block)
+    {
+        persp_next(&nx, &c, st, shift, fog);
+
+        uint32_t du = (uint32_t)((int32_t)(nx.u - c.u) >> shift) & 0xFFFF;
+        uint32_t dv = (uint32_t)((int32_t)(nx.v - c.v) >> shift) << 16;
+        int n = rem < block ? rem : block;
+
+        span_persp(idx, (c.u & 0xFFFF) | (c.v << 16), du | dv, mask, n);
+        texels(tex, idx, n, map);
+
+        switch (st->filler)
+        {
+        case F_TZ:
+            texel_colors(col, tex, n, st);
+            if (st->zmode)
+            {
+                span_z(z, st->z + x * st->zxs, st->zxs, n);
+            }
+            break;
+
+        case F_TZG:
+            if (!st->zmode)
+            {
+                span_gouraud(b, st->g + x * st->gxs, st->gxs, n);
+            }
+            else
+            {
+                for (int k = 0; k < n; k++)
+                {
+                    b[k] = (unsigned char)(gz >> 8);
+                    z[k] = (unsigned short)zi;
+                    uint32_t f = gz + gzstep;
+                    zi += zstep + (f < gz);
+                    gz = f;
+                }
+            }
+            for (int k = 0; k < n; k++)
+            {
+                col[k] = clut[(b[k] << 8) | tex[k]];
+            }
+            break;
+
+        default:
+        {
+            // Filler_TextureZFogSmooth: fog table of the perspective z
+            int32_t f = (int32_t)((uint32_t)c.z >> 8) - st->ctx->scaledfognear;
+            uint32_t fog_off = f < 0 ? 0 : (((uint32_t)f * (uint32_t)st->ctx->fogfactor) >> 8) & 0xF000;
+            const unsigned char *t = st->ctx->clutfog + 12 * 256 + fog_off;
+
+            for (int k = 0; k < n; k++)
+            {
+                col[k] = t[tex[k]];
+            }
+            if (st->zmode)
+            {
+                uint32_t s = (c.z >> 8) | (c.z << 24), zs = (uint32_t)st->zxs;
+                for (int k = 0; k < n; k++)
+                {
+                    z[k] = (unsigned short)s;
+                    uint64_t a = (uint64_t)s + (zs << 24);
+                    s = (uint32_t)((uint64_t)(uint32_t)a + ((zs >> 8) & 0xFFFF) + (a >> 32));
+                }
+            }
+            break;
+        }
+        }
+
+        if (!st->zmode)
+        {
+            span_write(l->dst + x, col, tex, n, st->ck);
+        }
+        else
+        {
+            span_zmerge(l->dst + x, l->zb + x, z, col, tex, n, flags);
+        }
+
+        if (rem <= block)
+        {
+            break;
+        }
+        c = nx;
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The scanline loop of every filler: dy + 1 lines, the first one of the
+// polygon without stepping (Fill_Patch)
+
+static void fill_lines(fill_state *st, int32_t dy)
+{
+    polyfill_context *ctx = st->ctx;
+    int lines = dy + 1;
+
+    st->cury += lines;
+
+    for (; lines > 0; lines--)
+    {
+        if (st->patch)
+        {
+            st->patch = 0;
+        }
+        else
+        {
+            st->xmin += st->leftslope;
+            st->xmax += st->rightslope;
+            st->offline += ctx->pitch;
+            if (st->attrs & A_G)
+                st->g += st->gls;
+            if (st->attrs & A_U)
+                st->u += st->uls;
+            if (st->attrs & A_V)
+                st->v += st->vls;
+            if (st->attrs & A_W)
+                st->w += st->wls;
+            if (st->attrs & A_Z)
+                st->z += st->zls;
+        }
+
+        uint32_t xs = st->xmin >> 16;
+        int32_t count = (int32_t)((st->xmax >> 16) - xs);
+        if (count <= 0)
+        {
+            continue;
+        }
+
+        scanline l;
+        l.dst = ctx->log + st->offline + xs;
+        l.zb = ctx->zbuffer ? ctx->zbuffer + st->offline + xs : 0;
+        l.count = count;
+        l.frac = (st->xmin & 0xFFFF) ^ 0xFFFF;
+
+        if (st->zmode && !l.zb)
+        {
+            continue;
+        }
+
+        switch (st->filler)
+        {
+        case F_FLAT:
+        case F_TRANS:
+            line_flat(st, &l);
+            break;
+        case F_TRAME:
+            line_trame(st, &l);
+            break;
+        case F_FLAG:
+            line_flag(st, &l);
+            break;
+        case F_GOURAUD:
+            line_gouraud(st, &l);
+            break;
+        case F_DITHER:
+            line_dither(st, &l);
+            break;
+        case F_TEX:
+            line_texture(st, &l);
+            break;
+        case F_TEXG:
+        case F_TEXD:
+            line_texgouraud(st, &l);
+            break;
+        default:
+            line_texz(st, &l);
+            break;
+        }
+    }
+
+    if (st->filler == F_TRAME)
+    {
+        st->parity ^= 1;
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Calc_*XSlope: the slopes along X, from the top point a and the next two
+
+// (dc * YB_YA - db * YC_YA) / Denom
+static int32_t xslope(const fill_state *st, int32_t db, int32_t dc)
+{
+    return chop(idiv64((int64_t)dc * st->yb_ya - (int64_t)db * st->yc_ya, st->denom));
+}
+
+static int32_t xslope16(const fill_state *st, unsigned a, unsigned b, unsigned c)
+{
+    return xslope(st, (int32_t)(b - a) << 8, (int32_t)(c - a) << 8);
+}
+
+static unsigned short dither_sat(unsigned short *l, unsigned up)
+{
+    if (*l >= up)
+    {
+        *l = 14 * 256 - 1;
+    }
+    else if (*l <= 255)
+    {
+        *l = 256;
+    }
+    return *l;
+}
+
+static int32_t texz_xslope(const fill_state *st, int32_t a, int32_t b, int32_t c)
+{
+    return xslope(st, b - a, c - a);
+}
+
+static void calc_xslope(fill_state *st, polyfill_point *a, polyfill_point *b, polyfill_point *c)
+{
+    int kind = XSlope_Type[st->type];
+    int small = st->denom < 16 && st->denom > -16;
+
+    if ((Bank_Flags[st->ctx->bank] & (BANK_ZBUF | BANK_NZW)) && st->type < 24)
+    {
+        st->zxs = xslope16(st, a->zo, b->zo, c->zo);
+    }
+
+    switch (kind)
+    {
+    case XS_GOURAUD:
+        st->gxs = xslope16(st, a->light, b->light, c->light);
+        break;
+
+    case XS_DITHER:
+    case XS_TEXDITHER:
+    {
+        // the lights are saturated in the points
+        unsigned lb = dither_sat(&b->light, kind == XS_TEXDITHER ? 14 * 256 + 1 : 14 * 256);
+        unsigned la = dither_sat(&a->light, 14 * 256);
+        unsigned lc = dither_sat(&c->light, 14 * 256);
+        st->gxs = xslope16(st, la, lb, lc);
+        if (kind == XS_TEXDITHER)
+        {
+            st->uxs = xslope16(st, a->u, b->u, c->u);
+            st->vxs = xslope16(st, a->v, b->v, c->v);
+        }
+        break;
+    }
+
+    case XS_TEXGOURAUD:
+        st->gxs = xslope16(st, a->light, b->light, c->light);
+        // fall through
+    case XS_TEXTURE:
+        st->uxs = xslope16(st, a->u, b->u, c->u);
+        st->vxs = xslope16(st, a->v, b->v, c->v);
+        break;
+
+    case XS_TEXZGOURAUD:
+    case XS_TEXZ:
+        if (small)
+        {
+            st->uxs = st->vxs = st->wxs = 0;
+            if (kind == XS_TEXZGOURAUD)
+            {
+                st->gxs = 0;
+            }
+            break;
+        }
+        if (kind == XS_TEXZGOURAUD)
+        {
+            st->gxs = xslope16(st, a->light, b->light, c->light);
+        }
+        st->uxs = texz_xslope(st, chop(mul_w(a->u, a->w)), chop(mul_w(b->u, b->w)), chop(mul_w(c->u, c->w)));
+        st->vxs = texz_xslope(st, chop(mul_w(a->v, a->w)), chop(mul_w(b->v, b->w)), chop(mul_w(c->v, c->w)));
+        st->wxs = texz_xslope(st, (int32_t)a->w, (int32_t)b->w, (int32_t)c->w);
+        break;
+
+    case XS_TEXZZBUF:
+        if (small)
+        {
+            st->uxs = st->vxs = st->wxs = st->zxs = 0;
+            break;
+        }
+        // the roundings of Calc_TextureZXSlopeZBuf, as they are
+        st->uxs = texz_xslope(st, chop(mul_w(a->u, a->w)), chop(mul_w(b->u, b->w)), chop(mul_w(c->u, c->w)));
+        st->vxs = texz_xslope(st, mul_w(a->v, a->w), chop(mul_w(b->v, b->w)), chop(mul_w(c->v, c->w)));
+        st->zxs = texz_xslope(st, chop(mul_w(a->zo, a->w)), mul_w(b->zo, b->w), chop(mul_w(c->zo, c->w)));
+        st->wxs = texz_xslope(st, (int32_t)a->w, (int32_t)b->w, (int32_t)c->w);
+        break;
+
+    case XS_ZBUF:
+        st->zxs = xslope16(st, a->zo, b->zo, c->zo);
+        break;
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Calc_*LeftSlope: the attributes along the left edge, from o to n
+
+static int32_t lslope(int32_t d, uint32_t dy)
+{
+    return chop(idiv64((int64_t)d << 8, (int32_t)dy));
+}
+
+static int32_t lslope_z(int32_t d, uint32_t dy)
+{
+    return chop(idiv64(d, (int32_t)dy));
+}
+
+static void left_gouraud(fill_state *st, const polyfill_point *n, const polyfill_point *o, uint32_t dy, uint32_t color)
+{
+    st->gls = lslope((int32_t)n->light - (int32_t)o->light, dy);
+    st->g = ((uint32_t)(o->light + 0x80) << 8) + color;
+}
+
+static void left_texture(fill_state *st, const polyfill_point *n, const polyfill_point *o, uint32_t dy)
+{
+    st->uls = lslope((int32_t)n->u - (int32_t)o->u, dy);
+    st->u = (uint32_t)o->u << 8;
+    st->vls = lslope((int32_t)n->v - (int32_t)o->v, dy);
+    st->v = (uint32_t)o->v << 8;
+}
+
+static void left_texz(fill_state *st, const polyfill_point *n, const polyfill_point *o, uint32_t dy, int zbuf)
+{
+    int32_t a = chop(mul_w(n->u, n->w)), b = chop(mul_w(o->u, o->w));
+    st->uls = lslope_z(a - b, dy);
+    st->u = (uint32_t)b;
+    a = chop(mul_w(n->v, n->w));
+    b = chop(mul_w(o->v, o->w));
+    st->vls = lslope_z(a - b, dy);
+    st->v = (uint32_t)b;
+    if (zbuf)
+    {
+        a = chop(mul_w(n->zo, n->w));
+        b = chop(mul_w(o->zo, o->w));
+        st->zls = lslope_z(a - b, dy);
+        st->z = (uint32_t)b;
+    }
+    st->wls = lslope_z((int32_t)(n->w - o->w), dy);
+    st->w = o->w;
+}
+
+static void calc_leftslope(fill_state *st, const polyfill_point *n, const polyfill_point *o, uint32_t dy)
+{
+    if ((Bank_Flags[st->ctx->bank] & (BANK_ZBUF | BANK_NZW)) && st->type < 24)
+    {
+        st->zls = lslope((int32_t)n->zo - (int32_t)o->zo, dy);
+        st->z = (uint32_t)o->zo << 8;
+    }
+
+    switch (LeftSlope_Type[st->type])
+    {
+    case LS_GOURAUD:
+        left_gouraud(st, n, o, dy, st->color);
+        break;
+    case LS_GOURAUDTABLE:
+        left_gouraud(st, n, o, dy, 0);
+        break;
+    case LS_TEXGOURAUD:
+        left_gouraud(st, n, o, dy, 0);
+        left_texture(st, n, o, dy);
+        break;
+    case LS_TEXTURE:
+        left_texture(st, n, o, dy);
+        break;
+    case LS_TEXZGOURAUD:
+        left_gouraud(st, n, o, dy, 0);
+        left_texz(st, n, o, dy, 0);
+        break;
+    case LS_TEXZ:
+        left_texz(st, n, o, dy, 0);
+        break;
+    case LS_TEXZZBUF:
+        left_texz(st, n, o, dy, 1);
+        break;
+    case LS_ZBUF:
+        st->zls = lslope((int32_t)n->zo - (int32_t)o->zo, dy);
+        st->z = (uint32_t)o->zo << 8;
+        break;
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Draw_Triangle
+
+static polyfill_point *next_point(const fill_state *st, polyfill_point *p)
+{
+    return p + 1 > st->last ? st->first : p + 1;
+}
+
+static polyfill_point *prev_point(const fill_state *st, polyfill_point *p)
+{
+    return p - 1 < st->first ? st->last : p - 1;
+}
+
+// The next edge going down, 0 at the end of the polygon
+static int read_edge(fill_state *st, int left)
+{
+    polyfill_point *n = left ? st->leftp : st->rightp, *o;
+    int32_t dys;
+    int guard = 3;
+
+    do
+    {
+        o = n;
+        n = left ? next_point(st, o) : prev_point(st, o);
+        dys = (int32_t)((dw(n) & 0xFFFF0000) - (dw(o) & 0xFFFF0000));
+    } while (!dys && --guard);
+
+    if (dys <= 0)
+    {
+        return 0;
+    }
+
+    uint32_t dy = (uint32_t)dys >> 16;
+    uint32_t x = (dw(o) << 16) + 0x8000;
+    int32_t slope = idiv64((int32_t)((dw(n) << 16) - (dw(o) << 16)), (int32_t)dy) | 1;
+
+    if (left)
+    {
+        st->xmin = x;
+        st->leftp = n;
+        st->leftslope = slope;
+        calc_leftslope(st, n, o, dy);
+    }
+    else
+    {
+        st->xmax = x;
+        st->rightp = n;
+        st->rightslope = slope;
+    }
+    return 1;
+}
+
+static void draw_triangle(fill_state *st, polyfill_point *p)
+{
+    st->patch = 1;
+    st->first = p;
+
+    polyfill_point *top = p;
+    int ymin = p[0].y;
+    if (p[1].y <= ymin)
+    {
+        ymin = p[1].y;
+        top = p + 1;
+    }
+    if (p[2].y <= ymin)
+    {
+        ymin = p[2].y;
+        top = p + 2;
+    }
+    st->leftp = st->rightp = top;
+
+    if (p[0].y == p[1].y && p[1].y == p[2].y)
+    {
+        return;
+    }
+
+    st->last = p + 2;
+    st->cury = ymin;
+    st->offline = (intptr_t)ymin * st->ctx->pitch;
+    st->readflag = READ_L | READ_R;
+
+    polyfill_point *a = top, *b = next_point(st, a), *c = next_point(st, b);
+
+    st->yb_ya = b->y - a->y;
+    st->yc_ya = c->y - a->y;
+    st->denom = (int32_t)((uint32_t)(st->yb_ya * ((int32_t)(uint16_t)c->x - (int32_t)(uint16_t)a->x)) -
+                          (uint32_t)(st->yc_ya * ((int32_t)(uint16_t)b->x - (int32_t)(uint16_t)a->x)));
+    if (!st->denom)
+    {
+        return;
+    }
+
+    calc_xslope(st, a, b, c);
+
+    for (;;)
+    {
+        if (st->readflag & READ_L)
+        {
+            st->readflag &= ~READ_L;
+            if (!read_edge(st, 1))
+            {
+                return;
+            }
+        }
+        if (st->readflag & READ_R)
+        {
+            st->readflag &= ~READ_R;
+            if (!read_edge(st, 0))
+            {
+                return;
+            }
+        }
+
+        int32_t ly = st->leftp->y, ry = st->rightp->y, dy;
+        if (ly < ry)
+        {
+            st->readflag = READ_L;
+            dy = ly - st->cury;
+        }
+        else if (ly > ry)
+        {
+            st->readflag = READ_R;
+            dy = ry - st->cury;
+        }
+        else
+        {
+            st->readflag = READ_L | READ_R;
+            dy = ly - st->cury;
+        }
+
+        if (!dy)
+        {
+            continue;
+        }
+        if (dy < 0) // the ASM would run 4G lines
+        {
+            return;
+        }
+        fill_lines(st, dy);
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Fill_PolyClip: Sutherland-Hodgman on the 4 sides, in the order of
+// M_FILL_CLIP, then a fan of triangles
+
+enum
+{
+    CLIP_XMIN,
+    CLIP_XMAX,
+    CLIP_YMIN,
+    CLIP_YMAX
+};
+
+// EnterClip: the attributes of d, between a (visible side) and b
+static void enter_clip(const fill_state *st, polyfill_point *d, const polyfill_point *a, const polyfill_point *b,
+                       int32_t num, int32_t den)
+{
+    int flag = st->clipflag;
+
+    if (flag & CLIP_LIGHT)
+    {
+        d->light = (unsigned short)(idiv64((int64_t)((int32_t)b->light - (int32_t)a->light) * num, den) + a->light);
+    }
+
+    if (flag & CLIP_TEXTURE)
+    {
+        d->u = (unsigned short)(idiv64((int64_t)((int32_t)b->u - (int32_t)a->u) * num, den) + a->u);
+        d->v = (unsigned short)(idiv64((int64_t)((int32_t)b->v - (int32_t)a->v) * num, den) + a->v);
+    }
+
+    if (flag & CLIP_TEXTUREZ)
+    {
+        d->w = (uint32_t)idiv64((int64_t)(int32_t)(b->w - a->w) * num, den) + a->w;
+
+        int32_t pa = mul_w(a->u, a->w), pb = mul_w(b->u, b->w);
+        int32_t p = (int32_t)((uint32_t)idiv64((int64_t)(int32_t)(pb - pa) * num, den) + (uint32_t)pa);
+        d->u = (unsigned short)idiv64((int64_t)p << 8, (int32_t)d->w);
+
+        pa = mul_w(a->v, a->w);
+        pb = mul_w(b->v, b->w);
+        p = (int32_t)((uint32_t)idiv64((int64_t)(int32_t)(pb - pa) * num, den) + (uint32_t)pa);
+        d->v = (unsigned short)idiv64((int64_t)p << 8, (int32_t)d->w);
+
+        if (flag & CLIP_ZBUFFER)
+        {
+            pa = mul_w(a->zo, a->w);
+            pb = mul_w(b->zo, b->w);
+            p = (int32_t)((uint32_t)idiv64((int64_t)(int32_t)(pb - pa) * num, den) + (uint32_t)pa);
+            d->zo = (unsigned short)idiv64((int64_t)p << 8, (int32_t)d->w);
+        }
+    }
+    else if (flag & CLIP_ZBUFFER)
+    {
+        d->zo = (unsigned short)(idiv64((int64_t)((int32_t)b->zo - (int32_t)a->zo) * num, den) + a->zo);
+    }
+}
+
+// Generic_Clip*: the point of the side between a and b
+static void clip_point(const fill_state *st, int side, polyfill_point *d, const polyfill_point *a,
+                       const polyfill_point *b)
+{
+    const polyfill_context *ctx = st->ctx;
+    uint32_t da = dw(a), db = dw(b);
+    int32_t num, den;
+
+    if (side == CLIP_XMIN || side == CLIP_XMAX)
+    {
+        int32_t clip = side == CLIP_XMIN ? ctx->clipxmin : ctx->clipxmax + 1;
+        num = clip - a->x;
+        den = b->x - a->x;
+        uint32_t y = ((uint32_t)idiv64((int64_t)(int32_t)((db & 0xFFFF0000) - (da & 0xFFFF0000)) * num, den) +
+                      (da & 0xFFFF0000)) &
+                     0xFFFF0000;
+        uint32_t x = side == CLIP_XMIN ? (uint32_t)ctx->clipxmin & 0xFFFF : ((uint32_t)ctx->clipxmax & 0xFFFF) + 1;
+        set_dw(d, y | x);
+    }
+    else
+    {
+        int32_t clip = side == CLIP_YMIN ? ctx->clipymin : ctx->clipymax;
+        num = clip - a->y;
+        den = b->y - a->y;
+        int32_t x = (idiv64((int64_t)(int32_t)((db << 16) - (da << 16)) * num, den) >> 16) + a->x;
+        set_dw(d, ((uint32_t)x & 0xFFFF) | ((uint32_t)clip << 16));
+    }
+
+    enter_clip(st, d, a, b, num, den);
+}
+
+static int clip_out(const polyfill_context *ctx, int side, const polyfill_point *p)
+{
+    switch (side)
+    {
+    case CLIP_XMIN:
+        return (int32_t)(dw(p) << 16) < (int32_t)((uint32_t)ctx->clipxmin << 16);
+    case CLIP_XMAX:
+        return (int32_t)(dw(p) << 16) > (int32_t)((uint32_t)(ctx->clipxmax + 1) << 16);
+    case CLIP_YMIN:
+        return (int32_t)(dw(p) & 0xFFFF0000) < (int32_t)((uint32_t)ctx->clipymin << 16);
+    default:
+        return (int32_t)(dw(p) & 0xFFFF0000) > (int32_t)((uint32_t)ctx->clipymax << 16);
+    }
+}
+
+// M_FILL_CLIP: nb points of src to dst, returns the new count
+static int clip_side(const fill_state *st, int side, polyfill_point *dst, const polyfill_point *src, int nb)
+{
+    const polyfill_point *prev = src + nb - 1;
+    int out = clip_out(st->ctx, side, prev), n = 0;
+
+    for (int i = 0; i < nb; i++)
+    {
+        const polyfill_point *cur = src + i;
+
+        if (n + 2 > MAX_POINTS)
+        {
+            return 0;
+        }
+
+        if (clip_out(st->ctx, side, cur))
+        {
+            if (!out)
+            {
+                memset(dst + n, 0, sizeof(*dst));
+                clip_point(st, side, dst + n++, cur, prev);
+                out = 1;
+            }
+        }
+        else
+        {
+            if (out)
+            {
+                memset(dst + n, 0, sizeof(*dst));
+                clip_point(st, side, dst + n++, cur, prev);
+            }
+            dst[n++] = *cur;
+            out = 0;
+        }
+        prev = cur;
+    }
+    return n;
+}
+
+static void fill_polyclip(fill_state *st, polyfill_point *p, int nb)
+{
+    static polyfill_point lists[4][MAX_POINTS];
+    const polyfill_context *ctx = st->ctx;
+
+    for (;;)
+    {
+        if (nb < 3)
+        {
+            return;
+        }
+
+        int32_t ymin = p[0].y, ymax = ymin, xmin = p[0].x, xmax = xmin;
+        for (int i = 1; i < nb; i++)
+        {
+            if (p[i].y < ymin)
+                ymin = p[i].y;
+            if (p[i].y > ymax)
+                ymax = p[i].y;
+            if (p[i].x < xmin)
+                xmin = p[i].x;
+            if (p[i].x > xmax)
+                xmax = p[i].x;
+        }
+
+        if (ymax <= ymin || xmin > ctx->clipxmax + 1 || xmax < ctx->clipxmin || ymin > ctx->clipymax ||
+            ymax < ctx->clipymin)
+        {
+            return;
+        }
+
+        int side;
+        if (xmin < ctx->clipxmin)
+            side = CLIP_XMIN;
+        else if (xmax > ctx->clipxmax + 1)
+            side = CLIP_XMAX;
+        else if (ymin < ctx->clipymin)
+            side = CLIP_YMIN;
+        else if (ymax > ctx->clipymax)
+            side = CLIP_YMAX;
+        else
+            break;
+
+        nb = clip_side(st, side, lists[side], p, nb);
+        p = lists[side];
+    }
+
+    while (nb > 3)
+    {
+        draw_triangle(st, p);
+        p[1] = p[0];
+        p++;
+        nb--;
+    }
+    draw_triangle(st, p);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Fill_Poly and the Jmp_* of POLY_JMP.ASM
+
+int polyfill_fill(polyfill_context *ctx, int type, int color, int nb, polyfill_point *pts)
+{
+    if (type < 0 || type > 25 || nb < 3 || nb > MAX_POINTS || ctx->bank < 0 || ctx->bank > 7)
+    {
+        return 0;
+    }
+
+    fill_state st;
+    memset(&st, 0, sizeof(st));
+    st.ctx = ctx;
+    st.type = type;
+
+    int bank = Bank_Flags[ctx->bank];
+    int fog = bank & BANK_FOG;
+    int zbank = (bank & (BANK_ZBUF | BANK_NZW)) != 0;
+    uint32_t c = (uint32_t)color & 0xFF;
+
+    st.zmode = (bank & BANK_ZBUF) ? 1 : (bank & BANK_NZW) ? 2 : 0;
+    st.op = OP_SOLID;
+
+    switch (type)
+    {
+    case 0:
+    case 1:
+        st.filler = F_FLAT;
+        st.color = fog ? ctx->palette[c] : c;
+        st.clipflag = CLIP_FLAT;
+        break;
+    case 2:
+        st.filler = F_TRANS;
+        st.color = c & 0xF0;
+        st.clipflag = CLIP_FLAT;
+        break;
+    case 3:
+        // Jmp_TrameFogZBuf and TrameFogNZW read Fill_Logical_Palette[0]
+        st.filler = F_TRAME;
+        st.color = fog ? ctx->palette[zbank ? 0 : c] : c;
+        st.clipflag = CLIP_FLAT;
+        break;
+    case 4:
+    case 5:
+        st.filler = type == 4 ? F_GOURAUD : F_DITHER;
+        st.op = fog ? OP_FOG : OP_SOLID;
+        st.color = c << 16;
+        st.clipflag = CLIP_FLAT | CLIP_LIGHT;
+        st.attrs = A_G;
+        break;
+    case 6:
+    case 7:
+        st.filler = type == 6 ? F_GOURAUD : F_DITHER;
+        st.op = OP_TABLE;
+        st.table = ctx->clutgouraud + c;
+        st.clipflag = CLIP_FLAT | CLIP_LIGHT;
+        st.attrs = A_G;
+        break;
+    case 8:
+    case 9:
+    case 12:
+    case 13:
+        st.filler = F_TEX;
+        st.ck = type >= 12;
+        st.op = (type & 1) ? OP_FLAT : fog ? OP_FOG : OP_SOLID;
+        st.table = ctx->clutgouraud + (c << 8);
+        st.clipflag = CLIP_FLAT | CLIP_TEXTURE;
+        st.attrs = A_U | A_V;
+        break;
+    case 10:
+    case 11:
+    case 14:
+    case 15:
+        st.filler = (type & 1) && !zbank ? F_TEXD : F_TEXG;
+        st.ck = type >= 14;
+        st.clipflag = CLIP_FLAT | CLIP_TEXTURE | CLIP_LIGHT;
+        st.attrs = A_G | A_U | A_V;
+        break;
+    case 16:
+    case 17:
+    case 20:
+    case 21:
+        st.filler = F_TZ;
+        st.ck = type >= 20;
+        st.op = (type & 1) ? OP_FLAT : fog ? OP_FOG : OP_SOLID;
+        st.table = ctx->clutgouraud + (c << 8);
+        st.clipflag = CLIP_FLAT | CLIP_TEXTUREZ;
+        st.attrs = A_U | A_V | A_W;
+        break;
+    case 18:
+    case 19:
+    case 22:
+    case 23:
+        st.filler = F_TZG;
+        st.ck = type >= 22;
+        st.clipflag = CLIP_FLAT | CLIP_TEXTUREZ | CLIP_LIGHT;
+        st.attrs = A_G | A_U | A_V | A_W;
+        break;
+    case 24:
+        st.filler = F_TZF;
+        st.clipflag = CLIP_FLAT | CLIP_TEXTUREZ | CLIP_ZBUFFER;
+        st.attrs = A_U | A_V | A_W | A_Z;
+        break;
+    default:
+        st.filler = F_FLAG;
+        st.zmode = 0;
+        st.clipflag = CLIP_FLAT | CLIP_ZBUFFER;
+        st.attrs = A_Z;
+        ctx->hidden = 1;
+        break;
+    }
+
+    if (zbank && type < 24)
+    {
+        st.clipflag |= CLIP_ZBUFFER;
+        st.attrs |= A_Z;
+    }
+
+    fill_polyclip(&st, pts, nb);
+    return st.leftslope;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// ClipperZ and Clipping_Z of POLYCLIP.ASM
+
+// (b - a) * factor (8.24), the low 32 bits of the product >> 24, plus a
+static inline uint32_t clipz_lerp(uint32_t a, uint32_t b, int32_t factor)
+{
+    return a + (uint32_t)(((int64_t)(int32_t)(b - a) * factor) >> 24);
+}
+
+// The vertex on the plane of the edge last -> cur
+static void clipz_vertex(polyfill_clipvertex *d, const polyfill_clipvertex *last, const polyfill_clipvertex *cur,
+                         int zclip)
+{
+    int32_t dz = (int32_t)((uint32_t)cur->z - (uint32_t)last->z);
+    int64_t num = (int64_t)(int32_t)((uint32_t)last->z - (uint32_t)zclip) * (1 << 24);
+    int32_t factor = (int32_t)(0u - (uint32_t)(num / dz)); // 2^24 * (ClipZ-LastZ) / (CurZ-LastZ)
+
+    d->z = zclip;
+    d->x = (int)clipz_lerp((uint32_t)last->x, (uint32_t)cur->x, factor);
+    d->y = (int)clipz_lerp((uint32_t)last->y, (uint32_t)cur->y, factor);
+    d->u = (unsigned short)clipz_lerp(last->u, cur->u, factor);
+    d->v = (unsigned short)clipz_lerp(last->v, cur->v, factor);
+    d->light = (unsigned short)clipz_lerp(last->light, cur->light, factor);
+    d->dummy = cur->dummy;
+}
+
+int polyfill_clipz(polyfill_clipvertex *dst, const polyfill_clipvertex *src, int nb, int zclip, int flag)
+{
+    if (nb <= 0)
+    {
+        return 0;
+    }
+
+    const polyfill_clipvertex *last = &src[nb - 1];
+    int n = 0;
+    int out = flag ? last->z > zclip : last->z < zclip; // last vertex in the wrong half-space
+
+    for (int i = 0; i < nb; i++)
+    {
+        const polyfill_clipvertex *cur = &src[i];
+
+        if (flag ? cur->z > zclip : cur->z < zclip)
+        {
+            if (!out)
+            {
+                clipz_vertex(&dst[n++], last, cur, zclip);
+                out = 1;
+            }
+        }
+        else
+        {
+            if (out)
+            {
+                clipz_vertex(&dst[n++], last, cur, zclip);
+                out = 0;
+            }
+            dst[n++] = *cur;
+        }
+        last = cur;
+    }
+
+    return n;
+}
@@ -0,0 +1,65 @@
+#ifndef __POLYFILL_H__
+#define __POLYFILL_H__
+
+// Portable polygon filler: Fill_Poly of LIB386/pol_work (POLY.ASM and the
+// POLY*.ASM fillers) in C++, for every Type_Poly (0 to 25) and every bank of
+// Switch_Fillers. The spans go through SSE2, AVX2 or NEON when available.
+//
+// The results are the ones of the integer path of the ASM fillers
+// (Fill_UseFPU FALSE): same clipping, same fixed point edge and slope
+// computations with their roundings, same per pixel stepping, dithering,
+// chroma key and zbuffer tests. The FPU slopes (x87, 64 bits mantissa, chop
+// rounding) are not reproduced: POLY.ASM is built with FORCE_INT so that the
+// polygons the ASM still draws round the same way.
+
+// Struc_Point of POLY.H
+struct polyfill_point
+{
+    short x, y;             // Pt_XE, Pt_YE
+    unsigned short u, v;    // Pt_MapU, Pt_MapV
+    unsigned short light;   // Pt_Light
+    unsigned short zo;      // Pt_ZO
+    unsigned int w;         // Pt_W
+};
+
+// The globals the fillers read (POLY.ASM, CLIP.H, LOGPHYS.H)
+struct polyfill_context
+{
+    unsigned char *log;                 // Log
+    int pitch;                          // TabOffLine[y] = y * pitch
+    unsigned short *zbuffer;            // PtrZBuffer, same offsets as log
+    int clipxmin, clipymin;             // ClipXMin, ClipYMin
+    int clipxmax, clipymax;             // ClipXMax, ClipYMax (inclusive)
+    const unsigned char *map;           // PtrMap, 256x256
+    unsigned int repmask;               // RepMask
+    const unsigned char *clutgouraud;   // PtrCLUTGouraud
+    const unsigned char *clutfog;       // PtrCLUTFog
+    unsigned char palette[256];         // Fill_Logical_Palette (SetCLUT)
+    int scaledfognear;                  // Fill_ScaledFogNear (SetFog)
+    int fogfactor;                      // Fill_Fog_Factor (SetFog)
+    int bank;                           // FILL_POLY_TEXTURES .. FILL_POLY_FOG_NZW
+    unsigned int hidden;                // IsPolygonHidden, cleared by the type 25 polygons
+};
+
+// STRUC_CLIPVERTEX of CLIPPERZ.H
+struct polyfill_clipvertex
+{
+    int x, y, z;            // V_X0, V_Y0, V_Z0
+    unsigned short u, v;    // V_MapU, V_MapV
+    unsigned short light;   // V_Light
+    unsigned short dummy;   // V_Dummy
+};
+
+// Fill_Poly: draws the polygon of nb points with the filler of type and the
+// bank of ctx. Like the ASM, the points may be changed (fan split of the
+// unclipped polygons, saturated lights of the dithered modes). Returns
+// Fill_LeftSlope, like Fill_Poly.
+int polyfill_fill(polyfill_context *ctx, int type, int color, int nb, polyfill_point *pts);
+
+// ClipperZ of POLYCLIP.ASM: clips the polygon of nb vertices of src by the
+// plane z = zclip and keeps the side z >= zclip (flag 0) or z <= zclip (flag
+// not 0). The new vertices are interpolated like Clipping_Z, the integer
+// version. Returns the number of vertices written to dst, 2 * nb at most.
+int polyfill_clipz(polyfill_clipvertex *dst, const polyfill_clipvertex *src, int nb, int zclip, int flag);
+
+#endif // __POLYFILL_H__
@@ -0,0 +1,79 @@
+#include "scale2x.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCALE2X_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SCALE2X_NEON
+#endif
+
+// one source line into the two destination lines
+static void scale2x_line(unsigned char *dst0, unsigned char *dst1, const unsigned char *src, int width)
+{
+    int x = 0;
+
+#if defined(SCALE2X_SSE2)
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i lo = _mm_unpacklo_epi8(p, p);  // p0 p0 p1 p1 ... p7 p7
+        __m128i hi = _mm_unpackhi_epi8(p, p);
+
+        _mm_storeu_si128((__m128i *)(dst0 + 2 * x), lo);
+        _mm_storeu_si128((__m128i *)(dst0 + 2 * x + 16), hi);
+        _mm_storeu_si128((__m128i *)(dst1 + 2 * x), lo);
+        _mm_storeu_si128((__m128i *)(dst1 + 2 * x + 16), hi);
+    }
+#elif defined(SCALE2X_NEON)
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t p = vld1q_u8(src + x);
+        uint8x16x2_t pp = {{p, p}};
+
+        // interleaved store: p0 p0 p1 p1 ...
+        vst2q_u8(dst0 + 2 * x, pp);
+        vst2q_u8(dst1 + 2 * x, pp);
+    }
+#endif
+
+    // scalar: 2 pixels (4 bytes) per store on the first line, then a copy of it
+    int start = x;
+    for (; x + 2 <= width; x += 2)
+    {
+        unsigned char quad[4] = {src[x], src[x], src[x + 1], src[x + 1]};
+        memcpy(dst0 + 2 * x, quad, 4);
+    }
+    for (; x < width; x++)
+    {
+        dst0[2 * x] = src[x];
+        dst0[2 * x + 1] = src[x];
+    }
+    memcpy(dst1 + 2 * start, dst0 + 2 * start, 2 * (width - start));
+}
+
+int scale2x(unsigned char *dst, int pitch, const unsigned char *src, unsigned char *prev, int width, int height)
+{
+    int written = 0;
+
+    for (int y = 0; y < height; y++, src += width, dst += 2 * pitch)
+    {
+        if (prev)
+        {
+            // an unchanged line is already on screen
+            if (!memcmp(prev, src, width))
+            {
+                prev += width;
+                continue;
+            }
+            memcpy(prev, src, width);
+            prev += width;
+        }
+
+        scale2x_line(dst, dst + pitch, src, width);
+        written++;
+    }
+    return written;
+}
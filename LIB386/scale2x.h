@@ -0,0 +1,13 @@
+#ifndef __SCALE2X_H__
+#define __SCALE2X_H__
+
+// 2x nearest neighbour upscale of an 8 bits image (videos): each pixel is
+// written twice on two lines, 16 pixels at a time with SSE2 or NEON.
+
+// Writes the width x height image src into dst (2*width x 2*height, pitch
+// bytes per line). When prev is given (width x height, the image drawn
+// last time), the lines that didn't change are not written and prev is
+// updated. Returns the number of source lines written.
+int scale2x(unsigned char *dst, int pitch, const unsigned char *src, unsigned char *prev, int width, int height);
+
+#endif // __SCALE2X_H__
@@ -25,6 +25,13 @@
 #define SMK_TREE_FULL	2
 #define SMK_TREE_TYPE	3
 
+/* internal file mode: like SMK_MODE_DISK, but through a caller's
+	reader (smk_open_reader) */
+#define SMK_MODE_READER	0x03
+
+/* reads done while parsing the header go through a small cache */
+#define SMK_READER_CACHE	4096
+
 /* SMACKER DATA STRUCTURES */
 struct smk_t
 {
@@ -58,6 +65,16 @@ struct smk_t
 
 		/* in-memory mode: unprocessed chunks */
 		unsigned char** chunk_data;
+
+		struct
+		{
+			/* reader mode: chunks read when rendered, into
+				one buffer as big as the biggest chunk */
+			smk_reader read;
+			void* user;
+			unsigned long* chunk_offset;
+			unsigned char* chunk_buffer;
+		} reader;
 	} source;
 
 	/* shared array of "chunk sizes"*/
@@ -126,10 +143,24 @@ struct smk_t
 	} audio[7];
 };
 
+struct smk_reader_t
+{
+	smk_reader read;
+	void* user;
+	/* next byte to read */
+	unsigned long offset;
+
+	/* cache of the bytes [cache_offset, cache_offset + cache_size) */
+	unsigned char* cache;
+	unsigned long cache_offset;
+	unsigned long cache_size;
+};
+
 union smk_read_t
 {
 	FILE* file;
 	unsigned char* ram;
+	struct smk_reader_t reader;
 };
 
 /* An fread wrapper: consumes N bytes, or returns -1
@@ -161,15 +192,62 @@ static char smk_read_memory(void* buf, const unsigned long size, unsigned char**
 	return 0;
 }
 
+/* A reader wrapper: consumes N bytes, or returns -1
+	on failure (when size too low, or short read) */
+static char smk_read_reader(void* buf, const unsigned long size, struct smk_reader_t* rd, unsigned long* p_size)
+{
+	unsigned long got;
+
+	if (size > *p_size)
+	{
+		fprintf(stderr,"libsmacker::smk_read_reader(buf,%lu,rd,%lu) - ERROR: Short read\n",(unsigned long)size, (unsigned long)*p_size);
+		return -1;
+	}
+
+	/* small reads (the header fields) go through the cache */
+	if (size < SMK_READER_CACHE &&
+		(rd->offset < rd->cache_offset || rd->offset + size > rd->cache_offset + rd->cache_size))
+	{
+		got = (*p_size < SMK_READER_CACHE ? *p_size : SMK_READER_CACHE);
+		rd->cache_offset = rd->offset;
+		rd->cache_size = rd->read(rd->user, rd->cache, got, rd->offset);
+
+		if (rd->cache_size < size)
+		{
+			fprintf(stderr,"libsmacker::smk_read_reader(buf,%lu,rd,%lu) - ERROR: Short read, %lu bytes returned\n",(unsigned long)size, (unsigned long)*p_size, rd->cache_size);
+			rd->cache_size = 0;
+			return -1;
+		}
+	}
+
+	if (size < SMK_READER_CACHE)
+	{
+		memcpy(buf, rd->cache + (rd->offset - rd->cache_offset), size);
+	}
+	else if ((got = rd->read(rd->user, buf, size, rd->offset)) != size)
+	{
+		fprintf(stderr,"libsmacker::smk_read_reader(buf,%lu,rd,%lu) - ERROR: Short read, %lu bytes returned\n",(unsigned long)size, (unsigned long)*p_size, got);
+		return -1;
+	}
+
+	rd->offset += size;
+	*p_size -= size;
+	return 0;
+}
+
 /* Helper functions to do the reading, plus
 	byteswap from LE to host order */
 /* read n bytes from (source) into ret */
 #define smk_read(ret,n) \
 { \
-	if (m) \
+	if (m == 1) \
 	{ \
 		r = (smk_read_file(ret,n,fp.file)); \
 	} \
+	else if (m == 2) \
+	{ \
+		r = (smk_read_reader(ret,n,&fp.reader,&size)); \
+	} \
 	else \
 	{ \
 		r = (smk_read_memory(ret,n,&fp.ram,&size)); \
@@ -390,6 +468,33 @@ static smk smk_open_generic(const unsigned char m, union smk_read_t fp, unsigned
 			smk_read(s->source.chunk_data[temp_u],s->chunk_size[temp_u]);
 		}
 	}
+	else if (s->mode == SMK_MODE_READER)
+	{
+		/* MODE_READER: only note where each chunk is, they are read
+			at render time in one buffer for the biggest chunk */
+		s->source.reader.read = fp.reader.read;
+		s->source.reader.user = fp.reader.user;
+
+		smk_malloc(s->source.reader.chunk_offset,(s->f + s->ring_frame) * sizeof(unsigned long));
+		temp_l = 1;
+		for (temp_u = 0; temp_u < (s->f + s->ring_frame); temp_u ++)
+		{
+			if (s->chunk_size[temp_u] > size)
+			{
+				fprintf(stderr,"libsmacker::smk_open - ERROR: frame %lu: short source.\n",temp_u);
+				goto error;
+			}
+			s->source.reader.chunk_offset[temp_u] = fp.reader.offset;
+			fp.reader.offset += s->chunk_size[temp_u];
+			size -= s->chunk_size[temp_u];
+
+			if ((long)s->chunk_size[temp_u] > temp_l)
+			{
+				temp_l = s->chunk_size[temp_u];
+			}
+		}
+		smk_malloc(s->source.reader.chunk_buffer,temp_l);
+	}
 	else
 	{
 		/* MODE_STREAM: don't read anything now, just precompute offsets.
@@ -438,6 +543,37 @@ error:
 	return s;
 }
 
+/* open an smk (through a reader: frames read when rendered)
+	user must stay valid until smk_close */
+smk smk_open_reader(smk_reader read, void* user, const unsigned long size)
+{
+	smk s = NULL;
+
+	union smk_read_t fp;
+
+	smk_assert(read);
+
+	/* set up the read union for Reader mode */
+	fp.reader.read = read;
+	fp.reader.user = user;
+	fp.reader.offset = 0;
+	fp.reader.cache_offset = 0;
+	fp.reader.cache_size = 0;
+	smk_malloc(fp.reader.cache, SMK_READER_CACHE);
+
+	if (!(s = smk_open_generic(2,fp,size,SMK_MODE_READER)))
+	{
+		fprintf(stderr,"libsmacker::smk_open_reader(read,user,%lu) - ERROR: Fatal error in smk_open_generic, returning NULL.\n",size);
+	}
+
+	/* only used for the header */
+	smk_free(fp.reader.cache);
+
+	/* fall through, return s or null */
+error:
+	return s;
+}
+
 /* open an smk (from a file) */
 smk smk_open_filepointer(FILE* file, const unsigned char mode)
 {
@@ -526,6 +662,12 @@ void smk_close(smk s)
 		}
 		smk_free(s->source.file.chunk_offset);
 	}
+	else if (s->mode == SMK_MODE_READER)
+	{
+		/* reader-mode: the reader belongs to the caller */
+		smk_free(s->source.reader.chunk_offset);
+		smk_free(s->source.reader.chunk_buffer);
+	}
 	else
 	{
 		/* mem-mode */
@@ -1248,6 +1390,17 @@ static char smk_render(smk s)
 			goto error;
 		}
 	}
+	else if (s->mode == SMK_MODE_READER)
+	{
+		/* In reader mode: the chunk goes in the buffer made at open */
+		buffer = s->source.reader.chunk_buffer;
+
+		if (s->source.reader.read(s->source.reader.user, buffer, i, s->source.reader.chunk_offset[s->cur_frame]) != i)
+		{
+			fprintf(stderr,"libsmacker::smk_render(s) - ERROR: frame %lu (offset %lu): short read.\n",s->cur_frame,s->source.reader.chunk_offset[s->cur_frame]);
+			goto error;
+		}
+	}
 	else
 	{
 		/* Just point buffer at the right place */
@@ -65,6 +65,12 @@ smk smk_open_file(const char* filename, unsigned char mode);
 smk smk_open_filepointer(FILE* file, unsigned char mode);
 /** read an smk (from a memory buffer) */
 smk smk_open_memory(const unsigned char* buffer, unsigned long size);
+/** streaming source: reads size bytes at offset (from the start of the smk) into buf,
+	returns the number of bytes read */
+typedef unsigned long (*smk_reader)(void* user, void* buf, unsigned long size, unsigned long offset);
+/** read an smk of size bytes through a reader: each frame is read when it is rendered,
+	only the header and one frame are kept in memory. user must stay valid until smk_close */
+smk smk_open_reader(smk_reader read, void* user, unsigned long size);
 
 /* CLOSE OPERATIONS */
 /** close out an smk file and clean up memory */
@@ -14,20 +14,6 @@
 /* malloc and friends */
 #include "smk_malloc.h"
 
-/*
-	Bitstream structure
-	Pointer to raw block of data and a size limit.
-	Maintains internal pointers to byte_num and bit_number.
-*/
-struct smk_bit_t
-{
-	const unsigned char* buffer;
-	unsigned long size;
-
-	unsigned long byte_num;
-	char bit_num;
-};
-
 /* BITSTREAM Functions */
 struct smk_bit_t* smk_bs_init(const unsigned char* b, const unsigned long size)
 {
@@ -6,14 +6,36 @@
 
 	smk_bitstream.h
 		SMK bitstream structure. Presents a block of raw bytes one
-		bit at a time, and protects against over-read.
+		bit at a time (or as a 64-bit window), and protects against
+		over-read.
 */
 
 #ifndef SMK_BITSTREAM_H
 #define SMK_BITSTREAM_H
 
-/** Bitstream structure, Forward declaration */
-struct smk_bit_t;
+/* memcpy */
+#include <string.h>
+
+#ifdef _MSC_VER
+#define SMK_INLINE static __inline
+#else
+#define SMK_INLINE static inline
+#endif
+
+/*
+	Bitstream structure
+	Pointer to raw block of data and a size limit.
+	Maintains internal pointers to byte_num and bit_number.
+	Public so the huffman lookups can peek at it without a call.
+*/
+struct smk_bit_t
+{
+	const unsigned char* buffer;
+	unsigned long size;
+
+	unsigned long byte_num;
+	unsigned int bit_num;
+};
 
 /* BITSTREAM Functions */
 /** Initialize a bitstream */
@@ -47,4 +69,48 @@ char _smk_bs_read_1(struct smk_bit_t* bs);
 	Returns -1 on error. */
 short _smk_bs_read_8(struct smk_bit_t* bs);
 
+/** Next bits of the bitstream, without advancing: bit 0 is the next bit
+	read. At least 57 bits are valid, the bits after the end of the
+	buffer read as 0.
+	Unaligned little-endian 64-bit load (all our targets are x86/x64
+	or ARM little-endian). */
+SMK_INLINE unsigned long long _smk_bs_peek(const struct smk_bit_t* bs)
+{
+	unsigned long long window = 0;
+	unsigned long i;
+
+	if (bs->byte_num + 8 <= bs->size)
+	{
+		memcpy(&window, bs->buffer + bs->byte_num, 8);
+	}
+	else
+	{
+		/* last bytes: zero padded */
+		for (i = bs->byte_num; i < bs->size; i ++)
+		{
+			window |= (unsigned long long)bs->buffer[i] << ((i - bs->byte_num) * 8);
+		}
+	}
+
+	return window >> bs->bit_num;
+}
+
+/** Advance by n bits (n <= 57) after a _smk_bs_peek.
+	Returns -1 (and doesn't move) if fewer than n bits are left. */
+SMK_INLINE char _smk_bs_skip(struct smk_bit_t* bs, unsigned int n)
+{
+	unsigned long bit_num = bs->bit_num + n;
+
+	if (bs->byte_num + (bit_num >> 3) > bs->size ||
+		(bs->byte_num + (bit_num >> 3) == bs->size && (bit_num & 7)))
+	{
+		return -1;
+	}
+
+	bs->byte_num += bit_num >> 3;
+	bs->bit_num = bit_num & 7;
+
+	return 0;
+}
+
 #endif
@@ -14,16 +14,17 @@
 #include "smk_malloc.h"
 
 /**
-	8-bit Tree node structure.
+	Tree node structure, only used while a tree is read from the bitstream:
+	it is then flattened into lookup tables (see below).
 	If b0 is non-null, this is a branch, and b1 from the union should be used.
 	If b0 is null, this is a leaf, and val / escape code from union should be used.
 */
-struct smk_huff8_t
+struct smk_huff_node_t
 {
-	struct smk_huff8_t* b0;
+	struct smk_huff_node_t* b0;
 	union
 	{
-		struct smk_huff8_t* b1;
+		struct smk_huff_node_t* b1;
 		struct
 		{
 			unsigned short value;
@@ -32,16 +33,197 @@ struct smk_huff8_t
 	} u;
 };
 
+/**
+	Lookup table entries.
+	A table is indexed by the next bits of the bitstream (bit 0 = next bit),
+	so every code shorter than the index is repeated.
+	Leaf: bits 0-15 value, bits 16-17 escape code (3: none),
+		bits 24-28 length of the code in this table.
+	Link (bit 31 set): the code is longer than the index, all the index bits
+		are used and the next ones index a subtable.
+		bits 0-23 subtable position, bits 24-28 subtable index bits.
+*/
+#define SMK_HUFF_LINK 0x80000000
+#define SMK_HUFF_NO_ESCAPE 3
+#define SMK_HUFF_ERROR 0xFFFFFFFF
+
+/* Index bits of the first table (less if the tree is not as deep) */
+#define SMK_HUFF8_BITS 8
+#define SMK_HUFF16_BITS 11
+/* Index bits of the subtables (same) */
+#define SMK_HUFF_SUB_BITS 6
+
+/**
+	8-bit Tree structure: the first table, then the subtables.
+*/
+struct smk_huff8_t
+{
+	unsigned int* table;
+	unsigned int bits;
+};
+
 /**
 	16-bit Tree root struct: holds a huff8_t structure,
 	as well as a cache of three 16-bit values.
 */
 struct smk_huff16_t
 {
-	struct smk_huff8_t* t;
+	struct smk_huff8_t t;
 	unsigned short cache[3];
 };
 
+/*********************** TREE FLATTENING ***********************/
+/* function to recursively delete a node tree */
+static void _smk_huff_node_free(struct smk_huff_node_t* t)
+{
+	/* Sanity check: do not double-free */
+	smk_assert(t);
+
+	/* If this is not a leaf node, free child trees first */
+	if (t->b0)
+	{
+		_smk_huff_node_free(t->b0);
+		_smk_huff_node_free(t->u.b1);
+	}
+
+	/* Safe-delete tree node. */
+	smk_free(t);
+
+error: ;
+}
+
+/* Length of the longest code under a node */
+static unsigned int _smk_huff_depth(const struct smk_huff_node_t* t)
+{
+	unsigned int d0, d1;
+
+	if (!t->b0)
+	{
+		return 0;
+	}
+
+	d0 = _smk_huff_depth(t->b0);
+	d1 = _smk_huff_depth(t->u.b1);
+
+	return 1 + (d0 > d1 ? d0 : d1);
+}
+
+/* Index bits of the subtable starting at a node */
+static unsigned int _smk_huff_sub_bits(const struct smk_huff_node_t* t)
+{
+	unsigned int d = _smk_huff_depth(t);
+
+	return d < SMK_HUFF_SUB_BITS ? d : SMK_HUFF_SUB_BITS;
+}
+
+/* Entries of the subtables needed under a node reached with
+	len bits of a table indexed by bits */
+static unsigned long _smk_huff_sub_size(const struct smk_huff_node_t* t, unsigned int len, unsigned int bits)
+{
+	unsigned int sub;
+
+	if (!t->b0)
+	{
+		return 0;
+	}
+
+	if (len == bits)
+	{
+		sub = _smk_huff_sub_bits(t);
+		return (1UL << sub) + _smk_huff_sub_size(t, 0, sub);
+	}
+
+	return _smk_huff_sub_size(t->b0, len + 1, bits) + _smk_huff_sub_size(t->u.b1, len + 1, bits);
+}
+
+/* Fills the table at base (indexed by bits) with the codes under a node,
+	reached with the len bits of code. New subtables go at *next. */
+static void _smk_huff_fill(unsigned int* table, unsigned long* next, unsigned long base, unsigned int bits,
+	const struct smk_huff_node_t* t, unsigned int code, unsigned int len)
+{
+	unsigned int entry, sub, i;
+
+	if (!t->b0)
+	{
+		entry = (len << 24) | t->u.leaf.value |
+			((t->u.leaf.escapecode < 3 ? t->u.leaf.escapecode : SMK_HUFF_NO_ESCAPE) << 16);
+
+		for (i = code; i < (1U << bits); i += (1U << len))
+		{
+			table[base + i] = entry;
+		}
+		return;
+	}
+
+	if (len == bits)
+	{
+		sub = _smk_huff_sub_bits(t);
+
+		table[base + code] = SMK_HUFF_LINK | (sub << 24) | *next;
+
+		base = *next;
+		*next += 1UL << sub;
+		_smk_huff_fill(table, next, base, sub, t, 0, 0);
+		return;
+	}
+
+	_smk_huff_fill(table, next, base, bits, t->b0, code, len + 1);
+	_smk_huff_fill(table, next, base, bits, t->u.b1, code | (1U << len), len + 1);
+}
+
+/* Builds the lookup tables of a node tree.
+	Returns -1 if the tree doesn't fit. */
+static char _smk_huff_flatten(struct smk_huff8_t* t, const struct smk_huff_node_t* root, unsigned int max_bits)
+{
+	unsigned long size, next;
+
+	t->bits = _smk_huff_depth(root);
+	if (t->bits > max_bits)
+	{
+		t->bits = max_bits;
+	}
+
+	size = (1UL << t->bits) + _smk_huff_sub_size(root, 0, t->bits);
+	if (size > 0x01000000)
+	{
+		fprintf(stderr, "libsmacker::_smk_huff_flatten() - ERROR: tree too large (%lu entries)\n", size);
+		return -1;
+	}
+
+	smk_malloc(t->table, size * sizeof(unsigned int));
+
+	next = 1UL << t->bits;
+	_smk_huff_fill(t->table, &next, 0, t->bits, root, 0, 0);
+
+	return 0;
+}
+
+/* Follows the bitstream down the tables.
+	Returns the leaf entry, or SMK_HUFF_ERROR if the bitstream ends first. */
+SMK_INLINE unsigned int _smk_huff_decode(struct smk_bit_t* bs, const struct smk_huff8_t* t)
+{
+	const unsigned int* table = t->table;
+	unsigned int bits = t->bits;
+	unsigned int entry = table[_smk_bs_peek(bs) & ((1U << bits) - 1)];
+
+	while (entry & SMK_HUFF_LINK)
+	{
+		if (_smk_bs_skip(bs, bits) < 0)
+		{
+			return SMK_HUFF_ERROR;
+		}
+		bits = (entry >> 24) & 0x1F;
+		entry = table[(entry & 0x00FFFFFF) + (_smk_bs_peek(bs) & ((1U << bits) - 1))];
+	}
+
+	if (_smk_bs_skip(bs, entry >> 24) < 0)
+	{
+		return SMK_HUFF_ERROR;
+	}
+
+	return entry;
+}
+
 /*********************** 8-BIT HUFF-TREE FUNCTIONS ***********************/
 /** safe build with built-in error jump */
 #define smk_huff8_build_rec(bs,p) \
@@ -53,9 +235,9 @@ struct smk_huff16_t
 	} \
 }
 /** Recursive tree-building function. */
-static struct smk_huff8_t* _smk_huff8_build_rec(struct smk_bit_t* bs)
+static struct smk_huff_node_t* _smk_huff8_build_rec(struct smk_bit_t* bs)
 {
-	struct smk_huff8_t* ret = NULL;
+	struct smk_huff_node_t* ret = NULL;
 	char bit;
 
 	/* sanity check - removed: bs cannot be null, because it was checked at smk_huff8_build below */
@@ -65,7 +247,7 @@ static struct smk_huff8_t* _smk_huff8_build_rec(struct smk_bit_t* bs)
 	smk_bs_read_1(bs, bit);
 
 	/* Malloc a structure. */
-	smk_malloc(ret, sizeof(struct smk_huff8_t));
+	smk_malloc(ret, sizeof(struct smk_huff_node_t));
 
 	if (bit)
 	{
@@ -92,7 +274,7 @@ static struct smk_huff8_t* _smk_huff8_build_rec(struct smk_bit_t* bs)
 
 error:
 	/* In case of error, undo the subtree we were building, and return NULL. */
-	smk_huff8_free(ret);
+	_smk_huff_node_free(ret);
 	return NULL;
 }
 
@@ -100,29 +282,21 @@ error:
 	Return -1 on error. */
 short _smk_huff8_lookup(struct smk_bit_t* bs, const struct smk_huff8_t* t)
 {
-	char bit;
+	unsigned int entry;
 
 	/* sanity check */
 	smk_assert(bs);
 	smk_assert(t);
 
-	if (!t->b0)
-	{
-		/* Reached a Leaf node. Return its value. */
-		return t->u.leaf.value;
-	}
-
-	/* Read the next bit from bitstream to determine path */
-	smk_bs_read_1(bs, bit);
+	entry = _smk_huff_decode(bs, t);
 
-	if (bit)
+	if (entry == SMK_HUFF_ERROR)
 	{
-		/* get_bit returned Set, follow Right branch. */
-		return _smk_huff8_lookup(bs, t->u.b1);
+		fprintf(stderr, "libsmacker::_smk_huff8_lookup(bs): ERROR: bitstream (length=%lu) exhausted.\n", bs->size);
+		goto error;
 	}
 
-	/* follow Left branch */
-	return _smk_huff8_lookup(bs, t->b0);
+	return (short)(entry & 0xFFFF);
 
 error:
 	return -1;
@@ -130,11 +304,12 @@ error:
 
 /**
 	Entry point for huff8 build. Basically just checks the start/end tags
-	and calls smk_huff8_build_rec recursive function.
+	and calls smk_huff8_build_rec recursive function, then flattens the tree.
 */
 struct smk_huff8_t* _smk_huff8_build(struct smk_bit_t* bs)
 {
 	struct smk_huff8_t* ret = NULL;
+	struct smk_huff_node_t* root = NULL;
 	char bit;
 
 	/* sanity check */
@@ -152,7 +327,7 @@ struct smk_huff8_t* _smk_huff8_build(struct smk_bit_t* bs)
 	}
 
 	/* Begin parsing the tree data. */
-	smk_huff8_build_rec(bs, ret);
+	smk_huff8_build_rec(bs, root);
 
 	/* huff trees end with an unset-bit */
 	smk_bs_read_1(bs, bit);
@@ -163,27 +338,35 @@ struct smk_huff8_t* _smk_huff8_build(struct smk_bit_t* bs)
 		goto error;
 	}
 
+	/* Lookup tables from the tree */
+	smk_malloc(ret, sizeof(struct smk_huff8_t));
+
+	if (_smk_huff_flatten(ret, root, SMK_HUFF8_BITS) < 0)
+	{
+		goto error;
+	}
+
+	_smk_huff_node_free(root);
+
 	return ret;
 
 error:
-	smk_huff8_free(ret);
+	if (root)
+		_smk_huff_node_free(root);
+	if (ret)
+		smk_huff8_free(ret);
 	return NULL;
 }
 
-/* function to recursively delete a huffman tree */
+/* function to delete a huffman tree */
 void smk_huff8_free(struct smk_huff8_t* t)
 {
 	/* Sanity check: do not double-free */
 	smk_assert(t);
 
-	/* If this is not a leaf node, free child trees first */
-	if (t->b0)
-	{
-		smk_huff8_free(t->b0);
-		smk_huff8_free(t->u.b1);
-	}
+	smk_free(t->table);
 
-	/* Safe-delete tree node. */
+	/* Safe-delete tree. */
 	smk_free(t);
 
 error: ;
@@ -200,9 +383,9 @@ error: ;
 	} \
 }
 /* Recursively builds a Big tree. */
-static struct smk_huff8_t* _smk_huff16_build_rec(struct smk_bit_t* bs, const unsigned short cache[3], const struct smk_huff8_t* low8, const struct smk_huff8_t* hi8)
+static struct smk_huff_node_t* _smk_huff16_build_rec(struct smk_bit_t* bs, const unsigned short cache[3], const struct smk_huff8_t* low8, const struct smk_huff8_t* hi8)
 {
-	struct smk_huff8_t* ret = NULL;
+	struct smk_huff_node_t* ret = NULL;
 
 	char bit;
 	short lowval;
@@ -217,7 +400,7 @@ static struct smk_huff8_t* _smk_huff16_build_rec(struct smk_bit_t* bs, const uns
 	smk_bs_read_1(bs, bit);
 
 	/* Malloc a structure. */
-	smk_malloc(ret, sizeof(struct smk_huff8_t));
+	smk_malloc(ret, sizeof(struct smk_huff_node_t));
 
 	if (bit)
 	{
@@ -261,7 +444,7 @@ static struct smk_huff8_t* _smk_huff16_build_rec(struct smk_bit_t* bs, const uns
 	return ret;
 
 error:
-	smk_huff8_free(ret);
+	_smk_huff_node_free(ret);
 	return NULL;
 }
 
@@ -269,6 +452,7 @@ error:
 struct smk_huff16_t* _smk_huff16_build(struct smk_bit_t* bs)
 {
 	struct smk_huff16_t* big = NULL;
+	struct smk_huff_node_t* root = NULL;
 
 	struct smk_huff8_t* low8 = NULL;
 	struct smk_huff8_t* hi8 = NULL;
@@ -307,11 +491,13 @@ struct smk_huff16_t* _smk_huff16_build(struct smk_bit_t* bs)
 	}
 
 	/* Finally, call recursive function to retrieve the Bigtree. */
-	smk_huff16_build_rec(bs, big->cache, low8, hi8, big->t);
+	smk_huff16_build_rec(bs, big->cache, low8, hi8, root);
 
 	/* Done with 8-bit hufftrees, free them. */
 	smk_huff8_free(hi8);
 	smk_huff8_free(low8);
+	hi8 = NULL;
+	low8 = NULL;
 
 	/* Check final end tag. */
 	smk_bs_read_1(bs, bit);
@@ -322,74 +508,70 @@ struct smk_huff16_t* _smk_huff16_build(struct smk_bit_t* bs)
 		goto error;
 	}
 
+	/* Lookup tables from the tree */
+	if (_smk_huff_flatten(&big->t, root, SMK_HUFF16_BITS) < 0)
+	{
+		goto error;
+	}
+
+	_smk_huff_node_free(root);
+
 	return big;
 
 error:
-	smk_huff16_free(big);
-	smk_huff8_free(hi8);
-	smk_huff8_free(low8);
+	if (root)
+		_smk_huff_node_free(root);
+	if (big)
+		smk_huff16_free(big);
+	if (hi8)
+		smk_huff8_free(hi8);
+	if (low8)
+		smk_huff8_free(low8);
 	return NULL;
 }
 
-static int _smk_huff16_lookup_rec(struct smk_bit_t* bs, unsigned short cache[3], const struct smk_huff8_t* t)
+/* Look up a 16-bit value from a bigtree, and update its cache.
+	Return -1 on error. */
+long _smk_huff16_lookup(struct smk_bit_t* bs, struct smk_huff16_t* big)
 {
+	unsigned int entry, escape;
 	unsigned short val;
-	char bit;
 
 	/* sanity check */
-	/* smk_assert(bs);
-	smk_assert(cache);
-	smk_assert(t); */
-
-	/* Reached a Leaf node */
-	if (!t->b0)
-	{
-		if (t->u.leaf.escapecode != 0xFF)
-		{
-			/* Found escape code. Retrieve value from Cache. */
-			val = cache[t->u.leaf.escapecode];
-		}
-		else
-		{
-			/* Use value directly. */
-			val = t->u.leaf.value;
-		}
+	smk_assert(bs);
+	smk_assert(big);
 
-		if (cache[0] != val)
-		{
-			/* Update the cache, by moving val to the front of the queue,
-				if it isn't already there. */
-			cache[2] = cache[1];
-			cache[1] = cache[0];
-			cache[0] = val;
-		}
+	entry = _smk_huff_decode(bs, &big->t);
 
-		return val;
+	if (entry == SMK_HUFF_ERROR)
+	{
+		fprintf(stderr, "libsmacker::_smk_huff16_lookup(bs): ERROR: bitstream (length=%lu) exhausted.\n", bs->size);
+		goto error;
 	}
 
-	/* Read the next bit from bitstream to determine path */
-	smk_bs_read_1(bs, bit);
+	escape = (entry >> 16) & 3;
 
-	if (bit)
+	if (escape != SMK_HUFF_NO_ESCAPE)
 	{
-		/* get_bit returned Set, follow Right branch. */
-		return _smk_huff16_lookup_rec(bs, cache, t->u.b1);
+		/* Found escape code. Retrieve value from Cache. */
+		val = big->cache[escape];
+	}
+	else
+	{
+		/* Use value directly. */
+		val = (unsigned short)entry;
 	}
 
-	return _smk_huff16_lookup_rec(bs, cache, t->b0);
-
-error:
-	return -1;
-}
-
-/* Convenience call-out for recursive bigtree lookup function */
-long _smk_huff16_lookup(struct smk_bit_t* bs, struct smk_huff16_t* big)
-{
-	/* sanity check */
-	smk_assert(bs);
-	smk_assert(big);
+	if (big->cache[0] != val)
+	{
+		/* Update the cache, by moving val to the front of the queue,
+			if it isn't already there. */
+		big->cache[2] = big->cache[1];
+		big->cache[1] = big->cache[0];
+		big->cache[0] = val;
+	}
 
-	return _smk_huff16_lookup_rec(bs, big->cache, big->t);
+	return val;
 
 error:
 	return -1;
@@ -414,9 +596,8 @@ void smk_huff16_free(struct smk_huff16_t* big)
 	/* Sanity check: do not double-free */
 	smk_assert(big);
  
-	/* free the subtree */
-	if (big->t)
-		smk_huff8_free(big->t);
+	/* free the tables */
+	smk_free(big->t.table);
 
 	/* free the bigtree */
 	smk_free(big);
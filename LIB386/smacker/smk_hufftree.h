@@ -9,6 +9,8 @@
 		- a basic 8-bit tree, and
 		- a "big" 16-bit tree which includes a cache for recently
 			searched values.
+		Both are read as a tree, then flattened into lookup tables
+		indexed by the next bits of the bitstream.
 */
 
 #ifndef SMK_HUFFTREE_H
@@ -16,7 +18,7 @@
 
 #include "smk_bitstream.h"
 
-/** Tree node structures - Forward declaration */
+/** Tree structures - Forward declaration */
 struct smk_huff8_t;
 struct smk_huff16_t;
 
@@ -48,7 +50,7 @@ struct smk_huff8_t* _smk_huff8_build(struct smk_bit_t* bs);
 	returns -1 on error */
 short _smk_huff8_lookup(struct smk_bit_t* bs, const struct smk_huff8_t* t);
 
-/** function to recursively delete an 8-bit huffman tree */
+/** function to delete an 8-bit huffman tree */
 void smk_huff8_free(struct smk_huff8_t* t);
 
 /************************ 16-BIT HUFF-TREE FUNCTIONS ************************/
@@ -82,7 +84,7 @@ long _smk_huff16_lookup(struct smk_bit_t* bs, struct smk_huff16_t* big);
 /** Reset the cache in a 16-bit tree */
 void smk_huff16_reset(struct smk_huff16_t* big);
 
-/** function to recursively delete a 16-bit huffman tree */
+/** function to delete a 16-bit huffman tree */
 void smk_huff16_free(struct smk_huff16_t* big);
 
 #endif
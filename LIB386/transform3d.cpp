@@ -0,0 +1,705 @@
+#include "transform3d.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(TRANSFORM3D_NOSIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSFORM3D_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM3D_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TRANSFORM3D_NEON
+#endif
+
+#define INDEFINITE32 ((int)0x80000000) // fistp dword out of range
+#define INDEFINITE16 ((short)0x8000)   // fistp word out of range
+#define CLIPPED ((int)0x80008000)      // ProjectList
+
+// A double result farther than WINDOW * (sum of the magnitudes of its terms)
+// from a half integer rounds like the FPU at 64 bits would: double and the
+// FPU both stay a few ulps of double from the exact value.
+static const double WINDOW = 1.0 / 281474976710656.0; // 2^-48
+static const double LIMIT = 1073741824.0;             // 2^30, larger results are always computed again
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The FPU at 64 bits precision: (-1)^neg * mant * 2^exp, mant normalized
+// (bit 63 set) or 0. Only for the few points double can't decide.
+
+struct ext
+{
+    int neg;
+    int exp;
+    uint64_t mant;
+};
+
+struct u128
+{
+    uint64_t hi, lo;
+};
+
+static int top_bit(uint64_t v)
+{
+    int n = 0;
+    while (v >>= 1)
+        n++;
+    return n;
+}
+
+static u128 mul64(uint64_t a, uint64_t b)
+{
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+
+    u128 r;
+    r.lo = (mid << 32) | (uint32_t)p00;
+    r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return r;
+}
+
+// m * 2^exp rounded to 64 bits, nearest even
+static ext ext_round(int neg, u128 m, int exp)
+{
+    ext r = {neg, exp, 0};
+
+    if (!m.hi && !m.lo)
+    {
+        return r;
+    }
+
+    int p = m.hi ? 64 + top_bit(m.hi) : top_bit(m.lo);
+    if (p <= 63)
+    {
+        r.mant = m.lo << (63 - p);
+        r.exp = exp - (63 - p);
+        return r;
+    }
+
+    int k = p - 63; // bits dropped, 1..64
+    uint64_t q = k == 64 ? m.hi : (m.hi << (64 - k)) | (m.lo >> k);
+    uint64_t half = (m.lo >> (k - 1)) & 1;
+    uint64_t rest = m.lo & ((1ull << (k - 1)) - 1);
+
+    r.exp = exp + k;
+    if (half && (rest || (q & 1)))
+    {
+        if (!++q)
+        {
+            q = 1ull << 63;
+            r.exp++;
+        }
+    }
+    r.mant = q;
+    return r;
+}
+
+static ext ext_int(int v)
+{
+    u128 m = {0, (uint64_t)(v < 0 ? -(int64_t)v : v)};
+    return ext_round(v < 0, m, 0);
+}
+
+// fld of a (finite) float
+static ext ext_float(float f)
+{
+    union
+    {
+        float f;
+        uint32_t u;
+    } bits;
+    bits.f = f;
+
+    int e = (bits.u >> 23) & 0xFF;
+    u128 m = {0, bits.u & 0x7FFFFF};
+    if (e)
+    {
+        m.lo |= 0x800000;
+    }
+    return ext_round(bits.u >> 31, m, (e ? e : 1) - 150);
+}
+
+static ext ext_mul(ext a, ext b)
+{
+    return ext_round(a.neg ^ b.neg, mul64(a.mant, b.mant), a.exp + b.exp);
+}
+
+static ext ext_add(ext a, ext b)
+{
+    if (!b.mant)
+    {
+        return a;
+    }
+    if (!a.mant)
+    {
+        return b;
+    }
+    if (a.exp < b.exp || (a.exp == b.exp && a.mant < b.mant))
+    {
+        ext t = a;
+        a = b;
+        b = t;
+    }
+
+    // a on bits 63..126, b shifted under it, what falls off kept as a sticky bit
+    u128 ma = {a.mant >> 1, a.mant << 63};
+    u128 mb = {b.mant >> 1, b.mant << 63};
+    int d = a.exp - b.exp;
+    if (d >= 128)
+    {
+        mb.hi = 0;
+        mb.lo = 1;
+    }
+    else if (d >= 64)
+    {
+        uint64_t sticky = mb.lo || (mb.hi & ((1ull << (d - 64)) - 1)) != 0;
+        mb.lo = (d == 64 ? mb.hi : mb.hi >> (d - 64)) | sticky;
+        mb.hi = 0;
+    }
+    else if (d)
+    {
+        uint64_t sticky = (mb.lo & ((1ull << d) - 1)) != 0;
+        mb.lo = (mb.lo >> d) | (mb.hi << (64 - d)) | sticky;
+        mb.hi >>= d;
+    }
+
+    u128 r;
+    if (a.neg == b.neg)
+    {
+        r.lo = ma.lo + mb.lo;
+        r.hi = ma.hi + mb.hi + (r.lo < ma.lo);
+    }
+    else
+    {
+        r.lo = ma.lo - mb.lo;
+        r.hi = ma.hi - mb.hi - (ma.lo < mb.lo);
+    }
+    return ext_round(a.neg, r, a.exp - 63);
+}
+
+// b not 0
+static ext ext_div(ext a, ext b)
+{
+    if (!a.mant)
+    {
+        return a;
+    }
+
+    // a.mant * 2^127 / b.mant: 127 or 128 bits, the remainder as a sticky bit
+    u128 q = {0, 0};
+    uint64_t rem = 0;
+    for (int i = 63; i >= -127; i--)
+    {
+        uint64_t carry = rem >> 63;
+        rem = (rem << 1) | (i >= 0 ? (a.mant >> i) & 1 : 0);
+        q.hi = (q.hi << 1) | (q.lo >> 63);
+        q.lo <<= 1;
+        if (carry || rem >= b.mant)
+        {
+            rem -= b.mant;
+            q.lo |= 1;
+        }
+    }
+    q.lo |= rem != 0;
+    return ext_round(a.neg ^ b.neg, q, a.exp - b.exp - 127);
+}
+
+// fistp: nearest even, INDEFINITE32 when out of 32 bits
+static int ext_fistp(ext v)
+{
+    int64_t r;
+
+    if (!v.mant || v.exp < -64)
+    {
+        return 0;
+    }
+    if (v.exp >= 0)
+    {
+        return INDEFINITE32;
+    }
+
+    int s = -v.exp;
+    uint64_t q = s == 64 ? 0 : v.mant >> s;
+    uint64_t half = (v.mant >> (s - 1)) & 1;
+    uint64_t rest = v.mant & ((1ull << (s - 1)) - 1);
+    if (half && (rest || (q & 1)))
+    {
+        q++;
+    }
+    if (q > 0x80000000ull)
+    {
+        return INDEFINITE32;
+    }
+
+    r = v.neg ? -(int64_t)q : (int64_t)q;
+    return r > 0x7FFFFFFF ? INDEFINITE32 : (int)r;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The F routines at 64 bits, operation by operation
+
+// LROT3DF.ASM / LROTLISF.ASM
+static void rotate_exact(int *dx, int *dy, int *dz, int x, int y, int z, const float *mat)
+{
+    ext X = ext_int(x), Y = ext_int(y), Z = ext_int(z);
+
+    *dx = ext_fistp(ext_add(ext_add(ext_mul(X, ext_float(mat[0])), ext_mul(Y, ext_float(mat[1]))),
+                            ext_mul(Z, ext_float(mat[2]))));
+    *dy = ext_fistp(ext_add(ext_mul(Z, ext_float(mat[5])),
+                            ext_add(ext_mul(Y, ext_float(mat[4])), ext_mul(X, ext_float(mat[3])))));
+    *dz = ext_fistp(ext_add(ext_add(ext_mul(X, ext_float(mat[6])), ext_mul(Y, ext_float(mat[7]))),
+                            ext_mul(Z, ext_float(mat[8]))));
+}
+
+// ROTRALIF.ASM
+static void rottrans_exact(int *dx, int *dy, int *dz, int x, int y, int z, const float *mat)
+{
+    ext X = ext_int(x), Y = ext_int(y), Z = ext_int(z);
+
+    *dx = ext_fistp(ext_add(ext_add(ext_add(ext_mul(X, ext_float(mat[0])), ext_float(mat[9])),
+                                    ext_mul(Y, ext_float(mat[1]))),
+                            ext_mul(Z, ext_float(mat[2]))));
+    *dy = ext_fistp(ext_add(ext_mul(Z, ext_float(mat[5])),
+                            ext_add(ext_add(ext_mul(X, ext_float(mat[3])), ext_float(mat[10])),
+                                    ext_mul(Y, ext_float(mat[4])))));
+    *dz = ext_fistp(ext_add(ext_add(ext_mul(Y, ext_float(mat[7])),
+                                    ext_add(ext_mul(X, ext_float(mat[6])), ext_float(mat[11]))),
+                            ext_mul(Z, ext_float(mat[8]))));
+}
+
+// PRLI3DF.ASM / LPROJ3DF.ASM, x y z already relative to the camera
+static void project_exact(int *xe, int *ye, int x, int y, int z, const transform3d_camera *cam)
+{
+    if (!z)
+    {
+        *xe = *ye = INDEFINITE32; // fx/0
+        return;
+    }
+
+    ext inv = ext_div(ext_float(cam->ratiox), ext_int(z));
+    *xe = ext_fistp(ext_mul(ext_int(x), inv));
+    *ye = ext_fistp(ext_mul(ext_mul(ext_int(y), inv), ext_float(cam->ratioy)));
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The same operations in double, on N points at a time: d holds N doubles,
+// i N 32 bits integers. round() writes the N results nearest even and
+// returns a bit for each one that is sure to be the FPU one.
+
+struct scalar_ops
+{
+    enum { N = 1 };
+    typedef double d;
+    typedef int i;
+
+    static d set(double v) { return v; }
+    static d add(d a, d b) { return a + b; }
+    static d mul(d a, d b) { return a * b; }
+    static d div(d a, d b) { return a / b; }
+    static d abs(d a) { return fabs(a); }
+
+    static i load(const short *p) { return *p; }
+    static i load(const int *p) { return *p; }
+    static i sub(i a, int b) { return (int)((unsigned)a - (unsigned)b); }
+    static i rsub(int a, i b) { return (int)((unsigned)a - (unsigned)b); }
+    static d cvt(i a) { return a; }
+
+    static unsigned round(d v, d w, int *out)
+    {
+        if (!(fabs(v) < LIMIT))
+        {
+            *out = INDEFINITE32;
+            return 0;
+        }
+        int r = (int)lrint(v);
+        *out = r;
+        return 0.5 - fabs(v - r) > w;
+    }
+};
+
+#if defined(TRANSFORM3D_AVX2)
+struct simd_ops
+{
+    enum { N = 4 };
+    typedef __m256d d;
+    typedef __m128i i;
+
+    static d set(double v) { return _mm256_set1_pd(v); }
+    static d add(d a, d b) { return _mm256_add_pd(a, b); }
+    static d mul(d a, d b) { return _mm256_mul_pd(a, b); }
+    static d div(d a, d b) { return _mm256_div_pd(a, b); }
+    static d abs(d a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+    static i load(const short *p) { return _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+    static i load(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static i sub(i a, int b) { return _mm_sub_epi32(a, _mm_set1_epi32(b)); }
+    static i rsub(int a, i b) { return _mm_sub_epi32(_mm_set1_epi32(a), b); }
+    static d cvt(i a) { return _mm256_cvtepi32_pd(a); }
+
+    static unsigned round(d v, d w, int *out)
+    {
+        __m128i r = _mm256_cvtpd_epi32(v);
+        d dist = abs(_mm256_sub_pd(v, _mm256_cvtepi32_pd(r)));
+        d ok = _mm256_and_pd(_mm256_cmp_pd(abs(v), set(LIMIT), _CMP_LT_OQ),
+                             _mm256_cmp_pd(_mm256_sub_pd(set(0.5), dist), w, _CMP_GT_OQ));
+        _mm_storeu_si128((__m128i *)out, r);
+        return _mm256_movemask_pd(ok);
+    }
+};
+#elif defined(TRANSFORM3D_SSE2)
+struct simd_ops
+{
+    enum { N = 4 };
+    struct d
+    {
+        __m128d lo, hi;
+    };
+    typedef __m128i i;
+
+    static d make(__m128d lo, __m128d hi)
+    {
+        d r = {lo, hi};
+        return r;
+    }
+
+    static d set(double v) { return make(_mm_set1_pd(v), _mm_set1_pd(v)); }
+    static d add(d a, d b) { return make(_mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi)); }
+    static d mul(d a, d b) { return make(_mm_mul_pd(a.lo, b.lo), _mm_mul_pd(a.hi, b.hi)); }
+    static d div(d a, d b) { return make(_mm_div_pd(a.lo, b.lo), _mm_div_pd(a.hi, b.hi)); }
+    static __m128d abs(__m128d a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static d abs(d a) { return make(abs(a.lo), abs(a.hi)); }
+
+    static i load(const short *p)
+    {
+        __m128i v = _mm_loadl_epi64((const __m128i *)p);
+        return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    }
+    static i load(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static i sub(i a, int b) { return _mm_sub_epi32(a, _mm_set1_epi32(b)); }
+    static i rsub(int a, i b) { return _mm_sub_epi32(_mm_set1_epi32(a), b); }
+    static d cvt(i a) { return make(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(_mm_srli_si128(a, 8))); }
+
+    static __m128i round2(__m128d v, __m128d w, unsigned *ok)
+    {
+        __m128i r = _mm_cvtpd_epi32(v);
+        __m128d dist = abs(_mm_sub_pd(v, _mm_cvtepi32_pd(r)));
+        *ok = _mm_movemask_pd(_mm_and_pd(_mm_cmplt_pd(abs(v), _mm_set1_pd(LIMIT)),
+                                         _mm_cmpgt_pd(_mm_sub_pd(_mm_set1_pd(0.5), dist), w)));
+        return r;
+    }
+
+    static unsigned round(d v, d w, int *out)
+    {
+        unsigned oklo, okhi;
+        __m128i lo = round2(v.lo, w.lo, &oklo);
+        __m128i hi = round2(v.hi, w.hi, &okhi);
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi64(lo, hi));
+        return oklo | (okhi << 2);
+    }
+};
+#elif defined(TRANSFORM3D_NEON)
+struct simd_ops
+{
+    enum { N = 4 };
+    struct d
+    {
+        float64x2_t lo, hi;
+    };
+    typedef int32x4_t i;
+
+    static d make(float64x2_t lo, float64x2_t hi)
+    {
+        d r = {lo, hi};
+        return r;
+    }
+
+    static d set(double v) { return make(vdupq_n_f64(v), vdupq_n_f64(v)); }
+    static d add(d a, d b) { return make(vaddq_f64(a.lo, b.lo), vaddq_f64(a.hi, b.hi)); }
+    static d mul(d a, d b) { return make(vmulq_f64(a.lo, b.lo), vmulq_f64(a.hi, b.hi)); }
+    static d div(d a, d b) { return make(vdivq_f64(a.lo, b.lo), vdivq_f64(a.hi, b.hi)); }
+    static d abs(d a) { return make(vabsq_f64(a.lo), vabsq_f64(a.hi)); }
+
+    static i load(const short *p) { return vmovl_s16(vld1_s16(p)); }
+    static i load(const int *p) { return vld1q_s32(p); }
+    static i sub(i a, int b) { return vsubq_s32(a, vdupq_n_s32(b)); }
+    static i rsub(int a, i b) { return vsubq_s32(vdupq_n_s32(a), b); }
+    static d cvt(i a)
+    {
+        return make(vcvtq_f64_s64(vmovl_s32(vget_low_s32(a))), vcvtq_f64_s64(vmovl_s32(vget_high_s32(a))));
+    }
+
+    static int32x2_t round2(float64x2_t v, float64x2_t w, unsigned *ok)
+    {
+        int64x2_t r = vcvtnq_s64_f64(v);
+        float64x2_t dist = vabsq_f64(vsubq_f64(v, vcvtq_f64_s64(r)));
+        uint64x2_t good = vandq_u64(vcltq_f64(vabsq_f64(v), vdupq_n_f64(LIMIT)),
+                                    vcgtq_f64(vsubq_f64(vdupq_n_f64(0.5), dist), w));
+        *ok = (unsigned)(vgetq_lane_u64(good, 0) & 1) | (unsigned)(vgetq_lane_u64(good, 1) & 2);
+        return vmovn_s64(r);
+    }
+
+    static unsigned round(d v, d w, int *out)
+    {
+        unsigned oklo, okhi;
+        int32x2_t lo = round2(v.lo, w.lo, &oklo);
+        int32x2_t hi = round2(v.hi, w.hi, &okhi);
+        vst1q_s32(out, vcombine_s32(lo, hi));
+        return oklo | (okhi << 2);
+    }
+};
+#endif
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// One block of V::N points, in the order of the F routines
+
+template <class V>
+static void rotate_block(int *dx, int *dy, int *dz, const int *x, const int *y, const int *z, const double *m,
+                         const float *mat)
+{
+    typedef typename V::d d;
+
+    d X = V::cvt(V::load(x)), Y = V::cvt(V::load(y)), Z = V::cvt(V::load(z));
+    d w = V::set(WINDOW);
+
+    d x1 = V::mul(X, V::set(m[0])), y1 = V::mul(Y, V::set(m[1])), z1 = V::mul(Z, V::set(m[2]));
+    d x2 = V::mul(X, V::set(m[3])), y2 = V::mul(Y, V::set(m[4])), z2 = V::mul(Z, V::set(m[5]));
+    d x3 = V::mul(X, V::set(m[6])), y3 = V::mul(Y, V::set(m[7])), z3 = V::mul(Z, V::set(m[8]));
+
+    unsigned ok = V::round(V::add(V::add(x1, y1), z1),
+                           V::mul(V::add(V::add(V::abs(x1), V::abs(y1)), V::abs(z1)), w), dx);
+    ok &= V::round(V::add(z2, V::add(y2, x2)), V::mul(V::add(V::add(V::abs(x2), V::abs(y2)), V::abs(z2)), w), dy);
+    ok &= V::round(V::add(V::add(x3, y3), z3), V::mul(V::add(V::add(V::abs(x3), V::abs(y3)), V::abs(z3)), w), dz);
+
+    for (int n = 0; n < V::N; n++)
+    {
+        if (!(ok & (1 << n)))
+        {
+            rotate_exact(dx + n, dy + n, dz + n, x[n], y[n], z[n], mat);
+        }
+    }
+}
+
+template <class V>
+static void rottrans_block(short *dx, short *dy, short *dz, const short *x, const short *y, const short *z,
+                           const double *m, const float *mat)
+{
+    typedef typename V::d d;
+
+    d X = V::cvt(V::load(x)), Y = V::cvt(V::load(y)), Z = V::cvt(V::load(z));
+    d w = V::set(WINDOW);
+    int rx[V::N], ry[V::N], rz[V::N];
+
+    d x1 = V::mul(X, V::set(m[0])), y1 = V::mul(Y, V::set(m[1])), z1 = V::mul(Z, V::set(m[2]));
+    d x2 = V::mul(X, V::set(m[3])), y2 = V::mul(Y, V::set(m[4])), z2 = V::mul(Z, V::set(m[5]));
+    d x3 = V::mul(X, V::set(m[6])), y3 = V::mul(Y, V::set(m[7])), z3 = V::mul(Z, V::set(m[8]));
+    d tx = V::set(m[9]), ty = V::set(m[10]), tz = V::set(m[11]);
+
+    unsigned ok = V::round(V::add(V::add(V::add(x1, tx), y1), z1),
+                           V::mul(V::add(V::add(V::add(V::abs(x1), V::abs(tx)), V::abs(y1)), V::abs(z1)), w), rx);
+    ok &= V::round(V::add(z2, V::add(V::add(x2, ty), y2)),
+                   V::mul(V::add(V::add(V::add(V::abs(x2), V::abs(ty)), V::abs(y2)), V::abs(z2)), w), ry);
+    ok &= V::round(V::add(V::add(y3, V::add(x3, tz)), z3),
+                   V::mul(V::add(V::add(V::add(V::abs(x3), V::abs(tz)), V::abs(y3)), V::abs(z3)), w), rz);
+
+    for (int n = 0; n < V::N; n++)
+    {
+        if (!(ok & (1 << n)))
+        {
+            rottrans_exact(rx + n, ry + n, rz + n, x[n], y[n], z[n], mat);
+        }
+
+        // fistp word
+        dx[n] = rx[n] < -32768 || rx[n] > 32767 ? INDEFINITE16 : (short)rx[n];
+        dy[n] = ry[n] < -32768 || ry[n] > 32767 ? INDEFINITE16 : (short)ry[n];
+        dz[n] = rz[n] < -32768 || rz[n] > 32767 ? INDEFINITE16 : (short)rz[n];
+    }
+}
+
+// xe, ye before centering, only right for the points not clipped (clipped tells which)
+template <class V, class T>
+static void project_block(int *xe, int *ye, const T *x, const T *y, const T *z, const bool *clipped,
+                          const transform3d_camera *cam)
+{
+    typedef typename V::d d;
+
+    typename V::i X = V::sub(V::load(x), cam->x);
+    typename V::i Y = V::sub(V::load(y), cam->y);
+    typename V::i Z = V::rsub(cam->z, V::load(z));
+    d w = V::set(WINDOW);
+
+    d inv = V::div(V::set(cam->ratiox), V::cvt(Z));
+    d px = V::mul(V::cvt(X), inv);
+    d py = V::mul(V::mul(V::cvt(Y), inv), V::set(cam->ratioy));
+
+    unsigned ok = V::round(px, V::mul(V::abs(px), w), xe);
+    ok &= V::round(py, V::mul(V::abs(py), w), ye);
+
+    for (int n = 0; n < V::N; n++)
+    {
+        if (!(ok & (1 << n)) && !clipped[n])
+        {
+            project_exact(xe + n, ye + n, (int)((unsigned)x[n] - (unsigned)cam->x),
+                          (int)((unsigned)y[n] - (unsigned)cam->y), (int)((unsigned)cam->z - (unsigned)z[n]), cam);
+        }
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+
+static void matrix_double(double *m, const float *mat)
+{
+    for (int n = 0; n < 12; n++)
+    {
+        m[n] = mat[n];
+    }
+}
+
+void transform3d_rotate(int *dx, int *dy, int *dz, const int *x, const int *y, const int *z, int n, const float *mat)
+{
+    double m[12];
+    int i = 0;
+
+    matrix_double(m, mat);
+
+#if defined(TRANSFORM3D_AVX2) || defined(TRANSFORM3D_SSE2) || defined(TRANSFORM3D_NEON)
+    for (; i + simd_ops::N <= n; i += simd_ops::N)
+    {
+        rotate_block<simd_ops>(dx + i, dy + i, dz + i, x + i, y + i, z + i, m, mat);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        rotate_block<scalar_ops>(dx + i, dy + i, dz + i, x + i, y + i, z + i, m, mat);
+    }
+}
+
+void transform3d_rottrans(short *dx, short *dy, short *dz, const short *x, const short *y, const short *z, int n,
+                          const float *mat)
+{
+    double m[12];
+    int i = 0;
+
+    matrix_double(m, mat);
+
+#if defined(TRANSFORM3D_AVX2) || defined(TRANSFORM3D_SSE2) || defined(TRANSFORM3D_NEON)
+    for (; i + simd_ops::N <= n; i += simd_ops::N)
+    {
+        rottrans_block<simd_ops>(dx + i, dy + i, dz + i, x + i, y + i, z + i, m, mat);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        rottrans_block<scalar_ops>(dx + i, dy + i, dz + i, x + i, y + i, z + i, m, mat);
+    }
+}
+
+// ProjectList3DF: near clip, centering, overflow, bounding box, packing
+static void project_store(int *dst, int xe, int ye, bool clipped, const transform3d_camera *cam, int *bbox)
+{
+    if (clipped)
+    {
+        *dst = CLIPPED;
+        return;
+    }
+
+    int xs = (int)((unsigned)xe + (unsigned)cam->xcentre);
+    int ys = (int)((unsigned)ye + (unsigned)cam->ycentre);
+    if (xs > 32767 || xs < -32767 || ys > 32767 || ys < -32767)
+    {
+        *dst = CLIPPED;
+        return;
+    }
+
+    if (xs < bbox[0])
+        bbox[0] = xs;
+    if (xs > bbox[1])
+        bbox[1] = xs;
+    if (ys < bbox[2])
+        bbox[2] = ys;
+    if (ys > bbox[3])
+        bbox[3] = ys;
+
+    *dst = (int)(((unsigned)ys << 16) | ((unsigned)xs & 0xFFFF));
+}
+
+void transform3d_project(int *dst, const short *x, const short *y, const short *z, int n,
+                         const transform3d_camera *cam, int *bbox)
+{
+    int xe[4], ye[4];
+    bool clipped[4];
+    int i = 0;
+
+#if defined(TRANSFORM3D_AVX2) || defined(TRANSFORM3D_SSE2) || defined(TRANSFORM3D_NEON)
+    for (; i + simd_ops::N <= n; i += simd_ops::N)
+    {
+        for (int k = 0; k < simd_ops::N; k++)
+        {
+            clipped[k] = (int)((unsigned)cam->z - (unsigned)z[i + k]) < cam->nearclip;
+        }
+        project_block<simd_ops>(xe, ye, x + i, y + i, z + i, clipped, cam);
+        for (int k = 0; k < simd_ops::N; k++)
+        {
+            project_store(dst + i + k, xe[k], ye[k], clipped[k], cam, bbox);
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        clipped[0] = (int)((unsigned)cam->z - (unsigned)z[i]) < cam->nearclip;
+        project_block<scalar_ops>(xe, ye, x + i, y + i, z + i, clipped, cam);
+        project_store(dst + i, xe[0], ye[0], clipped[0], cam, bbox);
+    }
+}
+
+int transform3d_project_long(int *xp, int *yp, unsigned char *ok, const int *x, const int *y, const int *z, int n,
+                             const transform3d_camera *cam)
+{
+    int xe[4], ye[4];
+    bool clipped[4];
+    int count = 0;
+    int i = 0;
+
+    for (; i < n;)
+    {
+        int nb = 1;
+
+#if defined(TRANSFORM3D_AVX2) || defined(TRANSFORM3D_SSE2) || defined(TRANSFORM3D_NEON)
+        if (i + simd_ops::N <= n)
+        {
+            nb = simd_ops::N;
+        }
+#endif
+        for (int k = 0; k < nb; k++)
+        {
+            clipped[k] = z[i + k] > cam->zclip;
+        }
+
+#if defined(TRANSFORM3D_AVX2) || defined(TRANSFORM3D_SSE2) || defined(TRANSFORM3D_NEON)
+        if (nb == simd_ops::N)
+            project_block<simd_ops>(xe, ye, x + i, y + i, z + i, clipped, cam);
+        else
+#endif
+            project_block<scalar_ops>(xe, ye, x + i, y + i, z + i, clipped, cam);
+
+        // LongProjectPoint3DF: no overflow test
+        for (int k = 0; k < nb; k++, i++)
+        {
+            if (clipped[k])
+            {
+                xp[i] = yp[i] = INDEFINITE32;
+                ok[i] = 0;
+            }
+            else
+            {
+                xp[i] = (int)((unsigned)xe[k] + (unsigned)cam->xcentre);
+                yp[i] = (int)((unsigned)ye[k] + (unsigned)cam->ycentre);
+                ok[i] = 1;
+                count++;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,48 @@
+#ifndef __TRANSFORM3D_H__
+#define __TRANSFORM3D_H__
+
+// Batched rotation, translation and projection of vertex lists (x, y and z
+// in separate arrays), 4 points at a time with AVX2, 2 with SSE2 or NEON.
+//
+// The results are the ones of the FPU routines of LIB386/3D (the F
+// variants, the ones picked by the Chooser): same operation order, and the
+// FPU at 64 bits precision with nearest rounding (Status_Float of
+// POLY.ASM). The points are computed in double, and a point whose result
+// is too close to a rounding boundary for double to decide is computed
+// again with the 64 bits arithmetic of the FPU.
+//
+// mat is a TYPE_MAT with floats: M11..M33, then TX, TY, TZ.
+
+// LongRotateList / LongRotatePoint (no translation) of n points, results
+// 0x80000000 when they don't fit in 32 bits, like fistp.
+void transform3d_rotate(int *dx, int *dy, int *dz, const int *x, const int *y, const int *z, int n,
+                        const float *mat);
+
+// RotTransList: rotation then translation of n points of 16 bits, results
+// 0x8000 when they don't fit in 16 bits.
+void transform3d_rottrans(short *dx, short *dy, short *dz, const short *x, const short *y, const short *z, int n,
+                          const float *mat);
+
+// Camera of the projections (the globals of CAMERA.H)
+struct transform3d_camera
+{
+    float ratiox, ratioy; // FRatioX, FRatioY
+    int xcentre, ycentre; // XCentre, YCentre
+    int x, y, z;          // ProjectList: OrgX, OrgY, OrgZ; LongProjectPoint: CameraXr, CameraYr, CameraZr
+    int nearclip;         // ProjectList: points with OrgZ - z < nearclip (NearClip) are clipped
+    int zclip;            // LongProjectPoint: points with z > zclip (CameraZrClip) are clipped
+};
+
+// ProjectList3D: n points of 16 bits to dst, (Y << 16) | (X & 0xFFFF), or
+// 0x80008000 for the clipped ones and the ones out of +/-32767. bbox
+// (ScreenXMin, ScreenXMax, ScreenYMin, ScreenYMax) grows to the others.
+void transform3d_project(int *dst, const short *x, const short *y, const short *z, int n,
+                         const transform3d_camera *cam, int *bbox);
+
+// LongProjectPoint3D on n points: ok 1 with the screen point in xp, yp, or
+// ok 0 with xp = yp = 0x80000000 for the clipped ones. Returns the number
+// of points not clipped.
+int transform3d_project_long(int *xp, int *yp, unsigned char *ok, const int *x, const int *y, const int *z, int n,
+                             const transform3d_camera *cam);
+
+#endif // __TRANSFORM3D_H__
@@ -6,6 +6,9 @@
 #include <sdl.h>
 #include <math.h>
 
+#include "polyfill.h"
+#include "transform3d.h"
+
 
 void 	*Phys			;
 void	*Log			;
@@ -310,8 +313,13 @@ end:
 #undef Switch_Fillers
 extern	void	Switch_Fillers(U32 Bank)	;
 
+// Ida - the bank of Fill_Poly_C(), the ASM ones are still in use for the
+// objects (AFF_OBJ.ASM)
+static U32	FillBank ;
+
 void Switch_Fillers_C(U32 Bank)
 {
+	FillBank = Bank ;
 	__asm{
 		pusha
 		mov eax, Bank
@@ -339,25 +347,51 @@ void LongWorldRotatePoint_C(S32 x, S32 y, S32 z)
 }
 
 #undef Fill_Poly
-S32	Fill_PolyMMX(S32 Type_Poly, S32 Color_Poly,
-	S32 Nb_Points, Struc_Point *Ptr_Points);
 
+extern	U8	Fill_Logical_Palette[256]	;
+extern	S32	Fill_Fog_Factor			;
+extern	S32	Fill_ScaledFogNear		;
+extern	U32	*PTR_TabOffLine			;
+
+// Ida - Fill_Poly() with polyfill.cpp, the integer slopes of the ASM fillers
+// (POLY.ASM is built with FORCE_INT)
 S32	Fill_Poly_C(S32 Type_Poly, S32 Color_Poly,
 	S32 Nb_Points, Struc_Point *Ptr_Points)
 {
-	S32 returnValue;
-	__asm {
-		pusha
-		mov eax, Type_Poly
-		mov ebx, Color_Poly
-		mov ecx, Nb_Points
-		mov esi, Ptr_Points
-		call Fill_PolyMMX
-		mov returnValue, eax
-		popa
-	}
+	static polyfill_context	ctx ;
+	S32			ret ;
 
-	return returnValue;
+	ctx.log = (U8*)Log ;
+	ctx.pitch = PTR_TabOffLine[1] - PTR_TabOffLine[0] ;
+	ctx.zbuffer = PtrZBuffer ;
+	ctx.clipxmin = ClipXMin ;
+	ctx.clipymin = ClipYMin ;
+	ctx.clipxmax = ClipXMax ;
+	ctx.clipymax = ClipYMax ;
+	ctx.map = PtrMap ;
+	ctx.repmask = RepMask ;
+	ctx.clutgouraud = PtrCLUTGouraud ;
+	ctx.clutfog = PtrCLUTFog ;
+	memcpy( ctx.palette, Fill_Logical_Palette, 256 ) ;
+	ctx.scaledfognear = Fill_ScaledFogNear ;
+	ctx.fogfactor = Fill_Fog_Factor ;
+	ctx.bank = FillBank ;
+	ctx.hidden = IsPolygonHidden ;
+
+	ret = polyfill_fill( &ctx, Type_Poly, Color_Poly, Nb_Points, (polyfill_point*)Ptr_Points ) ;
+
+	IsPolygonHidden = ctx.hidden ;
+
+	return ret ;
+}
+
+// Ida - ClipperZ() of POLYCLIP.ASM with polyfill.cpp
+U32	ClipperZ(STRUC_CLIPVERTEX dst[], STRUC_CLIPVERTEX src[], U32 nbvertex, S32 zclip, S32 flag)
+{
+	static_assert( sizeof(STRUC_CLIPVERTEX) == sizeof(polyfill_clipvertex), "STRUC_CLIPVERTEX" ) ;
+	static_assert( sizeof(Struc_Point) == sizeof(polyfill_point), "Struc_Point" ) ;
+
+	return polyfill_clipz( (polyfill_clipvertex*)dst, (const polyfill_clipvertex*)src, nbvertex, zclip, flag ) ;
 }
 
 #undef LongProjectPoint
@@ -380,6 +414,65 @@ S32 LongProjectPoint_C(S32 x, S32 y, S32 z)
 	return result;
 }
 
+// Ida - LongWorldRotatePoint() then LongProjectPoint() on n points: X0, Y0,
+// Z0 in rx, ry, rz and, when ok, Xp, Yp in xp, yp. All at once with
+// transform3d.cpp when the routines in use are the FPU ones it reproduces
+// (3D projection), one by one through the pointers else. The globals are
+// left as they are. Returns the number of points projected.
+extern	Func_LongRotatePoint	LongRotatePointF	;
+extern	Func_LongProjectPoint	LongProjectPoint3DF	;
+
+extern	S32	CameraXr, CameraYr, CameraZr, CameraZrClip	;
+extern	S32	XCentre, YCentre, Xp, Yp, X0, Y0, Z0		;
+extern	float	FRatioX, FRatioY				;
+
+S32 LongWorldRotateProjectList_C(S32 n, const S32 *x, const S32 *y, const S32 *z,
+	S32 *rx, S32 *ry, S32 *rz, S32 *xp, S32 *yp, U8 *ok)
+{
+	S32	count = 0 ;
+
+	if( LongRotatePoint == LongRotatePointF AND LongProjectPoint == LongProjectPoint3DF )
+	{
+		transform3d_camera	cam ;
+
+		cam.ratiox = FRatioX ;
+		cam.ratioy = FRatioY ;
+		cam.xcentre = XCentre ;
+		cam.ycentre = YCentre ;
+		cam.x = CameraXr ;
+		cam.y = CameraYr ;
+		cam.z = CameraZr ;
+		cam.nearclip = 0 ;
+		cam.zclip = CameraZrClip ;
+
+		transform3d_rotate( (int*)rx, (int*)ry, (int*)rz, (const int*)x, (const int*)y, (const int*)z,
+				    n, (const float*)&MatriceWorld ) ;
+
+		return transform3d_project_long( (int*)xp, (int*)yp, ok,
+						 (const int*)rx, (const int*)ry, (const int*)rz, n, &cam ) ;
+	}
+
+	S32	x0 = X0, y0 = Y0, z0 = Z0, xs = Xp, ys = Yp ;
+
+	for( S32 i=0; i<n; i++ )
+	{
+		LongWorldRotatePoint_C( x[i], y[i], z[i] ) ;
+
+		rx[i] = X0 ;
+		ry[i] = Y0 ;
+		rz[i] = Z0 ;
+
+		ok[i] = LongProjectPoint_C( X0, Y0, Z0 ) ? 1 : 0 ;
+		xp[i] = Xp ;
+		yp[i] = Yp ;
+		count += ok[i] ;
+	}
+
+	X0 = x0 ; Y0 = y0 ; Z0 = z0 ; Xp = xs ; Yp = ys ;
+
+	return count ;
+}
+
 typedef	void (Func_RotatePoint)(void *Mat, S32 x, S32 y, S32 z) ;
 extern	Func_RotatePoint	*RotatePoint	;
 
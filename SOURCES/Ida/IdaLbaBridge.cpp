@@ -37,6 +37,11 @@ int IdaLbaBridge::getNumZones()
 	return NbZones;
 }
 
+int IdaLbaBridge::getMaxZones()
+{
+	return MAX_ZONES;
+}
+
 int IdaLbaBridge::getNumWaypoints()
 {
     return NbBrickTrack;
@@ -79,6 +84,7 @@ void IdaLbaBridge::setZones(int numZones, void *zonesPtr)
 
 	NbZones = numZones;
 	ListZone = (T_ZONE*)zonesPtr;
+	DirtyZoneIndex();
 }
 
 void IdaLbaBridge::setWaypoints(int numWaypoints, void* waypointsPtr)
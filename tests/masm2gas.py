@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Converts the MASM FPU routines of LIB386/3D to GNU as (x86-64, Intel syntax), so that the recorder runs
+# the very instructions of the game (run_tests.sh record).
+#
+#   masm2gas.py LROT3DF.ASM LPROJ3DF.ASM > asm.S
+#
+# Only what these routines use is handled: the Struc_MatriceMAT fields (H/MAT.INC), the globals (rip
+# relative), esi / esp as base (rsi / rsp), push / pop, local labels. The stack slots are 8 bytes in 64 bits:
+# the esp offsets are doubled. The registers of the routines keep their 32 bits names otherwise.
+
+import re
+import sys
+
+MAT = ['MAT_M11', 'MAT_M12', 'MAT_M13', 'MAT_M21', 'MAT_M22', 'MAT_M23', 'MAT_M31', 'MAT_M32', 'MAT_M33',
+       'MAT_MTX', 'MAT_MTY', 'MAT_MTZ']
+
+SKIP = re.compile(r'^(\.386p|\.model|include|\.data|\.code|extrn|assume|public|end\b)', re.I)
+REG32 = {'eax': 'rax', 'ebx': 'rbx', 'ecx': 'rcx', 'edx': 'rdx', 'esi': 'rsi', 'edi': 'rdi', 'ebp': 'rbp',
+         'esp': 'rsp'}
+
+
+def memory(operand):
+    # [esi].Struc_MatriceMAT.MAT_Mxx
+    m = re.match(r'\[esi\]\.Struc_MatriceMAT\.(\w+)$', operand)
+    if m:
+        return 'dword ptr [rsi+%d]' % (MAT.index(m.group(1)) * 4)
+
+    # dword ptr[esp+n]
+    m = re.match(r'(?:dword ptr\s*)?\[esp(?:\+(\d+))?\]$', operand)
+    if m:
+        offset = int(m.group(1) or 0) * 2
+        return 'dword ptr [rsp+%d]' % offset
+
+    # [Global]
+    m = re.match(r'(?:dword ptr\s*)?\[(\w+)\]$', operand)
+    if m and m.group(1).lower() not in REG32:
+        return 'dword ptr [rip+%s]' % m.group(1)
+
+    return None
+
+
+def operand(text):
+    text = text.strip()
+    mem = memory(text)
+    if mem:
+        return mem
+
+    m = re.match(r'^([0-9][0-9a-f]*)h$', text, re.I)
+    if m:
+        return '0x' + m.group(1)
+
+    # global used as a value: mov edx, CameraZr
+    if re.match(r'^[A-Za-z_]\w*$', text) and text.lower() not in REG32 and not re.match(r'^st$', text):
+        return 'dword ptr [rip+%s]' % text
+
+    return text
+
+
+def convert(path, out):
+    proc = None
+    for raw in open(path, encoding='latin-1'):
+        line = raw.split(';')[0].strip(' \t\r\n\x1a')  # 0x1a: DOS end of file
+        if not line or SKIP.match(line):
+            continue
+
+        m = re.match(r'^(\w+)\s+proc\b', line, re.I)
+        if m:
+            proc = m.group(1)
+            out.write('\n\t.globl\t%s\n%s:\n' % (proc, proc))
+            continue
+        if re.match(r'^\w+\s+endp\b', line, re.I):
+            proc = None
+            continue
+
+        m = re.match(r'^(\w+):\s*(.*)$', line)
+        if m:
+            out.write('.L%s_%s:\n' % (proc, m.group(1)))
+            line = m.group(2)
+            if not line:
+                continue
+
+        m = re.match(r'^(\w+)\s*(.*)$', line)
+        op, args = m.group(1).lower(), m.group(2)
+
+        if op.startswith('j'):
+            out.write('\t%s\t.L%s_%s\n' % (op, proc, args.strip()))
+        elif op in ('push', 'pop'):
+            out.write('\t%s\t%s\n' % (op, REG32[args.strip().lower()]))
+        elif args:
+            # split on the commas outside of brackets and parentheses
+            parts, depth, cur = [], 0, ''
+            for c in args:
+                if c in '[(':
+                    depth += 1
+                elif c in '])':
+                    depth -= 1
+                if c == ',' and not depth:
+                    parts.append(cur)
+                    cur = ''
+                else:
+                    cur += c
+            parts.append(cur)
+            out.write('\t%s\t%s\n' % (op, ', '.join(operand(p) for p in parts)))
+        else:
+            out.write('\t%s\n' % op)
+
+
+def main():
+    out = sys.stdout
+    out.write('// generated by masm2gas.py from %s\n' % ' '.join(sys.argv[1:]))
+    out.write('\t.intel_syntax noprefix\n\t.text\n')
+    for path in sys.argv[1:]:
+        convert(path, out)
+    out.write('\t.section .note.GNU-stack,"",@progbits\n')
+
+
+main()
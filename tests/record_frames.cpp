@@ -0,0 +1,163 @@
+// Records terrain frames in the format of the TERRAIN.CPP capture (IDA_TRANSFORM_CAPTURE) with the ASM
+// routines themselves: LROT3DF.ASM and LPROJ3DF.ASM, converted by masm2gas.py, run on the FPU at the
+// precision of Status_Float. Built and run by run_tests.sh record.
+//
+// Each frame is AffichageTerrainZBuf(): a camera as SetAngleCamera() sets it (CameraXr.. by
+// LongRotatePoint, CameraZrClip = CameraZr - NearClip), then for the 65 x 65 points of the cube
+// LongWorldRotatePoint, the cone clipping and LongProjectPoint. Only a few points of each frame are written,
+// so that many cameras fit in a small file: half are the ones whose result is closest to a half integer
+// (where a double computation would round differently), half are evenly spaced.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef int32_t S32;
+
+// the globals of the ASM
+extern "C"
+{
+    S32 X0, Y0, Z0;
+    S32 CameraX, CameraY, CameraZ;
+    S32 CameraXr, CameraYr, CameraZr, CameraZrClip;
+    float FRatioX, FRatioY;
+    S32 XCentre, YCentre, Xp, Yp;
+}
+
+static const int NB_COTE = 64;
+static const S32 NEAR_CLIP = 3000;  // CLIP_NEAR
+static const S32 CLIP_Z_FAR = 48000;
+static const uint16_t STATUS_FLOAT = 0x37F;  // POLY.ASM: 64 bits precision, nearest
+
+// Watcom register calls
+static void LongRotatePointF(const float *mat, S32 x, S32 y, S32 z)
+{
+    __asm__ volatile("call LongRotatePointF" : "+a"(x), "+b"(y), "+c"(z) : "S"(mat) : "memory", "cc");
+}
+
+static S32 LongProjectPoint3DF(S32 x, S32 y, S32 z)
+{
+    __asm__ volatile("call LongProjectPoint3DF" : "+a"(x), "+b"(y), "+c"(z) : : "rdx", "memory", "cc");
+    return x;
+}
+
+// distance of a value to the nearest half integer, in units of its last bit: how hard it is to round
+static double Hardness(long double v)
+{
+    long double f = v - floorl(v);
+    return fabsl(f - 0.5L) / (fabsl(v) * 0x1p-63L + 0x1p-64L);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = argc > 1 ? argv[1] : "transform_frames.bin";
+    int frames = argc > 2 ? atoi(argv[2]) : 800;
+    int keep = argc > 3 ? atoi(argv[3]) : 4;
+
+    FILE *file = fopen(name, "wb");
+    if (!file)
+    {
+        printf("can't write %s\n", name);
+        return 1;
+    }
+
+    __asm__ volatile("fldcw %0" : : "m"(STATUS_FLOAT));
+
+    std::mt19937 rnd(1998);
+    S32 total = 0;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // MatriceWorld: camera angles, no translation
+        float mat[12] = {};
+        auto angle = [&]() { return (double)(rnd() % 4096) * 2 * M_PI / 4096; };
+        double a = angle(), b = angle(), c = angle();
+        double ca = cos(a), sa = sin(a), cb = cos(b), sb = sin(b), cc = cos(c), sc = sin(c);
+        double r[9] = {cb * cc, -cb * sc, sb, sa * sb * cc + ca * sc, -sa * sb * sc + ca * cc, -sa * cb,
+                       -ca * sb * cc + sa * sc, ca * sb * sc + sa * cc, ca * cb};
+        for (int n = 0; n < 9; n++) mat[n] = (float)r[n];
+
+        // SetProjection() / SetAngleCamera()
+        S32 factorx = 300 + (S32)(rnd() % 700), factory = factorx + (S32)(rnd() % 200) - 100;
+        FRatioX = (float)factorx;
+        FRatioY = (float)(-(long double)factory / factorx);
+        XCentre = 320;
+        YCentre = 240;
+        CameraX = (S32)(rnd() % 40000) - 4000;
+        CameraY = 2000 + (S32)(rnd() % 20000);
+        CameraZ = (S32)(rnd() % 40000) - 4000;
+        LongRotatePointF(mat, CameraX, CameraY, CameraZ);
+        CameraXr = X0;
+        CameraYr = Y0;
+        CameraZr = Z0;
+        CameraZrClip = Z0 - NEAR_CLIP;
+
+        // a height map of the cube (MapSommetY)
+        double phase = angle(), freq = 1 + rnd() % 6;
+        std::vector<S32> points;
+        std::vector<double> hardness;
+        for (S32 z = 0; z <= NB_COTE * 512; z += 512)
+        {
+            for (S32 x = 0; x <= NB_COTE * 512; x += 512)
+            {
+                S32 y = (S32)(6000 + 5000 * sin(freq * x / 32768.0 + phase) * cos(freq * z / 32768.0)) +
+                        (S32)(rnd() % 256);
+
+                // AffichageTerrainZBuf()
+                LongRotatePointF(mat, x, y, z);
+                S32 zr = CameraZr - Z0;
+                S32 proj = zr > NEAR_CLIP && zr < CLIP_Z_FAR;
+                S32 ret = proj && LongProjectPoint3DF(X0, Y0, Z0);
+                S32 point[10] = {x, y, z, X0, Y0, Z0, proj, ret, proj ? Xp : 0, proj ? Yp : 0};
+                points.insert(points.end(), point, point + 10);
+
+                long double X = x, Y = y, Z = z;
+                double h = std::min({Hardness((X * mat[0] + Y * mat[1]) + Z * mat[2]),
+                                     Hardness(Z * mat[5] + (Y * mat[4] + X * mat[3])),
+                                     Hardness((X * mat[6] + Y * mat[7]) + Z * mat[8])});
+                if (ret)
+                {
+                    long double inv = (long double)FRatioX / (CameraZr - Z0);
+                    h = std::min({h, Hardness((X0 - CameraXr) * inv),
+                                  Hardness(((Y0 - CameraYr) * inv) * FRatioY)});
+                }
+                hardness.push_back(h);
+            }
+        }
+
+        // the hardest half, then evenly spaced
+        S32 nb = (S32)hardness.size();
+        std::vector<int> order(nb);
+        for (int n = 0; n < nb; n++) order[n] = n;
+        std::sort(order.begin(), order.end(), [&](int i, int j) { return hardness[i] < hardness[j]; });
+        std::vector<char> kept(nb);
+        for (int n = 0; n < keep / 2 && n < nb; n++) kept[order[n]] = 1;
+        for (int n = 0, left = keep - std::min(keep / 2, nb); n < nb && left; n += nb / (keep - keep / 2))
+        {
+            if (!kept[n]) kept[n] = 1, left--;
+        }
+
+        S32 count = 0;
+        for (int n = 0; n < nb; n++) count += kept[n];
+
+        S32 camera[6] = {XCentre, YCentre, CameraXr, CameraYr, CameraZr, CameraZrClip};
+        fwrite(&count, sizeof(S32), 1, file);
+        fwrite(mat, sizeof(float), 12, file);
+        fwrite(&FRatioX, sizeof(float), 1, file);
+        fwrite(&FRatioY, sizeof(float), 1, file);
+        fwrite(camera, sizeof(S32), 6, file);
+        for (int n = 0; n < nb; n++)
+        {
+            if (kept[n]) fwrite(&points[n * 10], sizeof(S32), 10, file);
+        }
+        total += count;
+    }
+
+    fclose(file);
+    printf("%s: %d frames, %d points\n", name, frames, total);
+    return 0;
+}
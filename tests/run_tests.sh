@@ -0,0 +1,176 @@
+#!/bin/sh
+# Builds and runs the checks of the C++ units of the game (Linux, g++).
+#
+# Each test_<name>.cpp is compiled with the very sources it checks (LIB386,
+# LIB386/smacker, LIB386/ail, Ida/src/common) and fails when their results
+# differ from the recorded checksums or from the reference it computes.
+#
+#   ./run_tests.sh [name...]                 every test, or the ones named
+#   ./run_tests.sh record [frames] [points]  transform_frames.bin, recorded
+#                                            with the ASM of LIB386/3D
+#
+# CXXFLAGS is added to every build (-fsanitize=thread for spsc and voices).
+# Game files can be checked too: SAMPLES (SAMPLES.HQR, *.VOX) for adpcm,
+# VIDEOS (VIDEO.HQR, *.smk) for smacker, TEXT_HQR (TEXT.HQR) for text.
+# What a test writes on stderr goes to build/<name>.log.
+
+set -u
+
+cd "$(dirname "$0")"
+mkdir -p build/shim
+
+CXX=${CXX:-g++}
+CC=${CC:-gcc}
+CXXFLAGS=${CXXFLAGS:-}
+SOLOUD=../soloud
+
+# the sources include <system\adeline.h>: outside of Windows the backslash is
+# part of the file name
+cat > "build/shim/system\\adeline.h" <<'SHIM'
+typedef unsigned char U8;
+typedef unsigned int U32;
+typedef int S32;
+#define AND &&
+#define OR ||
+SHIM
+: > "build/shim/system\\lz.h"
+cp ../LIB386/H/AIL/AUDIO.H "build/shim/ail\\audio.h"
+
+if [ "${1:-}" = "record" ]; then
+    set -e
+    python3 masm2gas.py ../LIB386/3D/LROT3DF.ASM ../LIB386/3D/LPROJ3DF.ASM > build/asm_fpu.S
+    $CXX -std=c++17 -O2 -mno-red-zone -o build/record_frames record_frames.cpp build/asm_fpu.S
+    ./build/record_frames transform_frames.bin "${2:-800}" "${3:-4}"
+    exit 0
+fi
+
+NAMES="$*"
+passed=0
+failed=0
+skipped=0
+failures=""
+
+selected() {
+    [ -z "$NAMES" ] && return 0
+    for n in $NAMES; do
+        [ "$n" = "$1" ] && return 0
+    done
+    return 1
+}
+
+fail() {
+    failed=$((failed + 1))
+    failures="$failures $1"
+}
+
+# obj <object> <compiler, flags and source>: build/<object>.o
+obj() {
+    out=$1
+    shift
+    "$@" -c -o "build/$out.o"
+}
+
+# run <name> <test> "<sources and flags>" [arguments]
+run() {
+    name=$1
+    test=$2
+    build=$3
+    shift 3
+    selected "$test" || return 0
+
+    echo "== $name"
+    # shellcheck disable=SC2086
+    if ! $CXX -std=c++17 -O2 $CXXFLAGS -I. -o "build/$name" "test_$test.cpp" $build 2> "build/$name.log"; then
+        cat "build/$name.log"
+        echo "[x] $name: build failed"
+        fail "$name"
+        return 0
+    fi
+    if "./build/$name" "$@" 2>> "build/$name.log"; then
+        echo "[v] $name"
+        passed=$((passed + 1))
+    else
+        echo "[x] $name: FAILED (stderr in build/$name.log)"
+        fail "$name"
+    fi
+    echo
+}
+
+skip() {
+    selected "$1" || return 0
+    echo "== $1"
+    echo "[-] $1: skipped, $2"
+    echo
+    skipped=$((skipped + 1))
+}
+
+obj lzc $CXX -O2 -Ibuild/shim ../LIB386/SYSTEM/LZC.CPP
+for f in smacker smk_bitstream smk_hufftree; do
+    obj $f $CC -O2 -w ../LIB386/smacker/$f.c
+done
+SMACKER="-I../LIB386/smacker build/smacker.o build/smk_bitstream.o build/smk_hufftree.o"
+COMMON="-I../Ida/src/common"
+TRANSFORM3D="-I../LIB386 ../LIB386/transform3d.cpp"
+AVX2=$(grep -q avx2 /proc/cpuinfo 2>/dev/null && echo 1)
+
+run adpcm adpcm "-I../LIB386 ../LIB386/adpcm.cpp ../LIB386/ima_adpcm.cpp build/lzc.o" ${SAMPLES:-}
+
+if [ -f "$SOLOUD/include/soloud.h" ]; then
+    if [ ! -f build/soloud.a ] && selected audio; then
+        for f in $SOLOUD/src/core/*.cpp $SOLOUD/src/backend/null/soloud_null.cpp \
+            $SOLOUD/src/audiosource/wav/soloud_wav.cpp $SOLOUD/src/audiosource/wav/dr_impl.cpp; do
+            obj "soloud_$(basename "$f" .cpp)" $CXX -O2 -w -DWITH_NULL -I$SOLOUD/include "$f"
+        done
+        obj soloud_stb_vorbis $CC -O2 -w $SOLOUD/src/audiosource/wav/stb_vorbis.c
+        ar rcs build/soloud.a build/soloud_*.o
+    fi
+    run audio audio "-DWITH_NULL -Ibuild/shim -I$SOLOUD/include -I../LIB386/H ../LIB386/ail/AUDIO.CPP build/soloud.a -lpthread"
+else
+    skip audio "no SoLoud in $SOLOUD (git submodule update --init soloud)"
+fi
+
+run collision collision "$COMMON"
+run decors decors "$COMMON $TRANSFORM3D"
+run dirtybox dirtybox "-I../LIB386 ../LIB386/dirtytiles.cpp"
+run grille grille "$COMMON"
+run particles particles "$COMMON $TRANSFORM3D"
+
+obj polyfill_scalar $CXX -O2 -DPOLYFILL_NOSIMD ../LIB386/polyfill.cpp
+obj polyfill_sse2 $CXX -O2 ../LIB386/polyfill.cpp
+run polyfill-scalar polyfill "-I../LIB386 build/polyfill_scalar.o"
+run polyfill-sse2 polyfill "-I../LIB386 build/polyfill_sse2.o"
+if [ -n "$AVX2" ]; then
+    obj polyfill_avx2 $CXX -O2 -mavx2 ../LIB386/polyfill.cpp
+    run polyfill-avx2 polyfill "-I../LIB386 build/polyfill_avx2.o"
+fi
+
+obj scale2x_scalar $CXX -O2 -mno-sse2 -U__SSE2__ ../LIB386/scale2x.cpp
+obj scale2x_sse2 $CXX -O2 ../LIB386/scale2x.cpp
+run scale2x-scalar scale2x "-I../LIB386 build/scale2x_scalar.o"
+run scale2x-sse2 scale2x "-I../LIB386 build/scale2x_sse2.o"
+
+run smacker smacker "$SMACKER build/lzc.o" ${VIDEOS:-}
+run smkstream smkstream "$SMACKER"
+run sort sort "$COMMON"
+run spsc spsc "$COMMON -pthread"
+run terrain terrain "$COMMON $TRANSFORM3D"
+run text text "$COMMON build/lzc.o" ${TEXT_HQR:-}
+
+obj transform3d_scalar $CXX -O2 -DTRANSFORM3D_NOSIMD ../LIB386/transform3d.cpp
+obj transform3d_sse2 $CXX -O2 ../LIB386/transform3d.cpp
+run transform3d-scalar transform3d "-I../LIB386 build/transform3d_scalar.o" transform_frames.bin
+run transform3d-sse2 transform3d "-I../LIB386 build/transform3d_sse2.o" transform_frames.bin
+if [ -n "$AVX2" ]; then
+    obj transform3d_avx2 $CXX -O2 -mavx2 ../LIB386/transform3d.cpp
+    run transform3d-avx2 transform3d "-I../LIB386 build/transform3d_avx2.o" transform_frames.bin
+fi
+
+run voices voices "$COMMON -pthread"
+run zones zones "$COMMON"
+
+echo "== $passed passed, $failed failed, $skipped skipped"
+if [ $failed -ne 0 ]; then
+    echo "FAILED:$failures"
+    exit 1
+fi
+exit 0
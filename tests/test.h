@@ -0,0 +1,72 @@
+// Helpers of the checks built by run_tests.sh: checksums of what a check
+// draws or decodes, timings and files.
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// CRC-32 (zlib), crc 0 to start
+static inline uint32_t TestCrc(uint32_t crc, const void *data, size_t size)
+{
+    static uint32_t table[256];
+    if (!table[1])
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c >> 1) ^ (c & 1 ? 0xEDB88320 : 0);
+            table[n] = c;
+        }
+    }
+
+    const unsigned char *p = (const unsigned char *)data;
+    crc = ~crc;
+    while (size--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// One line per checked set: its checksum against the one recorded with the
+// code it replaces. Returns 1 on a mismatch, to be added to the failures.
+static inline int TestExpect(const char *name, uint32_t crc, uint32_t expected)
+{
+    printf("%-24s %08x  %08x  %s\n", name, crc, expected, crc == expected ? "identical" : "MISMATCH");
+    return crc != expected;
+}
+
+// seconds per call of f, over repeat calls
+template <typename F>
+static double TestTime(F f, int repeat)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < repeat; n++) f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+}
+
+static inline uint32_t TestGet32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int TestGet16(const unsigned char *p)
+{
+    return (short)(p[0] | (p[1] << 8));
+}
+
+static inline bool TestReadFile(const char *name, std::vector<unsigned char> &data)
+{
+    FILE *f = fopen(name, "rb");
+    if (!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    data.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+#endif // __TEST_H__
@@ -0,0 +1,166 @@
+// IMA ADPCM decoder check and benchmark: adpcm_decode_frame() (LIB386/adpcm.cpp,
+// what SAMPLE.CPP used to call per 0x200 bytes block) against
+// ima_adpcm_decode() (LIB386/ima_adpcm.cpp).
+//
+// Arguments are HQR files (SAMPLES.HQR, *.VOX): every 4 bits RIFF sample
+// they contain is decoded both ways and compared. Without arguments (or in
+// addition) random data is used, which goes through every step index and
+// the clamping.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ima_adpcm.h"
+#include "test_hqr.h"
+
+int adpcm_decode_init(int numChannels);
+int adpcm_decode_frame(void *data, int *data_size, unsigned char *buf, int buf_size);
+
+static const int BLOCK_SIZE = 0x200;
+
+struct Payload
+{
+    std::string name;
+    std::vector<unsigned char> data;
+};
+
+// same loop as the old PlaySample()
+static int DecodeReference(short *out, const unsigned char *in, int size)
+{
+    short *start = out;
+
+    adpcm_decode_init(1);
+    while (size)
+    {
+        int frameSize = BLOCK_SIZE;
+        if (frameSize > size) frameSize = size;
+
+        int decodedSize;
+        adpcm_decode_frame(out, &decodedSize, (unsigned char *)in, frameSize);
+
+        in += frameSize;
+        size -= frameSize;
+        out += decodedSize / 2;
+    }
+    return (int)(out - start);
+}
+
+// ADPCM payload of a 4 bits RIFF sample (same parsing as SAMPLE.CPP)
+static bool ExtractAdpcm(const std::vector<unsigned char> &wav, std::vector<unsigned char> &out)
+{
+    if (wav.size() < 44 || memcmp(wav.data(), "RIFF", 4)) return false;
+    if (TestGet16(&wav[22]) != 1 || TestGet16(&wav[34]) != 4) return false;
+
+    for (size_t pos = 36; pos + 8 <= wav.size(); pos++)
+    {
+        if (!memcmp(&wav[pos], "data", 4))
+        {
+            size_t size = TestGet32(&wav[pos + 4]);
+            if (pos + 8 + size > wav.size()) size = wav.size() - pos - 8;
+            out.assign(wav.begin() + pos + 8, wav.begin() + pos + 8 + size);
+            return true;
+        }
+    }
+    return false;
+}
+
+// the 4 bits RIFF samples of an HQR file
+static void LoadHQR(const char *name, std::vector<Payload> &payloads, int &skipped)
+{
+    std::vector<unsigned char> file;
+    if (!TestReadFile(name, file) || !TestHqrBlocks(file,
+                                                    [&](uint32_t n, const std::vector<unsigned char> &block)
+                                                    {
+                                                        Payload payload;
+                                                        if (!ExtractAdpcm(block, payload.data))
+                                                        {
+                                                            skipped++;
+                                                            return;
+                                                        }
+
+                                                        char blockName[512];
+                                                        snprintf(blockName, sizeof(blockName), "%s[%u]", name, n);
+                                                        payload.name = blockName;
+                                                        payloads.push_back(payload);
+                                                    }))
+    {
+        printf("can't read %s\n", name);
+    }
+}
+
+// MB/s of decode over all the payloads
+template <typename Decode>
+static double Throughput(const std::vector<Payload> &payloads, std::vector<short> &out, Decode decode)
+{
+    double bytes = 0;
+    for (const Payload &p : payloads) bytes += p.data.size();
+
+    double seconds = TestTime([&]
+                              {
+                                  for (const Payload &p : payloads) decode(out.data(), p.data.data(), (int)p.data.size());
+                              },
+                              20);
+    return bytes / (1024.0 * 1024.0) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Payload> payloads;
+    int skipped = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        LoadHQR(argv[i], payloads, skipped);
+    }
+
+    printf("%d samples from %d file(s) (%d blocks not 4 bits samples)\n", (int)payloads.size(), argc - 1, skipped);
+
+    // random payloads, odd sizes included (short last block)
+    std::mt19937 rnd(1234);
+    for (int n = 0; n < 64; n++)
+    {
+        Payload payload;
+        payload.name = "random";
+        payload.data.resize(1 + rnd() % 0x10000);
+        for (unsigned char &c : payload.data) c = (unsigned char)rnd();
+        payloads.push_back(payload);
+    }
+
+    size_t maxSize = 0;
+    for (const Payload &p : payloads)
+    {
+        if (p.data.size() > maxSize) maxSize = p.data.size();
+    }
+
+    std::vector<short> ref(maxSize * 4 + 16);
+    std::vector<short> out(maxSize * 4 + 16);
+    int failed = 0;
+
+    for (const Payload &p : payloads)
+    {
+        int nbRef = DecodeReference(ref.data(), p.data.data(), (int)p.data.size());
+        int nbOut = ima_adpcm_decode(out.data(), p.data.data(), (int)p.data.size(), BLOCK_SIZE);
+
+        if (nbRef != nbOut || nbOut != ima_adpcm_decoded_samples((int)p.data.size(), BLOCK_SIZE) ||
+            memcmp(ref.data(), out.data(), nbOut * sizeof(short)))
+        {
+            printf("MISMATCH %s (%d bytes): %d vs %d samples\n", p.name.c_str(), (int)p.data.size(), nbRef, nbOut);
+            failed++;
+        }
+    }
+
+    printf("%d payloads checked, %d mismatch\n", (int)payloads.size(), failed);
+    if (failed) return 1;
+
+    double refSpeed = Throughput(payloads, ref, [](short *o, const unsigned char *i, int s) { return DecodeReference(o, i, s); });
+    double newSpeed = Throughput(payloads, out, [](short *o, const unsigned char *i, int s) { return ima_adpcm_decode(o, i, s, BLOCK_SIZE); });
+
+    printf("adpcm_decode_frame: %8.1f MB/s\n", refSpeed);
+    printf("ima_adpcm_decode:   %8.1f MB/s (x%.2f)\n", newSpeed, newSpeed / refSpeed);
+
+    return 0;
+}
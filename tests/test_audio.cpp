@@ -0,0 +1,154 @@
+// Shared audio engine check and benchmark (LIB386/ail/AUDIO.CPP), SoLoud
+// null backend (no device, the mixing is done by calling Soloud::mix()).
+//
+// - video start: time from "play this video" to its sound tracks playing
+//   on the video bus, and the time to stop them
+// - mixer: time to mix 10 s of 8 samples, a music and 2 video tracks
+// - voices: for each SampleVoices setting, the samples voices, the music
+//   and the 7 video tracks play at once: SoLoud must mix every one of them
+//   (it only mixes its loudest "max active" voices, the others go virtual),
+//   with the cap SetAudioSampleVoices() derives from the setting
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "soloud.h"
+#include "soloud_bus.h"
+#include "soloud_wav.h"
+
+typedef int S32;
+typedef unsigned int U32;
+#include "AIL/AUDIO.H"
+
+#include "test.h"
+
+static const int RATE = 44100;
+static const int NB_SAMPLES = 8;
+static const int NB_VIDEO_TRACKS = 2;
+static const int MIX_SECONDS = 10;
+static const int MIX_BLOCK = 512;
+
+// one second of a tone, looped
+static void MakeWave(SoLoud::Wav &wav, int rate, int channels, double frequency)
+{
+    std::vector<short> data(rate * channels);
+    for (int i = 0; i < rate; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            data[i * channels + c] = (short)(8000 * sin(2 * M_PI * frequency * i / rate));
+        }
+    }
+    wav.loadRawWave16(data.data(), (unsigned int)data.size(), (float)rate, channels);
+}
+
+// mixes seconds of audio, returns the time it took (s)
+static double Mix(int seconds)
+{
+    std::vector<float> buffer(MIX_BLOCK * 2);
+
+    return TestTime([&] { gSoloud->mix(buffer.data(), MIX_BLOCK); }, RATE * seconds / MIX_BLOCK) *
+           (RATE * seconds / MIX_BLOCK);
+}
+
+static SoLoud::handle PlayLooped(S32 bus, SoLoud::Wav &wav)
+{
+    SoLoud::handle handle = AudioBus(bus)->play(wav);
+    gSoloud->setLooping(handle, true);
+    return handle;
+}
+
+//----------------------------------------------------------------------------
+
+static void Bench()
+{
+    const int runs = 50;
+    SoLoud::Wav samples[NB_SAMPLES], music, video[NB_VIDEO_TRACKS];
+
+    for (int i = 0; i < NB_SAMPLES; i++) MakeWave(samples[i], 22050, 1, 200 + 50 * i);
+    MakeWave(music, 44100, 2, 440);
+    for (int i = 0; i < NB_VIDEO_TRACKS; i++) MakeWave(video[i], 22050, 2, 300 + 100 * i);
+
+    double start = 0, stop = 0;
+    for (int n = 0; n < runs; n++)
+    {
+        SoLoud::handle handles[NB_VIDEO_TRACKS];
+        start += TestTime([&]
+                          {
+                              for (int i = 0; i < NB_VIDEO_TRACKS; i++)
+                                  handles[i] = AudioBus(AUDIO_BUS_VIDEO)->play(video[i], -1, 0, false);
+                          },
+                          1);
+        stop += TestTime([&] { for (int i = 0; i < NB_VIDEO_TRACKS; i++) gSoloud->stop(handles[i]); }, 1);
+    }
+
+    std::vector<SoLoud::handle> handles;
+    for (SoLoud::Wav &wav : samples) handles.push_back(PlayLooped(AUDIO_BUS_SAMPLES, wav));
+    handles.push_back(PlayLooped(AUDIO_BUS_MUSIC, music));
+    for (SoLoud::Wav &wav : video) handles.push_back(PlayLooped(AUDIO_BUS_VIDEO, wav));
+
+    double mix = Mix(MIX_SECONDS);
+
+    for (SoLoud::handle handle : handles) gSoloud->stop(handle);
+
+    printf("video start:  %8.1f us\n", start * 1e6 / runs);
+    printf("video stop:   %8.1f us\n", stop * 1e6 / runs);
+    printf("mixer, %d s:  %8.1f ms (%.2f%% of a core)\n", MIX_SECONDS, mix * 1e3, mix * 100 / MIX_SECONDS);
+}
+
+// voices SoLoud mixes, for every SampleVoices setting: errors
+static int Voices()
+{
+    const int settings[] = {12, 32, 64, 128, 256};
+    int errors = 0;
+
+    SoLoud::Wav sample, music, video;
+    MakeWave(sample, 22050, 1, 300);
+    MakeWave(music, 44100, 2, 440);
+    MakeWave(video, 22050, 2, 200);
+
+    printf("\nSampleVoices  playing    mixed  1 s mixed in\n");
+    for (int samples : settings)
+    {
+        // SetSampleVoices() passes the setting on
+        SetAudioSampleVoices(samples);
+
+        std::vector<SoLoud::handle> handles;
+        for (int i = 0; i < samples; i++) handles.push_back(PlayLooped(AUDIO_BUS_SAMPLES, sample));
+        handles.push_back(PlayLooped(AUDIO_BUS_MUSIC, music));
+        for (int i = 0; i < AUDIO_MAX_STREAMS - 1; i++) handles.push_back(PlayLooped(AUDIO_BUS_VIDEO, video));
+
+        double us = Mix(1) * 1e6;
+        unsigned int playing = gSoloud->getVoiceCount();
+        unsigned int mixed = gSoloud->getActiveVoiceCount();
+
+        for (SoLoud::handle handle : handles) gSoloud->stop(handle);
+
+        if (mixed != playing) errors++;
+        printf("%12d  %7u  %7u  %9.0f us%s\n", samples, playing, mixed, us, mixed != playing ? "   MISSING" : "");
+    }
+
+    printf("%s\n", errors ? "MISMATCH: voices left silent" : "every voice mixed");
+    return errors;
+}
+
+int main()
+{
+    double open = 0;
+    S32 failed = 0;
+
+    open = TestTime([&] { failed = InitAudioEngine(RATE, 2, SoLoud::Soloud::NULLDRIVER); }, 1);
+    if (failed)
+    {
+        printf("can't open the audio engine\n");
+        return 1;
+    }
+    printf("shared engine opened in %.0f us\n", open * 1e6);
+
+    Bench();
+    int errors = Voices();
+
+    ClearAudioEngine();
+    return errors ? 1 : 0;
+}
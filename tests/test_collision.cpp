@@ -0,0 +1,424 @@
+// Object collision broadphase check and benchmark: CheckObjCol() of OBJECT.CPP on ObjectGrid
+// (Ida/src/common/ObjectGrid.h) with a growing number of actors, headless.
+//
+// A scene of walking actors runs the main loop of PERSO.CPP: each actor moves, CheckObjCol() pushes it
+// out of the others (carriers, walking on someone, the coin recal and the retest of the same object),
+// then the position is committed. Now and then an actor is put next to another one (PosObjetAroundAnother)
+// or changes its ZV (GereAnimAction), the extras hit whatever is in their box.
+//
+// The candidates come from ObjectGrid, the current object always in, a rebuild after DirtyObjGrid().
+// The checksum of the positions, ObjCol and hits of every frame was recorded with the old full loops
+// over every object. The grid queries are checked against a brute force scan too.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ObjectGrid.h"
+#include "test.h"
+
+static const int SIZE_BRICK_Y = 256;  // COMMON.H
+static const int OBJ_CARRIER = 1;
+static const int INVISIBLE = 2;
+
+struct Object
+{
+    int32_t x = 0, y = 0, z = 0;
+    int16_t xMin = 0, yMin = 0, zMin = 0, xMax = 0, yMax = 0, zMax = 0;
+    int32_t oldX = 0, oldZ = 0;
+    int body = 0;  // -1: no body
+    int flags = 0;
+    int carryBy = -1;
+    int objCol = 255;
+    int hitBy = 255;
+    int walkX = 0, walkZ = 0;
+};
+
+class Scene
+{
+public:
+    Scene(int count, unsigned seed) : mObjects(count), mGrid(count), mList(count)
+    {
+        std::mt19937 rnd(seed);
+        for (Object &o : mObjects)
+        {
+            int size = 100 + rnd() % 250;
+            o.xMin = o.zMin = (int16_t)-size;
+            o.xMax = o.zMax = (int16_t)size;
+            o.yMax = (int16_t)(300 + rnd() % 600);
+            o.x = rnd() % Area;
+            o.z = rnd() % Area;
+            o.y = (rnd() % 8 == 0) ? 0 : SIZE_BRICK_Y * (rnd() % 2);
+            o.body = rnd() % 20 ? 0 : -1;
+            o.flags = (rnd() % 25 == 0 ? OBJ_CARRIER : 0) | (rnd() % 30 == 0 ? INVISIBLE : 0);
+        }
+    }
+
+    // one frame of the main loop
+    void frame(std::mt19937 &rnd)
+    {
+        dirty();  // moved since the last frame
+
+        // GereExtras(): a few extras check their box
+        for (int e = 0; e < 8; e++)
+        {
+            int32_t x = rnd() % Area, z = rnd() % Area, y = rnd() % 600;
+            int owner = rnd() % (int)mObjects.size();
+            mHits += extraCheck(x - 40, y, z - 40, x + 40, y + 80, z + 40, owner);
+        }
+        dirty();
+
+        for (int i = 0; i < (int)mObjects.size(); i++)
+        {
+            setCurrent(i);
+            Object &o = mObjects[i];
+
+            // DoDir / DoTrack: walk
+            if (rnd() % 16 == 0)
+            {
+                o.walkX = (int)(rnd() % 81) - 40;
+                o.walkZ = (int)(rnd() % 81) - 40;
+            }
+            o.oldX = o.x;
+            o.oldZ = o.z;
+            mNxw = o.x + o.walkX;
+            mNyw = o.y;
+            mNzw = o.z + o.walkZ;
+            mOldX = o.x;
+            mOldY = o.y;
+            mOldZ = o.z;
+
+            // DoAnim
+            mTime += TestTime([&] { checkObjCol(i); }, 1) * 1e6;
+            mChecks++;
+
+            if (mNxw < 0 || mNxw > Area || mNzw < 0 || mNzw > Area)
+            {
+                o.walkX = -o.walkX;
+                o.walkZ = -o.walkZ;
+                mNxw = o.x;
+                mNzw = o.z;
+            }
+            o.x = mNxw;
+            o.y = mNyw;
+            o.z = mNzw;
+
+            // DoLife: PosObjetAroundAnother(), a new ZV
+            int r = rnd() % 400;
+            if (r == 0)
+            {
+                Object &t = mObjects[rnd() % mObjects.size()];
+                t.x = o.x + o.xMax - t.xMin + 1;
+                t.z = o.z;
+                dirty();
+            }
+            else if (r == 1)
+            {
+                int size = 100 + rnd() % 250;
+                o.xMin = o.zMin = (int16_t)-size;
+                o.xMax = o.zMax = (int16_t)size;
+                dirty();
+            }
+        }
+        setCurrent(-1);
+    }
+
+    // checksum of what the frame left
+    uint32_t trace(uint32_t crc) const
+    {
+        for (const Object &o : mObjects)
+        {
+            int32_t v[6] = {o.x, o.y, o.z, o.objCol, o.hitBy, o.carryBy};
+            crc = TestCrc(crc, v, sizeof(v));
+        }
+        return TestCrc(crc, &mHits, sizeof(mHits));
+    }
+
+    double checkUs() const
+    {
+        return mTime / mChecks;
+    }
+
+    double candidates() const
+    {
+        return (double)mCandidates / mQueries;
+    }
+
+    static const int Area = 16 * 512;  // 16 bricks
+
+private:
+    // OBJECT.CPP glue
+    void dirty()
+    {
+        mDirty = true;
+    }
+
+    void insert(int n)
+    {
+        const Object &o = mObjects[n];
+        mGrid.insert(n, o.x + o.xMin, o.z + o.zMin, o.x + o.xMax, o.z + o.zMax);
+    }
+
+    void setCurrent(int n)
+    {
+        if (mCurrent != -1 && !mDirty) insert(mCurrent);
+        mCurrent = n;
+    }
+
+    // candidates of GetObjGridCandidates()
+    int candidates(int32_t x0, int32_t z0, int32_t x1, int32_t z1, int include)
+    {
+        int count = (int)mObjects.size();
+        if (mDirty)
+        {
+            mGrid.clear();
+            for (int n = 0; n < count; n++) insert(n);
+            mDirty = false;
+        }
+
+        int always[2] = {mCurrent, include};
+        int nb = mGrid.query(x0, z0, x1, z1, mList.data(), always, 2);
+        mQueries++;
+        mCandidates += nb;
+        return nb;
+    }
+
+    void hitObj(int hitter, int n)
+    {
+        mObjects[n].hitBy = hitter;
+        mHits++;
+    }
+
+    // the first loop of CheckObjCol(), without the bricks and the push of PUSHABLE objects
+    void checkObjCol(int numobj)
+    {
+        Object &o = mObjects[numobj];
+        int32_t y0 = mNyw + o.yMin, y1 = mNyw + o.yMax;
+        int32_t qx = mNxw, qz = mNzw;
+        int n = 0, c;
+
+        o.objCol = 255;
+
+        int nb = candidates(mNxw + o.xMin, mNzw + o.zMin, mNxw + o.xMax, mNzw + o.zMax, -1);
+        for (c = 0;; c++)
+        {
+            if (mNxw != qx || mNzw != qz)
+            {
+                qx = mNxw;
+                qz = mNzw;
+                nb = candidates(mNxw + o.xMin, mNzw + o.zMin, mNxw + o.xMax, mNzw + o.zMax, -1);
+                for (c = 0; c < nb && mList[c] <= n; c++)
+                {
+                }
+            }
+            if (c >= nb) break;
+
+            n = mList[c];
+            Object &t = mObjects[n];
+
+        test_obj_zv:
+            bool flagy = false;
+            int32_t x0 = mNxw + o.xMin, x1 = mNxw + o.xMax;
+            int32_t z0 = mNzw + o.zMin, z1 = mNzw + o.zMax;
+
+            if (n == numobj || t.body == -1 || t.carryBy == numobj) continue;
+
+            int32_t xt0 = t.x + t.xMin, xt1 = t.x + t.xMax;
+            int32_t yt0 = t.y + t.yMin, yt1 = t.y + t.yMax;
+            int32_t zt0 = t.z + t.zMin, zt1 = t.z + t.zMax;
+
+            if (!(x0 < xt1 && x1 > xt0 && y0 < yt1 && y1 > yt0 && z0 < zt1 && z1 > zt0)) continue;
+
+            o.objCol = n;
+
+            if (t.flags & OBJ_CARRIER)
+            {
+                if (y0 <= yt1 + 1 && y0 > yt1 - SIZE_BRICK_Y)
+                {
+                    mNyw = yt1 - o.yMin + 1;
+                    o.carryBy = n;
+                    continue;
+                }
+            }
+            else if (y0 <= yt1 + 1 && y0 > yt1 - SIZE_BRICK_Y)
+            {
+                hitObj(numobj, n);
+                flagy = true;
+            }
+
+            if ((o.flags & OBJ_CARRIER) && flagy)
+            {
+                mNxw = mOldX;
+                mNyw = mOldY;
+                mNzw = mOldZ;
+            }
+            else
+            {
+                int32_t dx = std::min(std::abs(xt1 - x0), std::abs(x1 - xt0));
+                int32_t dz = std::min(std::abs(zt1 - z0), std::abs(z1 - zt0));
+                int coin;
+
+                if (dx < dz) coin = (x0 < xt0 || mNxw <= t.x) ? 0 : 1;
+                else coin = (z0 < zt0 || mNzw <= t.z) ? 2 : 3;
+
+                switch (coin)
+                {
+                    case 0: mNxw -= dx; break;
+                    case 1: mNxw += dx; break;
+                    case 2: mNzw -= dz; break;
+                    case 3: mNzw += dz; break;
+                }
+
+                if (flagy) goto test_obj_zv;  // pos acceptée, on reteste cet objet
+            }
+        }
+
+        // OK_HIT
+        if (numobj % 4 == 0)
+        {
+            int32_t x0 = mNxw + o.xMin + 200, x1 = mNxw + o.xMax + 200;
+            int32_t z0 = mNzw + o.zMin, z1 = mNzw + o.zMax;
+
+            nb = candidates(x0, z0, x1, z1, -1);
+            for (c = 0; c < nb; c++)
+            {
+                n = mList[c];
+                Object &t = mObjects[n];
+                if (n == numobj || t.body == -1 || (t.flags & INVISIBLE) || t.carryBy == numobj) continue;
+
+                if (x0 < t.x + t.xMax && x1 > t.x + t.xMin && y0 < t.y + t.yMax && y1 > t.y + t.yMin &&
+                    z0 < t.z + t.zMax && z1 > t.z + t.zMin)
+                {
+                    hitObj(numobj, n);
+                }
+            }
+        }
+    }
+
+    // ExtraCheckObjCol(): first object hit, the owner excluded
+    int extraCheck(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1, int owner)
+    {
+        int nb = candidates(x0, z0, x1, z1, owner);
+        for (int c = 0; c < nb; c++)
+        {
+            int n = mList[c];
+            const Object &t = mObjects[n];
+            if (t.body == -1 || n == owner) continue;
+
+            if (x0 < t.x + t.xMax && x1 > t.x + t.xMin && y0 < t.y + t.yMax && y1 > t.y + t.yMin &&
+                z0 < t.z + t.zMax && z1 > t.z + t.zMin)
+            {
+                hitObj(owner, n);
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    std::vector<Object> mObjects;
+    Ida::ObjectGrid mGrid;
+    std::vector<int> mList;
+    bool mDirty = true;
+    int mCurrent = -1;
+
+    int32_t mNxw = 0, mNyw = 0, mNzw = 0;
+    int32_t mOldX = 0, mOldY = 0, mOldZ = 0;
+
+    long long mHits = 0;
+    long long mChecks = 0;
+    long long mQueries = 0;
+    long long mCandidates = 0;
+    double mTime = 0;
+};
+
+// grid queries against a brute force scan of random boxes, negative and far coordinates included
+static int CheckGrid()
+{
+    std::mt19937 rnd(7);
+    Ida::ObjectGrid grid(300);
+    std::vector<int> boxes(300 * 4);
+    std::vector<int> out(300);
+    int errors = 0;
+
+    auto randomBox = [&](int *b) {
+        int range = rnd() % 3 == 0 ? 200000 : 40000;
+        int size = rnd() % 8 == 0 ? (int)(rnd() % 50000) : (int)(rnd() % 800);
+        b[0] = (int)(rnd() % range) - range / 2;
+        b[1] = (int)(rnd() % range) - range / 2;
+        b[2] = b[0] + size;
+        b[3] = b[1] + (int)(rnd() % 800);
+    };
+
+    for (int n = 0; n < 300; n++)
+    {
+        randomBox(&boxes[n * 4]);
+        grid.insert(n, boxes[n * 4], boxes[n * 4 + 1], boxes[n * 4 + 2], boxes[n * 4 + 3]);
+    }
+
+    for (int q = 0; q < 20000; q++)
+    {
+        // move some
+        int m = rnd() % 300;
+        randomBox(&boxes[m * 4]);
+        grid.insert(m, boxes[m * 4], boxes[m * 4 + 1], boxes[m * 4 + 2], boxes[m * 4 + 3]);
+
+        int b[4];
+        randomBox(b);
+        int nb = grid.query(b[0], b[1], b[2], b[3], out.data());
+
+        // every overlapping box is there, in order
+        int c = 0;
+        for (int n = 0; n < 300; n++)
+        {
+            const int *t = &boxes[n * 4];
+            bool overlap = b[0] <= t[2] && b[2] >= t[0] && b[1] <= t[3] && b[3] >= t[1];
+            while (c < nb && out[c] < n) c++;
+            if (overlap && (c == nb || out[c] != n)) errors++;
+        }
+        for (int k = 1; k < nb; k++)
+        {
+            if (out[k] <= out[k - 1]) errors++;
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    static const struct
+    {
+        int count;
+        uint32_t crc;
+    } scenes[] = {{10, 0xD1045CAD},  {25, 0xBCA76164},  {50, 0xE2712FA1},  {100, 0x4C4C6993},
+                  {200, 0x511524FE}, {400, 0xCED4DBC3}, {800, 0x851D7AFB}};
+
+    int errors = CheckGrid();
+    printf("grid queries: %s\n", errors ? "FAILED" : "ok");
+
+    static const int FRAMES = 300;
+    printf("%d frames of walking actors on %dx%d bricks\n\n", FRAMES, Scene::Area / 512, Scene::Area / 512);
+    printf("actors  check (us)  candidates\n");
+
+    for (const auto &s : scenes)
+    {
+        Scene scene(s.count, 1234);
+        std::mt19937 rnd(99);
+        uint32_t crc = 0;
+
+        for (int f = 0; f < FRAMES; f++)
+        {
+            scene.frame(rnd);
+            crc = scene.trace(crc);
+        }
+
+        printf("%6d  %10.3f  %10.1f\n", s.count, scene.checkUs(), scene.candidates());
+        char name[32];
+        snprintf(name, sizeof(name), "%d actors", s.count);
+        errors += TestExpect(name, crc, s.crc);
+    }
+
+    return errors ? 1 : 0;
+}
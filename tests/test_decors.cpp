@@ -0,0 +1,602 @@
+// Decors check and benchmark for DECORS.CPP and the collision loops of EXTFUNC.CPP, with the decors of an
+// exterior cube (200 at most, MAX_OBJ_DECORS).
+//
+// Display, AffichageObjetDecorsZBuf() on camera paths (frames one after the other):
+//  - qsort: the decors in index order, the list of the projected ones sorted by qsort each frame, then
+//    BodyDisplay() for each
+//  - cube: the decors in the order of the last frame (Ida::DecorsCube), the list put back in order by the
+//    insertion sort, BodyDisplay() skipped for the bodies found out of the screen
+// The lists must give the same Zrot sequence (qsort leaves the ties in any order, the cube sorts them by
+// index) and the same decors drawn (DEC_DRAWN). BodyDisplay() is the rotation and projection of the points
+// and the test of their 2D box against the clip window, with LongWorldRotatePoint and LongProjectPoint of
+// LIB386/transform3d.cpp (checked against the FPU routines by test_transform3d.cpp).
+//
+// Collisions: random points and boxes tested against all the decors (linear) or the ones of the grid
+// (ObjectGrid of the cube), as WorldColBrickExt(), WorldColBrickDecors() and ReajustPosDecors() do: the
+// decors found must be the same.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "DecorsCube.h"
+#include "test.h"
+#include "transform3d.h"
+
+using Ida::DecorsCube;
+
+static const int MAX_OBJ_DECORS = 200;
+
+struct BodyPoint
+{
+    int16_t X, Y, Z, Group;
+};
+
+struct Body
+{
+    std::vector<BodyPoint> points;
+};
+
+struct Decor
+{
+    int32_t body, beta;
+    bool invisible;
+    int32_t xworld, yworld, zworld;
+    int32_t xmin, ymin, zmin, xmax, ymax, zmax;
+};
+
+// T_LIST_TRI
+struct Tri
+{
+    int32_t Zrot;
+    int32_t Num;
+};
+
+struct Frame
+{
+    DecorsCube::View view;
+    float mat[12];          // view.mat in a TYPE_MAT, for transform3d
+    int32_t nearclip, zfar;
+};
+
+struct Path
+{
+    const char *name;
+    std::vector<Frame> frames;
+};
+
+struct Island
+{
+    const char *name;
+    std::vector<Body> bodies;
+    std::vector<Decor> decors;
+    std::vector<Path> paths;
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// LongWorldRotatePoint, LongProjectPoint and BodyDisplay
+
+// m: a TYPE_MAT (12 floats)
+static void Rotate(const float *m, int32_t x, int32_t y, int32_t z, int32_t out[3])
+{
+    transform3d_rotate(&out[0], &out[1], &out[2], &x, &y, &z, 1, m);
+}
+
+// X, Y and zr relative to the camera
+static bool Project(const Frame &f, int32_t X, int32_t Y, int32_t zr, int32_t &xp, int32_t &yp)
+{
+    const DecorsCube::View &v = f.view;
+    transform3d_camera cam = {v.ratiox, v.ratioy, v.xcentre, v.ycentre, 0, 0, 0, 0, -f.nearclip};
+    int32_t z = -zr;
+    unsigned char ok;
+    transform3d_project_long(&xp, &yp, &ok, &X, &Y, &z, 1, &cam);
+    return ok;
+}
+
+// beta: 4096 a turn, mat: a TYPE_MAT without translation
+static void BodyMatrix(const float *world, int32_t beta, float *mat)
+{
+    double a = (beta & 4095) * (2 * 3.14159265358979 / 4096);
+    float c = (float)cos(a), s = (float)sin(a);
+    float obj[9] = {c, 0, s, 0, 1, 0, -s, 0, c};
+    std::fill(mat, mat + 12, 0.f);
+    for (int r = 0; r < 3; r++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            mat[r * 3 + k] = world[r * 3] * obj[k] + world[r * 3 + 1] * obj[3 + k] + world[r * 3 + 2] * obj[6 + k];
+        }
+    }
+}
+
+// TRUE when the 2D box of the points touches the clip window
+static bool BodyDisplay(const Frame &f, const Body &body, const Decor &d, long long &points)
+{
+    const DecorsCube::View &v = f.view;
+    int32_t pos[3];
+    Rotate(f.mat, d.xworld, d.yworld, d.zworld, pos);
+    pos[0] -= v.camx;
+    pos[1] -= v.camy;
+    pos[2] -= v.camz;
+
+    float mat[12];
+    BodyMatrix(f.mat, d.beta, mat);
+
+    int32_t xmin = INT_MAX, ymin = INT_MAX, xmax = INT_MIN, ymax = INT_MIN;
+    for (const BodyPoint &p : body.points)
+    {
+        int32_t r[3], xp, yp;
+        Rotate(mat, p.X, p.Y, p.Z, r);
+        int32_t zr = -(pos[2] + (int16_t)r[2]);
+        if (!Project(f, pos[0] + (int16_t)r[0], pos[1] + (int16_t)r[1], zr, xp, yp)) continue;
+        if (xp < -32767 || xp > 32767 || yp < -32767 || yp > 32767) continue;
+        xmin = std::min(xmin, xp);
+        xmax = std::max(xmax, xp);
+        ymin = std::min(ymin, yp);
+        ymax = std::max(ymax, yp);
+    }
+    points += (long long)body.points.size();
+
+    return !(xmin > v.clipxmax || ymin > v.clipymax || xmax < v.clipxmin || ymax < v.clipymin);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// AffichageObjetDecorsZBuf
+
+struct Trace
+{
+    std::vector<int32_t> zrot;      // of the sorted list
+    std::vector<Tri> list;
+    std::vector<uint8_t> drawn;
+    long long points = 0;
+};
+
+// the projection of the hot points, in the given order
+static int List(const Island &island, const Frame &f, const uint8_t *order, Tri *list)
+{
+    const DecorsCube::View &v = f.view;
+    int nb = 0;
+    for (int n = 0; n < (int)island.decors.size(); n++)
+    {
+        int i = order ? order[n] : n;
+        const Decor &d = island.decors[i];
+        if (d.invisible) continue;
+
+        int32_t r[3];
+        bool far = false;
+        for (int c = 0; c < 4 && !far; c++)
+        {
+            Rotate(f.mat, c & 2 ? d.xmax : d.xmin, d.ymin, c & 1 ? d.zmax : d.zmin, r);
+            far = v.camz - r[2] > f.zfar;
+        }
+        if (far) continue;
+
+        int32_t xp, yp;
+        Rotate(f.mat, d.xworld, d.yworld, d.zworld, r);
+        if (!Project(f, r[0] - v.camx, r[1] - v.camy, v.camz - r[2], xp, yp)) continue;
+
+        list[nb].Zrot = v.camz - r[2];
+        list[nb].Num = i;
+        nb++;
+    }
+    return nb;
+}
+
+static int SubQsortDecorsZbuf(const void *a, const void *b)
+{
+    return ((const Tri *)b)->Zrot - ((const Tri *)a)->Zrot;
+}
+
+static void Qsort(const Island &island, const Frame &f, Trace &t)
+{
+    int nb = List(island, f, nullptr, t.list.data());
+    qsort(t.list.data(), nb, sizeof(Tri), SubQsortDecorsZbuf);
+
+    t.zrot.clear();
+    std::fill(t.drawn.begin(), t.drawn.end(), 0);
+    for (int n = 0; n < nb; n++)
+    {
+        const Decor &d = island.decors[t.list[n].Num];
+        t.zrot.push_back(t.list[n].Zrot);
+        t.drawn[t.list[n].Num] = BodyDisplay(f, island.bodies[d.body], d, t.points);
+    }
+}
+
+static void Cube(const Island &island, DecorsCube &cube, const Frame &f, Trace &t, std::vector<Tri> *sorted)
+{
+    int nb = List(island, f, cube.order(), t.list.data());
+    cube.sort(t.list.data(), nb);
+    if (sorted) sorted->assign(t.list.begin(), t.list.begin() + nb);
+
+    t.zrot.clear();
+    std::fill(t.drawn.begin(), t.drawn.end(), 0);
+    for (int n = 0; n < nb; n++)
+    {
+        int i = t.list[n].Num;
+        const Decor &d = island.decors[i];
+        const Body &body = island.bodies[d.body];
+        t.zrot.push_back(t.list[n].Zrot);
+
+        if (!cube.hasBounds(i))
+        {
+            cube.setBounds(i, body.points.data(), (int)body.points.size());
+        }
+        if (cube.offScreen(f.view, i, d.xworld, d.yworld, d.zworld)) continue;
+
+        t.drawn[i] = BodyDisplay(f, body, d, t.points);
+    }
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Collisions
+
+struct Query
+{
+    int32_t x0, y0, z0, x1, y1, z1;
+};
+
+static bool TestPoint(const Decor &d, int32_t x, int32_t y, int32_t z)
+{
+    return !d.invisible && d.xmin <= x && d.xmax >= x && d.ymin <= y && d.ymax >= y && d.zmin <= z &&
+           d.zmax >= z;
+}
+
+static bool TestBox(const Decor &d, const Query &q)
+{
+    return !d.invisible && d.xmin <= q.x1 && d.xmax >= q.x0 && d.zmin <= q.z1 && d.zmax >= q.z0 &&
+           d.ymin <= q.y1 && d.ymax >= q.y0 - 1;
+}
+
+static bool TestFullY(const Decor &d, const Query &q, int32_t y0)
+{
+    if (d.invisible || d.xmin > q.x1 || d.xmax < q.x0 || d.zmin > q.z1 || d.zmax < q.z0) return false;
+    if (d.ymin > q.y1 || d.ymax > q.y1) return false;
+    return d.ymax >= y0;
+}
+
+// WorldColBrickExt, WorldColBrickDecors (NumDecorsCol -1), ReajustPosDecors: the decors found
+template <typename F>
+static int64_t Collide(const Island &island, const Query &q, F candidates)
+{
+    uint8_t list[MAX_OBJ_DECORS];
+    int64_t found = 0;
+
+    int nb = candidates(q.x0, q.z0, q.x0, q.z0, list);
+    for (int n = 0; n < nb; n++)
+    {
+        if (TestPoint(island.decors[list[n]], q.x0, q.y0, q.z0))
+        {
+            found = list[n] + 1;
+            break;
+        }
+    }
+
+    nb = candidates(q.x0, q.z0, q.x1, q.z1, list);
+    for (int n = 0; n < nb; n++)
+    {
+        if (TestBox(island.decors[list[n]], q))
+        {
+            found = found * 256 + list[n] + 1;
+            break;
+        }
+    }
+
+    int32_t y0 = q.y0, num = -1;
+    for (int n = 0; n < nb; n++)
+    {
+        if (TestFullY(island.decors[list[n]], q, y0))
+        {
+            y0 = island.decors[list[n]].ymax;
+            num = list[n];
+        }
+    }
+    return (found * 256 + num + 1) * 65536 + y0;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Islands and camera paths
+
+static void MakeCamera(Frame &f, double px, double py, double pz, double yaw, double pitch)
+{
+    // rows: right, up, back (zr = CameraZr - Z0 grows in front of the camera)
+    double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+    double fwd[3] = {sy * cp, sp, cy * cp};
+    double right[3] = {cy, 0, -sy};
+    double up[3] = {fwd[1] * right[2] - fwd[2] * right[1], fwd[2] * right[0] - fwd[0] * right[2],
+                    fwd[0] * right[1] - fwd[1] * right[0]};
+    if (up[1] < 0)
+    {
+        for (double &u : up) u = -u;
+    }
+
+    DecorsCube::View &v = f.view;
+    for (int c = 0; c < 3; c++)
+    {
+        v.mat[c] = (float)right[c];
+        v.mat[3 + c] = (float)up[c];
+        v.mat[6 + c] = (float)-fwd[c];
+    }
+    std::fill(f.mat, f.mat + 12, 0.f);
+    std::copy(v.mat, v.mat + 9, f.mat);
+    auto rot = [&](int row) {
+        return (int32_t)lrint(px * v.mat[row * 3] + py * v.mat[row * 3 + 1] + pz * v.mat[row * 3 + 2]);
+    };
+    v.camx = rot(0);
+    v.camy = rot(1);
+    v.camz = rot(2);
+
+    v.ratiox = 600.f;
+    v.ratioy = -1.f;
+    v.xcentre = 320;
+    v.ycentre = 240;
+    v.clipxmin = 0;
+    v.clipymin = 0;
+    v.clipxmax = 639;
+    v.clipymax = 479;
+    f.nearclip = 1;
+    f.zfar = 48000;
+}
+
+static Body MakeBody(std::mt19937 &rnd)
+{
+    Body body;
+    int nb = 20 + (int)(rnd() % 180);
+    int radius = 200 + (int)(rnd() % 1500);
+    int height = 300 + (int)(rnd() % 4000);
+    for (int n = 0; n < nb; n++)
+    {
+        double a = (rnd() % 6283) / 1000.0, r = radius * ((rnd() % 1000) / 1000.0);
+        BodyPoint p;
+        p.X = (int16_t)(cos(a) * r);
+        p.Y = (int16_t)(rnd() % height) - (int16_t)(height / 10);
+        p.Z = (int16_t)(sin(a) * r);
+        p.Group = 0;
+        body.points.push_back(p);
+    }
+    return body;
+}
+
+static Decor MakeDecor(const Island &island, int body, int32_t x, int32_t z, std::mt19937 &rnd)
+{
+    Decor d;
+    d.body = body;
+    d.beta = (int32_t)(rnd() % 4096);
+    d.invisible = rnd() % 10 == 0;
+    d.xworld = x;
+    d.yworld = (int32_t)(rnd() % 2500);
+    d.zworld = z;
+
+    // ZV: the box of the turned points, as the island tools did
+    float mat[12];
+    const float id[12] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    BodyMatrix(id, d.beta, mat);
+    d.xmin = d.ymin = d.zmin = INT_MAX;
+    d.xmax = d.ymax = d.zmax = INT_MIN;
+    for (const BodyPoint &p : island.bodies[body].points)
+    {
+        int32_t r[3];
+        Rotate(mat, p.X, p.Y, p.Z, r);
+        d.xmin = std::min(d.xmin, x + r[0]);
+        d.xmax = std::max(d.xmax, x + r[0]);
+        d.ymin = std::min(d.ymin, d.yworld + r[1]);
+        d.ymax = std::max(d.ymax, d.yworld + r[1]);
+        d.zmin = std::min(d.zmin, z + r[2]);
+        d.zmax = std::max(d.zmax, z + r[2]);
+    }
+    return d;
+}
+
+static Island MakeIsland(const char *name, int kind, std::mt19937 &rnd)
+{
+    Island island = {name, {}, {}, {}};
+    for (int n = 0; n < 12; n++) island.bodies.push_back(MakeBody(rnd));
+
+    const double centre = 64 * 512 / 2.0;
+    const double pi = 3.14159265358979;
+    int nb = kind == 0 ? 60 : MAX_OBJ_DECORS;
+    for (int n = 0; n < nb; n++)
+    {
+        int32_t x, z;
+        switch (kind)
+        {
+        case 0: // sparse, anywhere
+        case 1: // dense, anywhere
+            x = (int32_t)(rnd() % 32768);
+            z = (int32_t)(rnd() % 32768);
+            break;
+        default: // village: houses in rings and a forest
+        {
+            double a = (rnd() % 6283) / 1000.0, r = n < 80 ? 3000 + 1500 * (n % 4) : 6000 + (rnd() % 9000);
+            x = (int32_t)(centre + cos(a) * r);
+            z = (int32_t)(centre + sin(a) * r);
+            break;
+        }
+        }
+        island.decors.push_back(MakeDecor(island, (int)(rnd() % island.bodies.size()), x, z, rnd));
+    }
+
+    // paths: 240 frames each, one after the other
+    Path orbit = {"orbit", {}}, walk = {"walk", {}}, fly = {"fly", {}}, jump = {"jump", {}};
+    for (int n = 0; n < 240; n++)
+    {
+        double t = n / 240.0, a = t * 2 * pi;
+        Frame f;
+
+        // orbit, looking at the centre
+        MakeCamera(f, centre - sin(a) * 24000, 9000, centre - cos(a) * 24000, a, -0.3);
+        orbit.frames.push_back(f);
+
+        // ground level among the decors, looking around
+        MakeCamera(f, centre + 5000 * cos(a), 1200, centre + 5000 * sin(a), a * 3, 0.05);
+        walk.frames.push_back(f);
+
+        // fly over, turning
+        MakeCamera(f, -4000 + t * 40000, 4000, centre + 6000 * sin(a), pi / 2 + 0.6 * sin(a * 2), -0.25);
+        fly.frames.push_back(f);
+
+        // anywhere, any direction, any clip window: no frame coherence
+        MakeCamera(f, (int)(rnd() % 60000) - 14000.0, (int)(rnd() % 20000) - 2000.0,
+                   (int)(rnd() % 60000) - 14000.0, (rnd() % 6283) / 1000.0, (rnd() % 3141) / 1000.0 - 1.57);
+        if (rnd() % 2)
+        {
+            f.view.clipxmin = (int)(rnd() % 300);
+            f.view.clipymin = (int)(rnd() % 200);
+            f.view.clipxmax = f.view.clipxmin + (int)(rnd() % 340);
+            f.view.clipymax = f.view.clipymin + (int)(rnd() % 280);
+        }
+        f.nearclip = (int32_t)(rnd() % 2000) + 1;
+        jump.frames.push_back(f);
+    }
+    island.paths = {orbit, walk, fly, jump};
+    return island;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+
+struct Result
+{
+    long long errors = 0, frames = 0, listed = 0, drawn = 0, pointsQsort = 0, pointsCube = 0;
+    double sortQsortUs = 0, sortCubeUs = 0, qsortUs = 0, cubeUs = 0;
+};
+
+static bool SameDisplay(const Trace &a, const Trace &b, const std::vector<Tri> &sorted)
+{
+    if (a.zrot != b.zrot || a.drawn != b.drawn) return false;
+
+    // cube: far to near, then lowest index
+    for (size_t n = 1; n < sorted.size(); n++)
+    {
+        const Tri &p = sorted[n - 1], &c = sorted[n];
+        if (p.Zrot < c.Zrot || (p.Zrot == c.Zrot && p.Num > c.Num)) return false;
+    }
+    return true;
+}
+
+static Result Display(const Island &island, const Path &path)
+{
+    Result r;
+    Trace tq, tc, tt;
+    for (Trace *t : {&tq, &tc, &tt})
+    {
+        t->list.resize(MAX_OBJ_DECORS);
+        t->drawn.resize(island.decors.size());
+    }
+
+    DecorsCube cube(MAX_OBJ_DECORS), timed(MAX_OBJ_DECORS);
+    cube.reset(MAX_OBJ_DECORS, (int)island.decors.size());
+    timed.reset(MAX_OBJ_DECORS, (int)island.decors.size());
+
+    std::vector<Tri> sorted;
+    for (const Frame &f : path.frames)
+    {
+        Qsort(island, f, tq);
+        Cube(island, cube, f, tc, &sorted);
+        r.errors += !SameDisplay(tq, tc, sorted);
+        r.frames++;
+        r.listed += (long long)tq.zrot.size();
+        r.drawn += std::count(tq.drawn.begin(), tq.drawn.end(), 1);
+        r.pointsQsort += tq.points;
+        r.pointsCube += tc.points;
+        tq.points = tc.points = 0;
+
+        // the sort only, then the whole display
+        std::vector<Tri> list(MAX_OBJ_DECORS);
+        int nb = List(island, f, nullptr, list.data());
+        r.sortQsortUs += 1e6 * TestTime([&]() { qsort(list.data(), nb, sizeof(Tri), SubQsortDecorsZbuf); }, 1);
+        nb = List(island, f, timed.order(), list.data());
+        r.sortCubeUs += 1e6 * TestTime([&]() { timed.sort(list.data(), nb); }, 1);
+        r.qsortUs += 1e6 * TestTime([&]() { Qsort(island, f, tt); }, 1);
+        r.cubeUs += 1e6 * TestTime([&]() { Cube(island, timed, f, tt, nullptr); }, 1);
+    }
+    return r;
+}
+
+static void Collisions(const Island &island, std::mt19937 &rnd, long long &errors, double &linearUs, double &gridUs)
+{
+    DecorsCube cube(MAX_OBJ_DECORS);
+    cube.reset(MAX_OBJ_DECORS, (int)island.decors.size());
+    for (int n = 0; n < (int)island.decors.size(); n++)
+    {
+        const Decor &d = island.decors[n];
+        cube.grid().insert(n, d.xmin, d.zmin, d.xmax, d.zmax);
+    }
+
+    std::vector<Query> queries;
+    for (int n = 0; n < 20000; n++)
+    {
+        Query q;
+        q.x0 = (int32_t)(rnd() % 34000) - 600;
+        q.y0 = (int32_t)(rnd() % 5000) - 500;
+        q.z0 = (int32_t)(rnd() % 34000) - 600;
+        q.x1 = q.x0 + (int32_t)(rnd() % 1200);
+        q.y1 = q.y0 + (int32_t)(rnd() % 3000);
+        q.z1 = q.z0 + (int32_t)(rnd() % 1200);
+        queries.push_back(q);
+    }
+
+    int nb = (int)island.decors.size();
+    auto linear = [nb](int32_t, int32_t, int32_t, int32_t, uint8_t *list) {
+        for (int n = 0; n < nb; n++) list[n] = (uint8_t)n;
+        return nb;
+    };
+    auto grid = [&cube](int32_t x0, int32_t z0, int32_t x1, int32_t z1, uint8_t *list) {
+        return cube.grid().query(x0, z0, x1, z1, list);
+    };
+
+    std::vector<int64_t> a(queries.size()), b(queries.size());
+    linearUs = 1e6 * TestTime([&]() {
+        for (size_t n = 0; n < queries.size(); n++) a[n] = Collide(island, queries[n], linear);
+    }, 3);
+    gridUs = 1e6 * TestTime([&]() {
+        for (size_t n = 0; n < queries.size(); n++) b[n] = Collide(island, queries[n], grid);
+    }, 3);
+    errors = a != b;
+}
+
+int main()
+{
+    std::mt19937 rnd(1234);
+    std::vector<Island> islands;
+
+    islands.push_back(MakeIsland("sparse", 0, rnd));
+    islands.push_back(MakeIsland("dense", 1, rnd));
+    islands.push_back(MakeIsland("village", 2, rnd));
+
+    long long errors = 0;
+
+    printf("display, per frame\n");
+    printf("island   path    listed  drawn  points projected      sort (us)      display (us)     result\n");
+    printf("                                 qsort    cube      qsort   cube     qsort   cube\n");
+    for (const Island &island : islands)
+    {
+        for (const Path &path : island.paths)
+        {
+            Result r = Display(island, path);
+            double nb = (double)r.frames;
+            printf("%-8s %-6s  %6.1f %6.1f  %7.0f %7.0f   %7.2f %6.2f  %8.1f %6.1f     %s\n", island.name, path.name,
+                   r.listed / nb, r.drawn / nb, r.pointsQsort / nb, r.pointsCube / nb, r.sortQsortUs / nb,
+                   r.sortCubeUs / nb, r.qsortUs / nb, r.cubeUs / nb, r.errors ? "MISMATCH" : "identical");
+            errors += r.errors;
+        }
+    }
+
+    printf("\ncollisions, 20000 points and boxes\n");
+    printf("island   decors   linear (us)  grid (us)  speedup  result\n");
+    for (const Island &island : islands)
+    {
+        long long e;
+        double linearUs, gridUs;
+        Collisions(island, rnd, e, linearUs, gridUs);
+        printf("%-8s %6d   %11.0f %10.0f  %7.1f  %s\n", island.name, (int)island.decors.size(), linearUs, gridUs,
+               linearUs / gridUs, e ? "MISMATCH" : "identical");
+        errors += e;
+    }
+
+    return errors ? 1 : 0;
+}
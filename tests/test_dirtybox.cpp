@@ -0,0 +1,285 @@
+// Dirty box check and benchmark: the boxes and tile bitmaps of dirtytiles.cpp
+// (LIB386/DIRTYBOX.CPP), for frames of:
+//
+//   BoxMovingAdd for each sprite, BoxStaticAdd for a few boxes, then
+//   BoxBlit (moving + previous moving + static boxes to Phys) and BoxClean
+//   (moving boxes from Screen to Log), on a 640x480 screen.
+//
+// Every frame, the blits must cover all the pixels of the boxes of the
+// frame and of the boxes cleaned at the previous one, and the cleans all
+// the pixels of the moving boxes.
+//
+// The area is the pixels copied by the blits and cleans of a frame, exact
+// the pixels of its boxes; the times are the bookkeeping alone (adds,
+// merges, rectangles) and with the copies of that area.
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "dirtytiles.h"
+#include "test.h"
+
+static const int WIDTH = 640;
+static const int HEIGHT = 480;
+static const int BOX_MASK = ~7;
+static const int BOX_ALIGN = 7;
+
+struct Box
+{
+    int x0, y0, x1, y1;     // x1, y1 excluded
+};
+
+typedef void RectFunc(void *user, int x0, int y0, int x1, int y1);
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// the calls of DIRTYBOX.CPP
+
+class BoxTiles
+{
+public:
+    BoxTiles()
+    {
+        mStatic.rowmin = mOpt.rowmin = mMoving.rowmin = DIRTYTILES_ROWS;
+        mStatic.rowmax = mOpt.rowmax = mMoving.rowmax = -1;
+    }
+
+    void movingAdd(int x0, int y0, int x1, int y1)
+    {
+        dirtytiles_add(&mMoving, x0 & BOX_MASK, y0, (x1 + BOX_ALIGN) & BOX_MASK, y1);
+    }
+
+    void staticAdd(int x0, int y0, int x1, int y1)
+    {
+        dirtytiles_add(&mStatic, x0 & BOX_MASK, y0, (x1 + BOX_ALIGN) & BOX_MASK, y1);
+    }
+
+    void blit(RectFunc *func, void *user)
+    {
+        dirtytiles_merge(&mOpt, &mMoving);
+        dirtytiles_merge(&mOpt, &mStatic);
+        dirtytiles_clear(&mStatic);
+        dirtytiles_rects(&mOpt, WIDTH, HEIGHT, func, user);
+        dirtytiles_clear(&mOpt);
+    }
+
+    void clean(RectFunc *func, void *user)
+    {
+        if (!dirtytiles_empty(&mOpt)) return;
+        dirtytiles_rects(&mMoving, WIDTH, HEIGHT, func, user);
+        dirtytiles_merge(&mOpt, &mMoving);
+        dirtytiles_clear(&mMoving);
+    }
+
+private:
+    dirtytiles mStatic = {}, mOpt = {}, mMoving = {};
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// frames
+
+struct Frame
+{
+    std::vector<Box> moving, statics;   // inclusive coordinates, as given to BoxMovingAdd
+};
+
+struct Case
+{
+    const char *name;
+    int sprites;        // moving boxes of each frame
+    int minSize, maxSize;
+    int statics;        // static boxes of each frame
+    bool rain;          // new random boxes each frame, else sprites walking around
+};
+
+static std::vector<Frame> MakeFrames(std::mt19937 &rnd, const Case &c, int count)
+{
+    std::uniform_int_distribution<int> size(c.minSize, c.maxSize);
+    std::uniform_int_distribution<int> px(-16, WIDTH), py(-16, HEIGHT), step(-6, 6);
+
+    std::vector<Box> sprites(c.sprites);
+    for (Box &s : sprites)
+    {
+        s.x0 = px(rnd), s.y0 = py(rnd);
+        s.x1 = size(rnd), s.y1 = size(rnd);   // sizes
+    }
+
+    std::vector<Frame> frames(count);
+    for (Frame &f : frames)
+    {
+        for (Box &s : sprites)
+        {
+            if (c.rain)
+            {
+                s.x0 = px(rnd), s.y0 = py(rnd);
+            }
+            else
+            {
+                s.x0 += step(rnd), s.y0 += step(rnd);
+            }
+            f.moving.push_back({s.x0, s.y0, s.x0 + s.x1 - 1, s.y0 + s.y1 - 1});
+        }
+        for (int n = 0; n < c.statics; n++)
+        {
+            int x = px(rnd), y = py(rnd);
+            f.statics.push_back({x, y, x + 40, y + 10});
+        }
+    }
+    return frames;
+}
+
+// CheckClip() of DIRTYBOX.CPP: false when nothing is left
+static bool CheckClip(Box &b)
+{
+    b.x1++, b.y1++;
+    if (b.x0 < 0) b.x0 = 0;
+    if (b.y0 < 0) b.y0 = 0;
+    if (b.x1 > WIDTH) b.x1 = WIDTH;
+    if (b.y1 > HEIGHT) b.y1 = HEIGHT;
+    return b.x1 > b.x0 && b.y1 > b.y0;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// one frame of adds, blit and clean
+
+struct Copy
+{
+    const unsigned char *src;
+    unsigned char *dst;
+    long area;
+    std::vector<unsigned char> *covered;    // marks the pixels copied
+};
+
+static void CopyRect(void *user, int x0, int y0, int x1, int y1)
+{
+    Copy *c = (Copy *)user;
+    if (x1 > WIDTH) x1 = WIDTH;
+    if (y1 > HEIGHT) y1 = HEIGHT;
+    if (x1 <= x0 || y1 <= y0) return;
+
+    c->area += (long)(x1 - x0) * (y1 - y0);
+    for (int y = y0; y < y1; y++)
+    {
+        if (c->dst) memcpy(c->dst + y * WIDTH + x0, c->src + y * WIDTH + x0, x1 - x0);
+        if (c->covered) memset(c->covered->data() + y * WIDTH + x0, 1, x1 - x0);
+    }
+}
+
+static void RunFrame(BoxTiles &boxes, const Frame &f, Copy &blit, Copy &clean)
+{
+    for (Box b : f.moving)
+    {
+        if (CheckClip(b)) boxes.movingAdd(b.x0, b.y0, b.x1, b.y1);
+    }
+    for (Box b : f.statics)
+    {
+        if (CheckClip(b)) boxes.staticAdd(b.x0, b.y0, b.x1, b.y1);
+    }
+    boxes.blit(CopyRect, &blit);
+    boxes.clean(CopyRect, &clean);
+}
+
+static void Mark(std::vector<unsigned char> &mask, const std::vector<Box> &list)
+{
+    for (Box b : list)
+    {
+        if (!CheckClip(b)) continue;
+        for (int y = b.y0; y < b.y1; y++) memset(mask.data() + y * WIDTH + b.x0, 1, b.x1 - b.x0);
+    }
+}
+
+// pixels of need not in covered
+static long Missing(const std::vector<unsigned char> &need, const std::vector<unsigned char> &covered)
+{
+    long missing = 0;
+    for (size_t n = 0; n < need.size(); n++) missing += need[n] && !covered[n];
+    return missing;
+}
+
+static long Check(const std::vector<Frame> &frames, long &exact)
+{
+    BoxTiles boxes;
+    std::vector<unsigned char> need(WIDTH * HEIGHT), blitted(WIDTH * HEIGHT), cleaned(WIDTH * HEIGHT);
+    long missing = 0;
+    exact = 0;
+
+    for (size_t n = 0; n < frames.size(); n++)
+    {
+        Copy blit = {nullptr, nullptr, 0, &blitted}, clean = {nullptr, nullptr, 0, &cleaned};
+        memset(blitted.data(), 0, blitted.size());
+        memset(cleaned.data(), 0, cleaned.size());
+
+        RunFrame(boxes, frames[n], blit, clean);
+
+        // blits: this frame, the sprites cleaned at the previous one, the statics
+        memset(need.data(), 0, need.size());
+        Mark(need, frames[n].moving);
+        Mark(need, frames[n].statics);
+        if (n) Mark(need, frames[n - 1].moving);
+        missing += Missing(need, blitted);
+        for (unsigned char p : need) exact += p;
+
+        // cleans: this frame
+        memset(need.data(), 0, need.size());
+        Mark(need, frames[n].moving);
+        missing += Missing(need, cleaned);
+        for (unsigned char p : need) exact += p;
+    }
+    return missing;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+
+int main()
+{
+    const Case cases[] = {
+        {"few sprites", 12, 24, 64, 1, false},
+        {"crowd", 150, 8, 40, 4, false},
+        {"rain", 600, 2, 12, 0, true},
+        {"storm", 2000, 2, 8, 8, true},
+    };
+
+    std::mt19937 rnd(49);
+    std::vector<unsigned char> log(WIDTH * HEIGHT, 1), phys(WIDTH * HEIGHT), screen(WIDTH * HEIGHT, 2);
+    int errors = 0;
+    const int FRAMES = 64;
+
+    printf("%-12s %9s %9s %9s %10s %10s\n", "case", "missing", "area", "exact", "boxes us", "total us");
+
+    for (const Case &c : cases)
+    {
+        std::vector<Frame> frames = MakeFrames(rnd, c, FRAMES);
+
+        long exact;
+        long missing = Check(frames, exact);
+        if (missing) errors++;
+
+        // bookkeeping alone (no copies), then with the copies
+        long area = 0;
+        auto run = [&](bool copy)
+        {
+            BoxTiles boxes;
+            for (const Frame &f : frames)
+            {
+                Copy blit = {log.data(), copy ? phys.data() : nullptr, 0, nullptr};
+                Copy clean = {screen.data(), copy ? log.data() : nullptr, 0, nullptr};
+                RunFrame(boxes, f, blit, clean);
+                area += blit.area + clean.area;
+            }
+        };
+
+        int repeat = 20;
+        double timeBoxes = TestTime([&] { run(false); }, repeat);
+        double timeAll = TestTime([&] { run(true); }, repeat);
+        area /= 2 * repeat;
+
+        double per = 1e6 / FRAMES;
+        printf("%-12s %9ld %9ld %9ld %10.2f %10.2f\n", c.name, missing, area / FRAMES, exact / FRAMES, timeBoxes * per,
+               timeAll * per);
+    }
+
+    printf("\n%s\n", errors ? "MISMATCH: pixels not blitted or cleaned" : "all dirty pixels covered");
+    return errors ? 1 : 0;
+}
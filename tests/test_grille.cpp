@@ -0,0 +1,340 @@
+// Grille layer check and benchmark for AffGrille() of GRILLE.CPP: the full redraw of an interior cube, the
+// bricks of the 64 x 25 x 64 blocks drawn in Log (AffGraph) and the screen columns of bricks for
+// DrawOverBrick and co. (NbBrickColon, ListBrickColon).
+//
+// Two passes run the same redraws, each on a cleared screen as AffScene does:
+//  - draw: the whole grid, as before
+//  - cache: Ida::GrilleCache, the layer of a camera position seen before is copied back
+// Both must leave the same Log and the same columns. The redraws follow what the game does: the camera going
+// back and forth between a few positions, the same position again and again (menus, inventory, dialogs),
+// GRMs incrusted or not (the grid changes), the clip window of the cinema mode, a new cube now and then.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "GrilleCache.h"
+#include "test.h"
+
+using Ida::GrilleCache;
+using Ida::GrilleKey;
+using Ida::GrillePart;
+
+static const int SCREEN_X = 640;
+static const int SCREEN_Y = 480;
+static const int SIZE_CUBE_X = 64;
+static const int SIZE_CUBE_Y = 25;
+static const int SIZE_CUBE_Z = 64;
+static const int BRICK_X = 48;
+static const int BRICK_Y = 38;
+static const int NB_COLON = 28;
+static const int MAX_BRICK = 150;
+
+struct Colonb
+{
+    int16_t Xm, Ym, Zm, Ys, Brick, Col;
+};
+
+struct Brick
+{
+    uint8_t pixels[BRICK_Y][BRICK_X];  // 0: transparent
+};
+
+// what GRILLE.CPP works on
+struct World
+{
+    std::vector<Brick> bricks;
+    std::vector<uint16_t> cube;  // brick + 1 of each block, 0 empty (BufCube and its BLL)
+    std::vector<uint8_t> col;    // collision code of each block
+    int32_t startx = 0, starty = 0, startz = 0;
+    int32_t clip[4] = {0, 0, SCREEN_X - 1, SCREEN_Y - 1};
+};
+
+struct Screen
+{
+    std::vector<uint8_t> log = std::vector<uint8_t>(SCREEN_X * SCREEN_Y);
+    int16_t nbBrickColon[NB_COLON];
+    Colonb listBrickColon[NB_COLON][MAX_BRICK];
+
+    void cls()
+    {
+        std::fill(log.begin(), log.end(), 0);
+    }
+};
+
+static uint32_t TabOffLine[SCREEN_Y];
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// AffGrille
+
+// AffGraph: the opaque pixels in the clip window
+static void AffGraph(const World &w, const Brick &b, int32_t xs, int32_t ys, uint8_t *log)
+{
+    int y0 = std::max(ys, w.clip[1]), y1 = std::min(ys + BRICK_Y - 1, w.clip[3]);
+    int x0 = std::max(xs, w.clip[0]), x1 = std::min(xs + BRICK_X - 1, w.clip[2]);
+    for (int y = y0; y <= y1; y++)
+    {
+        const uint8_t *src = b.pixels[y - ys];
+        uint8_t *dst = log + TabOffLine[y];
+        for (int x = x0; x <= x1; x++)
+        {
+            if (src[x - xs]) dst[x] = src[x - xs];
+        }
+    }
+}
+
+static void Map2Screen(int32_t xm, int32_t ym, int32_t zm, int32_t &xs, int32_t &ys)
+{
+    xs = (xm - zm) * 24 + 320 - 8 - 23 - 1;
+    ys = (xm + zm) * 12 - ym * 15 + 240 - 14;
+}
+
+static void Draw(const World &w, Screen &s)
+{
+    memset(s.nbBrickColon, 0, sizeof(s.nbBrickColon));
+    const uint16_t *ptc = w.cube.data();
+    for (int z = 0; z < SIZE_CUBE_Z; z++)
+    {
+        for (int x = 0; x < SIZE_CUBE_X; x++)
+        {
+            for (int y = 0; y < SIZE_CUBE_Y; y++, ptc++)
+            {
+                if (!*ptc) continue;
+
+                // AffBrickBlock
+                int32_t xs, ys;
+                Map2Screen(x - w.startx, y - w.starty, z - w.startz, xs, ys);
+                if (xs < -24 || xs >= SCREEN_X || ys < -38 || ys >= SCREEN_Y) continue;
+
+                AffGraph(w, w.bricks[*ptc - 1], xs, ys, s.log.data());
+
+                int col = (xs + 24) / 24;
+                int nb = s.nbBrickColon[col];
+                if (nb < MAX_BRICK)
+                {
+                    s.listBrickColon[col][nb] = {(int16_t)x, (int16_t)y, (int16_t)z, (int16_t)ys,
+                                                 (int16_t)(*ptc - 1), (int16_t)w.col[ptc - w.cube.data()]};
+                    s.nbBrickColon[col]++;
+                }
+            }
+        }
+    }
+}
+
+static void Cached(const World &w, GrilleCache &cache, Screen &s)
+{
+    GrillePart parts[2] = {{s.nbBrickColon, sizeof(s.nbBrickColon)},
+                           {s.listBrickColon, sizeof(s.listBrickColon)}};
+    GrilleKey key = {cache.generation(), w.startx, w.starty, w.startz,
+                     w.clip[0], w.clip[1], w.clip[2], w.clip[3]};
+
+    if (const Ida::GrilleLayer *layer = cache.find(key))
+    {
+        layer->restore(s.log.data(), TabOffLine, parts, 2);
+        return;
+    }
+    Draw(w, s);
+    cache.insert(key, s.log.data(), TabOffLine, parts, 2);
+}
+
+static bool Same(const Screen &a, const Screen &b)
+{
+    if (a.log != b.log || memcmp(a.nbBrickColon, b.nbBrickColon, sizeof(a.nbBrickColon))) return false;
+    for (int c = 0; c < NB_COLON; c++)
+    {
+        if (memcmp(a.listBrickColon[c], b.listBrickColon[c], a.nbBrickColon[c] * sizeof(Colonb))) return false;
+    }
+    return true;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Cubes and redraws
+
+static void MakeBricks(World &w, std::mt19937 &rnd)
+{
+    w.bricks.resize(120);
+    for (Brick &b : w.bricks)
+    {
+        uint8_t base = (uint8_t)(1 + rnd() % 200);
+        bool hollow = rnd() % 4 == 0;
+        for (int y = 0; y < BRICK_Y; y++)
+        {
+            for (int x = 0; x < BRICK_X; x++)
+            {
+                // the hexagon of an isometric brick, some with holes (fences, grids)
+                int dx = abs(2 * x - (BRICK_X - 1)), top = dx / 4, bottom = BRICK_Y - 1 - dx / 4;
+                bool in = y >= top && y <= bottom;
+                if (hollow && (x / 4 + y / 4) % 3 == 0) in = false;
+                b.pixels[y][x] = in ? (uint8_t)(base + (rnd() % 16)) : 0;
+            }
+        }
+    }
+}
+
+static void MakeCube(World &w, std::mt19937 &rnd)
+{
+    w.cube.assign(SIZE_CUBE_X * SIZE_CUBE_Y * SIZE_CUBE_Z, 0);
+    w.col.assign(w.cube.size(), 0);
+    int rooms = 4 + (int)(rnd() % 6);
+    for (int r = 0; r < rooms; r++)
+    {
+        int x0 = (int)(rnd() % 48), z0 = (int)(rnd() % 48), dx = 6 + (int)(rnd() % 16), dz = 6 + (int)(rnd() % 16);
+        int h = 3 + (int)(rnd() % 8), floor = (int)(rnd() % 4);
+        for (int z = z0; z < std::min(z0 + dz, SIZE_CUBE_Z); z++)
+        {
+            for (int x = x0; x < std::min(x0 + dx, SIZE_CUBE_X); x++)
+            {
+                for (int y = 0; y <= floor + h && y < SIZE_CUBE_Y; y++)
+                {
+                    bool wall = x == x0 || z == z0;
+                    if (y > floor && !wall && rnd() % 40) continue;
+                    size_t n = ((size_t)z * SIZE_CUBE_X + x) * SIZE_CUBE_Y + y;
+                    w.cube[n] = (uint16_t)(1 + rnd() % w.bricks.size());
+                    w.col[n] = (uint8_t)(rnd() % 4);
+                }
+            }
+        }
+    }
+}
+
+// GRM: a box of blocks changed
+static void Incrust(World &w, std::mt19937 &rnd)
+{
+    int x0 = (int)(rnd() % 56), y0 = (int)(rnd() % 12), z0 = (int)(rnd() % 56);
+    for (int z = z0; z < z0 + 6; z++)
+    {
+        for (int x = x0; x < x0 + 6; x++)
+        {
+            for (int y = y0; y < y0 + 4; y++)
+            {
+                w.cube[((size_t)z * SIZE_CUBE_X + x) * SIZE_CUBE_Y + y] =
+                    rnd() % 2 ? (uint16_t)(1 + rnd() % w.bricks.size()) : 0;
+            }
+        }
+    }
+}
+
+enum
+{
+    REDRAW,     // same camera, grid unchanged
+    MOVE,       // camera to one of the positions of the cube
+    GRM,        // grid changed
+    CINEMA,     // clip window in or out
+    CUBE        // new cube
+};
+
+static std::vector<int> MakeScript(int kind, std::mt19937 &rnd)
+{
+    std::vector<int> script;
+    for (int n = 0; n < 400; n++)
+    {
+        int r = (int)(rnd() % 100);
+        switch (kind)
+        {
+        case 0: // menus and dialogs: the same place
+            script.push_back(r < 85 ? REDRAW : r < 95 ? MOVE : r < 98 ? CINEMA : GRM);
+            break;
+        case 1: // walking between rooms
+            script.push_back(r < 40 ? REDRAW : r < 92 ? MOVE : r < 96 ? CINEMA : GRM);
+            break;
+        default: // anything
+            script.push_back(r < 25 ? REDRAW : r < 70 ? MOVE : r < 80 ? CINEMA : r < 95 ? GRM : CUBE);
+            break;
+        }
+    }
+    return script;
+}
+
+struct Result
+{
+    long long errors = 0, redraws = 0;
+    double drawUs = 0, cacheUs = 0;
+    uint32_t hits = 0, misses = 0;
+};
+
+static Result Run(int kind, std::mt19937 &rnd)
+{
+    Result r;
+    World w;
+    MakeBricks(w, rnd);
+    MakeCube(w, rnd);
+
+    GrilleCache cache(4);
+    Screen a, b;
+    int32_t positions[5][3];
+    auto place = [&]() {
+        for (auto &p : positions)
+        {
+            p[0] = (int32_t)(rnd() % 40);
+            p[1] = (int32_t)(rnd() % 6);
+            p[2] = (int32_t)(rnd() % 40);
+        }
+    };
+    place();
+
+    for (int step : MakeScript(kind, rnd))
+    {
+        switch (step)
+        {
+        case MOVE:
+        {
+            const int32_t *p = positions[rnd() % (kind == 1 ? 3 : 5)];
+            w.startx = p[0];
+            w.starty = p[1];
+            w.startz = p[2];
+            break;
+        }
+        case GRM:
+            Incrust(w, rnd);
+            cache.invalidate();  // IncrustGrm, DesIncrustGrm
+            break;
+        case CINEMA:
+            w.clip[1] = w.clip[1] ? 0 : 60;
+            w.clip[3] = w.clip[3] != SCREEN_Y - 1 ? SCREEN_Y - 1 : SCREEN_Y - 61;
+            break;
+        case CUBE:
+            MakeCube(w, rnd);
+            place();
+            cache.invalidate();  // InitGrille
+            break;
+        }
+
+        r.drawUs += 1e6 * TestTime([&]() {
+            a.cls();
+            Draw(w, a);
+        }, 1);
+        r.cacheUs += 1e6 * TestTime([&]() {
+            b.cls();
+            Cached(w, cache, b);
+        }, 1);
+        r.errors += !Same(a, b);
+        r.redraws++;
+    }
+    r.hits = cache.hits();
+    r.misses = cache.misses();
+    return r;
+}
+
+int main()
+{
+    for (int y = 0; y < SCREEN_Y; y++) TabOffLine[y] = y * SCREEN_X;
+
+    std::mt19937 rnd(1234);
+    const char *names[3] = {"menus", "rooms", "mixed"};
+    long long errors = 0;
+
+    printf("script   redraws  hits  misses    draw (us)  cache (us)  speedup  result\n");
+    for (int kind = 0; kind < 3; kind++)
+    {
+        Result r = Run(kind, rnd);
+        double nb = (double)r.redraws;
+        printf("%-8s %7lld  %4u  %6u  %11.1f %11.1f  %7.1f  %s\n", names[kind], r.redraws, r.hits, r.misses,
+               r.drawUs / nb, r.cacheUs / nb, r.drawUs / r.cacheUs, r.errors ? "MISMATCH" : "identical");
+        errors += r.errors;
+    }
+
+    return errors ? 1 : 0;
+}
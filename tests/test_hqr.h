@@ -0,0 +1,49 @@
+// The blocks of an HQR file (LIB386/SYSTEM/HQR.CPP), for the checks that
+// decode the game files. Needs LIB386/SYSTEM/LZC.CPP.
+
+#ifndef __TEST_HQR_H__
+#define __TEST_HQR_H__
+
+#include <cstring>
+
+#include "test.h"
+
+void ExpandLZ_C(void *Dst, void *Src, unsigned int DecompSize, unsigned int MinBloc);
+
+// calls f(index, block) for each block: offsets table, then per block
+// {U32 size, U32 compressed size, S16 method} and the data, expanded.
+// False if the file is too short for an HQR.
+template <typename F>
+static bool TestHqrBlocks(const std::vector<unsigned char> &file, F f)
+{
+    if (file.size() < 4) return false;
+
+    uint32_t nbBloc = TestGet32(&file[0]) / 4;
+    for (uint32_t n = 0; n < nbBloc && (n + 1) * 4 <= file.size(); n++)
+    {
+        uint32_t offset = TestGet32(&file[n * 4]);
+        if (!offset || offset + 10 > file.size()) continue;
+
+        uint32_t size = TestGet32(&file[offset]);
+        uint32_t compSize = TestGet32(&file[offset + 4]);
+        int method = TestGet16(&file[offset + 8]);
+        const unsigned char *src = &file[offset + 10];
+
+        if (offset + 10 + compSize > file.size() || method > 2) continue;
+
+        std::vector<unsigned char> block(size);
+        if (method == 0)
+        {
+            memcpy(block.data(), src, size);
+        }
+        else
+        {
+            ExpandLZ_C(block.data(), (void *)src, size, method + 1);
+        }
+
+        f(n, block);
+    }
+    return true;
+}
+
+#endif // __TEST_HQR_H__
@@ -0,0 +1,529 @@
+// Flow dots and rain drops check and benchmark for FLOW.CPP and RAIN.CPP on Ida::FlowDots and Ida::RainDrops
+// (Ida/src/common/Particles.h).
+//
+// Each frame (20 ticks of TimerRefHR) runs, as the game does:
+//  - flows: AnimParticleFlow() then AffParticleFlow() on every flow, a dead flow thrown again from a new origin
+//    by CreateParticleFlow() (same Rnd() calls)
+//  - rain: GereRain() then AffRain(), LineRain() drawing on a made up Z buffer to get impacts
+// the displayed points projected at once by LIB386/transform3d.cpp (LongWorldRotateProjectList_C). The checksum
+// of the points drawn, in order, and of the particles at the end was recorded with the old loops over S_ONE_DOT
+// and T_RAIN, each point through LongWorldRotatePoint / LongProjectPoint; two runs with the same seed must give
+// it too.
+//
+// The counts go from the game ones (MAX_FLOWS flows of MAX_FLOW_DOTS dots, MAX_RAIN drops) to 10 times them. The
+// times are the best of 5 runs without the hashing of what is drawn; "/ 1x" is the frame time against the one
+// with the game counts.
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Particles.h"
+#include "test.h"
+#include "transform3d.h"
+
+using Ida::FlowDots;
+using Ida::RainDrops;
+
+static const int MAX_FLOWS = 10;
+static const int MAX_FLOW_DOTS = 100;
+static const int MAX_RAIN = 200;
+
+static const int FRAMES = 600;
+static const int32_t FRAME_TICKS = 20;
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Rnd() of LIB386, MyRnd()
+
+struct Random
+{
+    uint32_t seed;
+
+    int32_t operator()(int32_t n)
+    {
+        if (n == 0) return 0;
+        seed = seed * 1103515245u + 12345u;
+        return (int32_t)((seed >> 16) & 0x7FFF) % n;
+    }
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The camera
+
+struct Camera
+{
+    float mat[12];           // MatriceWorld
+    transform3d_camera cam;  // FRatioX, CameraXr... CameraZrClip
+};
+
+static Camera MakeCamera(double px, double py, double pz, double yaw, double pitch)
+{
+    // rows: right, up, back (zr = CameraZr - Z0 grows in front of the camera)
+    double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+    double fwd[3] = {sy * cp, sp, cy * cp};
+    double right[3] = {cy, 0, -sy};
+    double up[3] = {fwd[1] * right[2] - fwd[2] * right[1], fwd[2] * right[0] - fwd[0] * right[2],
+                    fwd[0] * right[1] - fwd[1] * right[0]};
+    if (up[1] < 0)
+    {
+        for (double &u : up) u = -u;
+    }
+
+    Camera c = {};
+    for (int k = 0; k < 3; k++)
+    {
+        c.mat[k] = (float)right[k];
+        c.mat[3 + k] = (float)up[k];
+        c.mat[6 + k] = (float)-fwd[k];
+    }
+    auto rot = [&](int row) {
+        return (int)lrint(px * c.mat[row * 3] + py * c.mat[row * 3 + 1] + pz * c.mat[row * 3 + 2]);
+    };
+    c.cam.ratiox = 600.f;
+    c.cam.ratioy = -1.f;
+    c.cam.xcentre = 320;
+    c.cam.ycentre = 240;
+    c.cam.x = rot(0);
+    c.cam.y = rot(1);
+    c.cam.z = rot(2);
+    c.cam.nearclip = 0;
+    c.cam.zclip = c.cam.z - 1;
+    return c;
+}
+
+// LongWorldRotateProjectList_C, fast path
+static void RotateProjectList(const Camera &c, int n, const int32_t *x, const int32_t *y, const int32_t *z,
+                              int32_t *rx, int32_t *ry, int32_t *rz, int32_t *xp, int32_t *yp, uint8_t *ok)
+{
+    transform3d_rotate(rx, ry, rz, x, y, z, n, c.mat);
+    transform3d_project_long(xp, yp, ok, rx, ry, rz, n, &c.cam);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// What is drawn: BoxFlow(), LineRain() and BoxMovingAdd(), hashed in order
+
+struct Screen
+{
+    uint64_t hash = 1469598103934665603ull;
+    long long calls = 0;
+    bool hashing = true;  // off for the times: only the particles then
+
+    void add(int32_t v)
+    {
+        if (hashing) hash = (hash ^ (uint32_t)v) * 1099511628211ull;
+    }
+
+    void boxFlow(int32_t x, int32_t y, int32_t c)
+    {
+        add(x);
+        add(y);
+        add(c);
+        calls++;
+    }
+
+    void boxMovingAdd(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+    {
+        add(x0);
+        add(y0);
+        add(x1);
+        add(y1);
+    }
+
+    // bit 0: on the screen, bit 1: the drop hits what is drawn there (a made up Z buffer)
+    int32_t lineRain(int32_t x0, int32_t y0, int32_t z0, int32_t x1, int32_t y1, int32_t z1, int32_t c)
+    {
+        add(x0);
+        add(y0);
+        add(z0);
+        add(x1);
+        add(y1);
+        add(z1);
+        add(c);
+        calls++;
+
+        bool in0 = x0 >= 0 && x0 < 640 && y0 >= 0 && y0 < 480;
+        bool in1 = x1 >= 0 && x1 < 640 && y1 >= 0 && y1 < 480;
+        int32_t f = in0 || in1 ? 1 : 0;
+        if (in1 && z1 > 30000 + ((x1 * 7 + y1 * 13) & 1023) * 30) f |= 2;
+        return f;
+    }
+};
+
+static int32_t RegleTrois(int32_t val1, int32_t val2, int32_t nbsteps, int32_t step)
+{
+    if (nbsteps <= 0) return val2;
+    return val1 + (int32_t)((int64_t)(val2 - val1) * step / nbsteps);
+}
+
+static int32_t BoundRegleTrois(int32_t val1, int32_t val2, int32_t nbsteps, int32_t step)
+{
+    if (step <= 0) return val1;
+    if (step >= nbsteps) return val2;
+    return RegleTrois(val1, val2, nbsteps, step);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Flows
+
+// S_ONE_DOT
+struct Dot
+{
+    int32_t X, Y, Z, Vx, Vy, Vz, Delay, Poids, Couleur, Mode;
+};
+
+struct Flow
+{
+    int32_t org[3];
+    int32_t zv[6];  // XMin.. ZMax from the origin
+    int32_t start;  // FlowTimerStart
+};
+
+// CreateParticleFlow(): the origin, then per dot the Rnd() calls of the game, in its order
+template <typename F>
+static void CreateFlow(Random &rnd, Flow &flow, int32_t now, F dot)
+{
+    flow.org[0] = 10000 + rnd(12000);
+    flow.org[1] = 500 + rnd(2000);
+    flow.org[2] = 10000 + rnd(12000);
+    flow.start = now;
+    int32_t size = 2000 + rnd(3000);
+    flow.zv[0] = flow.zv[2] = -size;
+    flow.zv[1] = -1500;
+    flow.zv[3] = flow.zv[5] = size;
+    flow.zv[4] = size;
+
+    int32_t speed = 40 + rnd(80), weight = 1 + rnd(6), alpha = 600 + rnd(400), beta = rnd(4096);
+    for (int n = 0; n < MAX_FLOW_DOTS; n++)
+    {
+        int32_t vitesse = rnd(speed / 2) + speed;
+        int32_t poids = rnd(weight) + weight;
+        double a = (alpha + rnd(300) - 150) * (2 * 3.14159265358979 / 4096);
+        double b = (beta + rnd(1024) - 512) * (2 * 3.14159265358979 / 4096);
+        int32_t vy = (int32_t)lrint(vitesse * sin(a));
+        int32_t h = (int32_t)lrint(vitesse * cos(a));
+        int32_t vx = (int32_t)lrint(h * sin(b)), vz = (int32_t)lrint(h * cos(b));
+        int32_t delay = rnd(400);
+        dot(n, vx, vy, vz, delay, poids, 16 * 3 + rnd(8));
+    }
+}
+
+static void Absolute(const Flow &flow, int32_t zv[6])
+{
+    for (int k = 0; k < 6; k++) zv[k] = flow.org[k % 3] + flow.zv[k];
+}
+
+// FLOW.CPP with Ida::FlowDots
+struct Flows
+{
+    std::vector<Flow> flows;
+    FlowDots dots;
+    int32_t x[MAX_FLOW_DOTS], y[MAX_FLOW_DOTS], z[MAX_FLOW_DOTS], coul[MAX_FLOW_DOTS];
+    int32_t xr[MAX_FLOW_DOTS], yr[MAX_FLOW_DOTS], zr[MAX_FLOW_DOTS], xp[MAX_FLOW_DOTS], yp[MAX_FLOW_DOTS];
+    uint8_t ok[MAX_FLOW_DOTS];
+
+    explicit Flows(int count) : flows(count), dots(count, MAX_FLOW_DOTS) {}
+
+    void create(Random &rnd, int f, int32_t now)
+    {
+        int dot = dots.first(f);
+        CreateFlow(rnd, flows[f], now,
+                   [&](int n, int32_t vx, int32_t vy, int32_t vz, int32_t delay, int32_t poids, int32_t couleur) {
+                       dots.place(dot + n, flows[f].org[0], flows[f].org[1], flows[f].org[2]);
+                       dots.spawn(dot + n, vx, vy, vz, delay, poids, couleur);
+                   });
+    }
+
+    bool anim(int f, int32_t now)
+    {
+        int32_t zv[6];
+        Absolute(flows[f], zv);
+        return dots.animate(dots.first(f), MAX_FLOW_DOTS, now - flows[f].start, flows[f].org, zv);
+    }
+
+    void aff(int f, const Camera &c, Screen &screen)
+    {
+        int nb = dots.visible(dots.first(f), MAX_FLOW_DOTS, x, y, z, coul);
+        RotateProjectList(c, nb, x, y, z, xr, yr, zr, xp, yp, ok);
+        for (int n = 0; n < nb; n++)
+        {
+            if (ok[n]) screen.boxFlow(xp[n], yp[n], coul[n]);
+        }
+    }
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Rain
+
+static const int32_t RAIN_VX = 200;
+static const int32_t RAIN_VY = 2500;
+static const int32_t RAIN_WEIGHT = 30;
+static const int32_t RAIN_STOP = 0;
+static const int32_t RAIN_DELTA_X = 128;
+static const int32_t RAIN_DELTA_Y = 256;
+static const int32_t RAIN_DELTA_Z = 128;
+
+static const int32_t VueOffsetX = 16000, VueOffsetY = 6000, VueOffsetZ = 16000;
+static const int32_t ClipZFar = 40000, StartZFog = 20000;
+static const int32_t LFactorX = 600, LFactorY = 600;
+
+// InitOneRain()
+static void InitOneRain(Random &rnd, int32_t &x, int32_t &y, int32_t &z, int32_t &timer)
+{
+    int32_t rndy = rnd(VueOffsetY + 10000);
+    y = VueOffsetY + rndy;
+    rndy = rndy / 2 + 15000;
+    x = VueOffsetX - rndy + rnd(30000);
+    z = VueOffsetZ - rndy + rnd(30000);
+    timer = 0;
+}
+
+// the impact of a drop
+static bool Impact(Screen &screen, int32_t lastTimer, int32_t &xrain, int32_t yrain, int32_t zrain, int32_t timer)
+{
+    int32_t dt = lastTimer - timer;
+    int32_t c = xrain >> 16;
+    int32_t x = (int16_t)(xrain & 0xFFFF), y = yrain, z = zrain;
+    int32_t xp, yp = (RAIN_VY - RAIN_WEIGHT * dt) * dt / 256;
+    if (yp < 0)
+    {
+        yp = 0;
+        xp = RAIN_VX * RAIN_VY / RAIN_WEIGHT / 256;
+    }
+    else
+    {
+        xp = RAIN_VX * dt / 256;
+        yp = (yp * LFactorY) / z;
+    }
+    xp = (xp * LFactorX) / z;
+
+    int32_t x0 = x - xp, x1 = x + xp, y0 = y - yp, y1 = y;
+    z = RegleTrois(0, 65535, ClipZFar, z);
+    int32_t f = screen.lineRain(x, y, z, x0, y0, z, c);
+    f |= screen.lineRain(x, y, z, x1, y0, z, c);
+    if (f & 1) screen.boxMovingAdd(x0, y0, x1, y1);
+
+    return dt && !yp;  // RestartOneRain()
+}
+
+// RAIN.CPP with Ida::RainDrops
+struct Rain
+{
+    RainDrops drops;
+    std::vector<int32_t> x, y, z, xr, yr, zr, xp, yp;
+    std::vector<uint8_t> ok;
+    int32_t lastTimer = 0, deltaRain = 0;
+
+    Rain(int count, Random &rnd)
+        : drops(count), x(2 * count + 2), y(2 * count + 2), z(2 * count + 2), xr(2 * count + 2),
+          yr(2 * count + 2), zr(2 * count + 2), xp(2 * count + 2), yp(2 * count + 2), ok(2 * count + 2)
+    {
+        for (int i = 0; i < count; i++) init(rnd, i);
+    }
+
+    void init(Random &rnd, int i)
+    {
+        InitOneRain(rnd, drops.x()[i], drops.y()[i], drops.z()[i], drops.timer()[i]);
+    }
+
+    void gere(int32_t now)
+    {
+        deltaRain = lastTimer ? (now - lastTimer) * 10 : 0;
+        lastTimer = now;
+        drops.fall(deltaRain);
+    }
+
+    void aff(Random &rnd, const Camera &c, Screen &screen)
+    {
+        int32_t *xrain = drops.x(), *yrain = drops.y(), *zrain = drops.z(), *timer = drops.timer();
+        int count = drops.count();
+
+        int k = drops.gather(RAIN_STOP, -RAIN_DELTA_X, RAIN_DELTA_Y, -RAIN_DELTA_Z, x.data(), y.data(), z.data());
+        RotateProjectList(c, 2 * k, x.data(), y.data(), z.data(), xr.data(), yr.data(), zr.data(), xp.data(),
+                          yp.data(), ok.data());
+        k = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (timer[i])
+            {
+                if (Impact(screen, lastTimer, xrain[i], yrain[i], zrain[i], timer[i])) init(rnd, i);
+                continue;
+            }
+
+            int p;
+            if (yrain[i] <= RAIN_STOP)
+            {
+                init(rnd, i);
+                p = 2 * count;
+                x[p] = xrain[i] - RAIN_DELTA_X;
+                y[p] = yrain[i] + RAIN_DELTA_Y;
+                z[p] = zrain[i] - RAIN_DELTA_Z;
+                x[p + 1] = xrain[i];
+                y[p + 1] = yrain[i];
+                z[p + 1] = zrain[i];
+                RotateProjectList(c, 2, &x[p], &y[p], &z[p], &xr[p], &yr[p], &zr[p], &xp[p], &yp[p], &ok[p]);
+            }
+            else
+            {
+                p = 2 * k++;
+            }
+
+            if (!ok[p]) continue;
+            int32_t z0 = RegleTrois(0, 65535, ClipZFar, c.cam.z - zr[p]);
+            if (!ok[p + 1]) continue;
+            int32_t Z0 = c.cam.z - zr[p + 1];
+            int32_t z1 = RegleTrois(0, 65535, ClipZFar, Z0);
+            int32_t col = BoundRegleTrois(16 * 3 + 10, 16 * 3 + 3, ClipZFar - StartZFog, Z0);
+
+            int32_t f = screen.lineRain(xp[p], yp[p], z0, xp[p + 1], yp[p + 1], z1, col);
+            if (f & 1) screen.boxMovingAdd(0, 0, 640, 480);
+            if (f & 2)
+            {
+                if (f & 1)
+                {
+                    xrain[i] = (xp[p] & 0xFFFF) | (col << 16);
+                    yrain[i] = yp[p];
+                    zrain[i] = Z0;
+                    timer[i] = lastTimer;
+                }
+                else
+                {
+                    init(rnd, i);
+                }
+            }
+        }
+    }
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// A run: the flows and the rain on a camera turning around the scene
+
+struct Run
+{
+    std::vector<uint64_t> frames;  // screen hash after each frame
+    std::vector<int32_t> state;    // the particles at the end
+    long long drawn = 0;
+    double animUs = 0, affUs = 0;  // per frame: AnimParticleFlow() and GereRain(), the Aff ones
+};
+
+static Camera FrameCamera(int frame)
+{
+    double a = frame * (2 * 3.14159265358979 / FRAMES);
+    return MakeCamera(16000 - sin(a) * 22000, 5000, 16000 - cos(a) * 22000, a, -0.15);
+}
+
+static Run Simulate(Flows &flows, Rain &rain, Random &rnd, int nbFlows, bool timed)
+{
+    Run run;
+    Screen screen;
+    screen.hashing = !timed;
+    int32_t now = 1000;
+    std::vector<uint8_t> alive(nbFlows);
+
+    typedef std::chrono::steady_clock Clock;
+    auto us = [](Clock::time_point t0) { return std::chrono::duration<double, std::micro>(Clock::now() - t0).count(); };
+
+    for (int f = 0; f < nbFlows; f++) flows.create(rnd, f, now);
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        now += FRAME_TICKS;
+        Camera c = FrameCamera(frame);
+
+        auto t0 = Clock::now();
+        for (int f = 0; f < nbFlows; f++) alive[f] = flows.anim(f, now);
+        rain.gere(now);
+        run.animUs += us(t0);
+
+        // a dead flow is thrown again before the display, in the order of the flows
+        for (int f = 0; f < nbFlows; f++)
+        {
+            if (!alive[f]) flows.create(rnd, f, now);
+        }
+
+        t0 = Clock::now();
+        for (int f = 0; f < nbFlows; f++) flows.aff(f, c, screen);
+        rain.aff(rnd, c, screen);
+        run.affUs += us(t0);
+
+        run.frames.push_back(screen.hash);
+    }
+    run.animUs /= FRAMES;
+    run.affUs /= FRAMES;
+    run.drawn = screen.calls;
+    return run;
+}
+
+static Run RunParticles(int scale, uint32_t seed, bool timed)
+{
+    Random rnd = {seed};
+    Flows flows(MAX_FLOWS * scale);
+    Rain rain(MAX_RAIN * scale, rnd);
+
+    Run run = Simulate(flows, rain, rnd, MAX_FLOWS * scale, timed);
+    std::vector<Dot> dots(MAX_FLOWS * scale * MAX_FLOW_DOTS);
+    flows.dots.store(0, dots.data(), (int)dots.size());
+    for (const Dot &d : dots)
+    {
+        run.state.insert(run.state.end(), {d.X, d.Y, d.Z, d.Vx, d.Vy, d.Vz, d.Delay, d.Poids, d.Couleur, d.Mode});
+    }
+    for (int i = 0; i < rain.drops.count(); i++)
+    {
+        run.state.insert(run.state.end(),
+                         {rain.drops.x()[i], rain.drops.y()[i], rain.drops.z()[i], rain.drops.timer()[i]});
+    }
+    return run;
+}
+
+// best of 5
+static void Best(int scale, double &animUs, double &affUs)
+{
+    animUs = affUs = 1e30;
+    for (int r = 0; r < 5; r++)
+    {
+        Run t = RunParticles(scale, 1234, true);
+        animUs = std::min(animUs, t.animUs);
+        affUs = std::min(affUs, t.affUs);
+    }
+}
+
+int main()
+{
+    static const struct
+    {
+        int scale;
+        uint32_t crc;
+    } scales[] = {{1, 0xF1211147}, {2, 0x7960BA61}, {5, 0x02422E7E}, {10, 0xEA705714}};
+
+    int errors = 0;
+    const uint32_t seed = 1234;
+
+    printf("%d frames, flows of %d dots, per frame (us)\n", FRAMES, MAX_FLOW_DOTS);
+    printf("scale  flows  drops  drawn     anim  display    total   / 1x\n");
+
+    double budget = 0;
+    for (const auto &s : scales)
+    {
+        Run n = RunParticles(s.scale, seed, false), again = RunParticles(s.scale, seed, false);
+        bool repeat = again.frames == n.frames && again.state == n.state;  // same seed, same run
+
+        double anim, aff;
+        Best(s.scale, anim, aff);
+        if (s.scale == 1) budget = anim + aff;
+
+        printf("%4dx  %5d  %5d  %5.0f  %7.1f  %7.1f  %7.1f  %5.2f%s\n", s.scale, MAX_FLOWS * s.scale,
+               MAX_RAIN * s.scale, (double)n.drawn / FRAMES, anim, aff, anim + aff, (anim + aff) / budget,
+               repeat ? "" : "   NOT REPEATABLE");
+
+        char name[32];
+        snprintf(name, sizeof(name), "%dx", s.scale);
+        uint32_t crc = TestCrc(0, n.frames.data(), n.frames.size() * sizeof(uint64_t));
+        crc = TestCrc(crc, n.state.data(), n.state.size() * sizeof(int32_t));
+        errors += TestExpect(name, crc, s.crc) + !repeat;
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,330 @@
+// Portable polygon filler (LIB386/polyfill.cpp) against the ASM fillers of LIB386/pol_work, and its fill rate.
+//
+// Checked sets:
+//  - one set per bank of Switch_Fillers: every Type_Poly (0 to 25) on random polygons, small and large,
+//    clipped or not, on a random screen and zbuffer. The checksum of the screen, zbuffer, IsPolygonHidden
+//    and return values must be AsmCrc, the one of the ASM fillers (integer slopes, FORCE_INT) on the same
+//    set, for the scalar, SSE2 and AVX2 builds
+//  - ClipperZ: random polygons clipped by random planes, in both half-spaces. The checksum of the vertices
+//    must be the one of POLYCLIP.ASM (Clipping_Z)
+// The sets are built with integer arithmetic and their own random generator only, the same on any compiler,
+// so that the ASM checksums are those of the pol_work sources run on the very same polygons.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "polyfill.h"
+#include "test.h"
+
+static_assert(sizeof(polyfill_point) == 16, "polyfill_point must be Struc_Point");
+static_assert(sizeof(polyfill_clipvertex) == 20, "polyfill_clipvertex must be STRUC_CLIPVERTEX");
+
+static const int SCREEN_X = 640;
+static const int SCREEN_Y = 480;
+
+static const char *BankNames[8] = {"textures", "flat", "fog", "unused", "zbuf", "fog_zbuf", "nzw", "fog_nzw"};
+
+// Checksums of the sets drawn by the ASM fillers, by bank, then ClipperZ
+static const uint32_t AsmCrc[9] = {
+    0x8BCB08B0, 0xDFBC91F6, 0xD9E48F03, 0x7FB42582, 0xD93AC734, 0x0B22FDE2, 0x231922DF, 0x4753658D, 0xA15202D4,
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Random numbers and angles, integers only
+
+struct Rnd
+{
+    uint32_t seed;
+
+    explicit Rnd(uint32_t s) : seed(s) {}
+
+    uint32_t operator()()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+};
+
+// sin(k * pi / 128) * 32767, k = 0 to 64
+static const int16_t QuarterSin[65] = {
+    0,     804,   1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,  8739,  9512,
+    10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+    19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+    26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+    31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767,
+};
+
+// angle: 256 a turn
+static int Sin(int a)
+{
+    a &= 255;
+    int s = QuarterSin[(a & 127) <= 64 ? (a & 127) : 128 - (a & 127)];
+    return a < 128 ? s : -s;
+}
+
+static int Cos(int a)
+{
+    return Sin(a + 64);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Screen, zbuffer and tables
+
+struct Screen
+{
+    std::vector<unsigned char> pixels;
+    std::vector<unsigned short> zbuffer;
+    size_t offset;  // of the first pixel, 32 bytes aligned
+
+    Screen() : pixels((size_t)SCREEN_X * SCREEN_Y + 32), zbuffer((size_t)SCREEN_X * SCREEN_Y)
+    {
+        offset = (32 - ((uintptr_t)pixels.data() & 31)) & 31;
+    }
+
+    unsigned char *log() { return pixels.data() + offset; }
+};
+
+struct Tables
+{
+    std::vector<unsigned char> map, clutfog;
+    unsigned char palette[256];
+};
+
+static void MakeTables(Tables &t, Rnd &rnd)
+{
+    t.map.resize(65536);
+    for (unsigned char &b : t.map) b = rnd() % 4 ? (unsigned char)rnd() : 0;  // 0: chroma key
+
+    // the gouraud CLUT at the start of the fog block, like AMBIANCE.CPP: the
+    // colors index up to 64K past it
+    t.clutfog.resize(65536);
+    for (unsigned char &b : t.clutfog) b = (unsigned char)rnd();
+
+    for (int n = 0; n < 256; n++) t.palette[n] = (unsigned char)rnd();
+}
+
+static void SetContext(polyfill_context &ctx, Screen &s, const Tables &t, int bank)
+{
+    ctx.log = s.log();
+    ctx.pitch = SCREEN_X;
+    ctx.zbuffer = s.zbuffer.data();
+    ctx.map = t.map.data();
+    ctx.repmask = 0xFFFF;
+    ctx.clutgouraud = t.clutfog.data();
+    ctx.clutfog = t.clutfog.data();
+    memcpy(ctx.palette, t.palette, 256);
+    ctx.bank = bank;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Random polygons
+
+struct Poly
+{
+    int type, color, nb;
+    polyfill_point pts[16];
+};
+
+static void MakePoly(Poly &p, Rnd &rnd, int type, bool inside)
+{
+    p.type = type;
+    p.color = (int)(rnd() & 0xFF);
+
+    // convex: points around an ellipse, anticlockwise on the screen like the
+    // faces the game draws, now and then clockwise (nothing drawn)
+    p.nb = 3 + (int)(rnd() % 6);
+    int turn = inside || rnd() % 8 ? -256 : 256;
+    int size = inside ? 20 + (int)(rnd() % 200) : 1 << (rnd() % 10);
+    int cx = inside ? size + (int)(rnd() % (SCREEN_X - 2 * size)) : (int)(rnd() % 1000) - 180;
+    int cy = inside ? size + (int)(rnd() % (SCREEN_Y - 2 * size)) : (int)(rnd() % 800) - 160;
+    int rx = size, ry = 1 + (int)(rnd() % size);
+    int start = (int)(rnd() % 256);
+
+    for (int n = 0; n < p.nb; n++)
+    {
+        polyfill_point &pt = p.pts[n];
+        int a = start + n * turn / p.nb + (int)(rnd() % 4);
+        pt.x = (short)(cx + rx * Cos(a) / 32768);
+        pt.y = (short)(cy + ry * Sin(a) / 32768);
+        pt.u = (unsigned short)rnd();
+        pt.v = (unsigned short)rnd();
+        pt.light = rnd() % 8 ? (unsigned short)(rnd() % 0x1000) : (unsigned short)rnd();
+        pt.zo = (unsigned short)rnd();
+        pt.w = 0x100 + (rnd() >> (8 + rnd() % 12));
+    }
+
+    // now and then, a degenerate one
+    if (rnd() % 32 == 0) p.pts[1] = p.pts[0];
+    if (rnd() % 64 == 0) p.pts[2].y = p.pts[0].y;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Checked sets
+
+static const unsigned int RepMasks[] = {0xFFFF, 0x7F7F, 0x3FFF, 0xFEFF, 0x1F3F};
+
+static uint32_t RunBank(int bank)
+{
+    Rnd rnd(1998 + bank);
+
+    Screen s;
+    for (size_t n = 0; n < s.pixels.size(); n++)
+    {
+        unsigned char b = (unsigned char)rnd();  // as many draws whatever the alignment
+        if (n < (size_t)SCREEN_X * SCREEN_Y) s.log()[n] = b;
+    }
+    for (unsigned short &z : s.zbuffer) z = (unsigned short)rnd();
+
+    Tables t;
+    MakeTables(t, rnd);
+
+    polyfill_context ctx;
+    SetContext(ctx, s, t, bank);
+    ctx.hidden = 1;
+
+    uint32_t crc = 0;
+    for (int batch = 0; batch < 40; batch++)
+    {
+        // a clip window and fog per batch, like the game changing views
+        ctx.clipxmin = batch % 4 ? (int)(rnd() % 100) : 0;
+        ctx.clipymin = batch % 4 ? (int)(rnd() % 100) : 0;
+        ctx.clipxmax = SCREEN_X - 1 - (batch % 4 ? (int)(rnd() % 100) : 0);
+        ctx.clipymax = SCREEN_Y - 1 - (batch % 4 ? (int)(rnd() % 100) : 0);
+        ctx.repmask = RepMasks[batch % 5];
+        ctx.scaledfognear = (int)(rnd() % 0x4000);
+        ctx.fogfactor = (int)(rnd() % 0x8000);
+
+        for (int type = 0; type <= 25; type++)
+        {
+            for (int n = 0; n < 4; n++)
+            {
+                Poly p;
+                MakePoly(p, rnd, type, n & 1);
+                if (type == 25 && rnd() % 2) ctx.hidden = 1;
+
+                int ret = polyfill_fill(&ctx, p.type, p.color, p.nb, p.pts);
+                crc = TestCrc(crc, &ret, sizeof(ret));
+                crc = TestCrc(crc, &ctx.hidden, sizeof(ctx.hidden));
+            }
+        }
+    }
+
+    crc = TestCrc(crc, s.log(), (size_t)SCREEN_X * SCREEN_Y);
+    crc = TestCrc(crc, s.zbuffer.data(), s.zbuffer.size() * 2);
+    return crc;
+}
+
+// Quads and pentagons in camera space, across the near and far planes like the sky of DRAWSKY.CPP
+static uint32_t RunClipperZ()
+{
+    Rnd rnd(2024);
+    uint32_t crc = 0;
+
+    for (int n = 0; n < 20000; n++)
+    {
+        polyfill_clipvertex src[8], dst[16];
+        int nb = 3 + (int)(rnd() % 5);
+        int range = 1 << (8 + rnd() % 14);
+
+        for (int k = 0; k < nb; k++)
+        {
+            src[k].x = (int)(rnd() % (2 * range)) - range;
+            src[k].y = (int)(rnd() % (2 * range)) - range;
+            src[k].z = (int)(rnd() % (2 * range)) - range / 2;
+            src[k].u = (unsigned short)rnd();
+            src[k].v = (unsigned short)rnd();
+            src[k].light = (unsigned short)rnd();
+            src[k].dummy = (unsigned short)k;
+        }
+
+        int zclip = (int)(rnd() % range);
+        int flag = rnd() % 2 ? -1 : 0;
+
+        int k = polyfill_clipz(dst, src, nb, zclip, flag);
+        crc = TestCrc(crc, &k, sizeof(k));
+        crc = TestCrc(crc, dst, sizeof(polyfill_clipvertex) * k);
+    }
+
+    return crc;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Fill rate: Mpixels per second, polygons all in the screen
+
+static volatile int Sink;
+
+static double Area(const Poly &p)
+{
+    long long a = 0;
+    for (int n = 0; n < p.nb; n++)
+    {
+        const polyfill_point &q = p.pts[n], &r = p.pts[(n + 1) % p.nb];
+        a += (long long)q.x * r.y - (long long)r.x * q.y;
+    }
+    return (a < 0 ? -a : a) / 2.0;
+}
+
+static void Bench()
+{
+    Rnd rnd(1234);
+    Screen s;
+    Tables t;
+    MakeTables(t, rnd);
+
+    printf("type  %10s %10s %10s   (Mpixels/s)\n", BankNames[0], BankNames[4], BankNames[5]);
+    for (int type = 0; type <= 25; type++)
+    {
+        std::vector<Poly> polys(200);
+        double area = 0;
+        for (Poly &p : polys)
+        {
+            MakePoly(p, rnd, type, true);
+            area += Area(p);
+        }
+
+        printf("%4d ", type);
+        for (int bank : {0, 4, 5})
+        {
+            polyfill_context ctx;
+            SetContext(ctx, s, t, bank);
+            ctx.clipxmin = ctx.clipymin = 0;
+            ctx.clipxmax = SCREEN_X - 1;
+            ctx.clipymax = SCREEN_Y - 1;
+            ctx.scaledfognear = 0x100;
+            ctx.fogfactor = 0x1000;
+
+            double us = 1e6 * TestTime(
+                [&]() {
+                    std::fill(s.zbuffer.begin(), s.zbuffer.end(), 0xFFFF);
+                    ctx.hidden = 1;
+                    // copies: Fill_Poly may change the points
+                    for (Poly p : polys) Sink = polyfill_fill(&ctx, p.type, p.color, p.nb, p.pts);
+                },
+                10);
+            printf(" %10.1f", area / us);
+        }
+        printf("\n");
+    }
+}
+
+int main()
+{
+    int errors = 0;
+
+    printf("%-24s %-8s  %-8s  result\n", "set", "crc", "asm");
+    for (int set = 0; set < 9; set++)
+    {
+        uint32_t crc = set < 8 ? RunBank(set) : RunClipperZ();
+        errors += TestExpect(set < 8 ? BankNames[set] : "clipperz", crc, AsmCrc[set]);
+    }
+
+    printf("\n");
+    Bench();
+
+    return errors ? 1 : 0;
+}
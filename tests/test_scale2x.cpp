@@ -0,0 +1,95 @@
+// Video frame upscale check and benchmark for scale2x() (LIB386/scale2x.cpp),
+// which writes into Log directly, only the lines that changed.
+//
+// Frames are synthetic 320x200 images: all lines changing, a quarter of
+// the lines changing (a character talking on a still background), and
+// a still image. The checksum of Log after every frame must be the one of
+// the old ReadNextVideoFrame() of PLAYACF.CPP (clear of the 640x480
+// buffer, byte loop, line copy, then CopyBlock of the whole buffer into
+// Log) on the same frames.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "scale2x.h"
+#include "test.h"
+
+static const int WIDTH = 320;
+static const int HEIGHT = 200;
+static const int SCREEN_WIDTH = 640;
+static const int SCREEN_HEIGHT = 480;
+static const int VIDEO_START_Y = 40;
+
+// frames where one line in changeEvery changes from one frame to the next
+static std::vector<std::vector<unsigned char>> MakeFrames(std::mt19937 &rnd, int count, int changeEvery)
+{
+    std::vector<std::vector<unsigned char>> frames(count, std::vector<unsigned char>(WIDTH * HEIGHT));
+
+    for (unsigned char &c : frames[0]) c = (unsigned char)rnd();
+    for (int f = 1; f < count; f++)
+    {
+        frames[f] = frames[f - 1];
+        if (!changeEvery) continue;
+
+        for (int y = f % changeEvery; y < HEIGHT; y += changeEvery)
+        {
+            for (int x = 0; x < WIDTH; x++) frames[f][y * WIDTH + x] = (unsigned char)rnd();
+        }
+    }
+    return frames;
+}
+
+int main()
+{
+    std::mt19937 rnd(1234);
+    std::vector<unsigned char> log(SCREEN_WIDTH * SCREEN_HEIGHT, 0xAA);
+    std::vector<unsigned char> prev(WIDTH * HEIGHT);
+
+    struct Case
+    {
+        const char *name;
+        int changeEvery;
+        uint32_t crc;    // of the old ReadNextVideoFrame()
+    };
+    const Case cases[] = {{"all lines", 1, 0xAD01E52F}, {"1 line in 4", 4, 0xC1E8B915}, {"still", 0, 0xAA925FBF}};
+
+    int failed = 0;
+
+    for (const Case &c : cases)
+    {
+        std::vector<std::vector<unsigned char>> frames = MakeFrames(rnd, 64, c.changeEvery);
+
+        // the bands are cleared once, as PlayAcf does
+        memset(log.data(), 0, VIDEO_START_Y * SCREEN_WIDTH);
+        memset(log.data() + (VIDEO_START_Y + HEIGHT * 2) * SCREEN_WIDTH, 0,
+               (SCREEN_HEIGHT - VIDEO_START_Y - HEIGHT * 2) * SCREEN_WIDTH);
+
+        long lines = 0;
+        uint32_t crc = 0;
+        for (size_t f = 0; f < frames.size(); f++)
+        {
+            lines += scale2x(log.data() + VIDEO_START_Y * SCREEN_WIDTH, SCREEN_WIDTH, frames[f].data(),
+                             f ? prev.data() : NULL, WIDTH, HEIGHT);
+            if (!f) prev = frames[0];
+            crc = TestCrc(crc, log.data(), log.size());
+        }
+        failed += TestExpect(c.name, crc, c.crc);
+
+        double seconds = TestTime(
+            [&]()
+            {
+                for (const auto &frame : frames)
+                {
+                    scale2x(log.data() + VIDEO_START_Y * SCREEN_WIDTH, SCREEN_WIDTH, frame.data(), prev.data(), WIDTH,
+                            HEIGHT);
+                }
+            },
+            200);
+        printf("%-24s %5.1f%% lines written, %7.2f us/frame\n", "", 100.0 * lines / (frames.size() * HEIGHT),
+               seconds * 1e6 / frames.size());
+    }
+
+    return failed ? 1 : 0;
+}
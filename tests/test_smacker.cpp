@@ -0,0 +1,367 @@
+// Smacker decoding check and benchmark (LIB386/smacker): the lookup tables
+// of smk_hufftree.c decode the same frames (video, palette, audio tracks) as
+// the bit by bit tree walk they replace, whose checksum is recorded, and the
+// decoding alone is timed.
+//
+// Synthetic videos are checked: random trees (deep ones included, for the
+// subtables), random bitstreams, smacker 2 and 4 blocks, 8 and 16 bits audio,
+// truncated frames. Arguments are HQR files (VIDEO.HQR) or .smk files: every
+// video block is decoded too and its checksum printed.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "smacker.h"
+#include "test_hqr.h"
+
+// of the synthetic videos, recorded with the tree walk
+static const uint32_t SYNTHETIC_CRC = 0xA128769A;
+
+struct Video
+{
+    std::string name;
+    std::vector<unsigned char> data;
+};
+
+static bool IsSmk(const std::vector<unsigned char> &data)
+{
+    return data.size() > 4 && !memcmp(data.data(), "SMK", 3);
+}
+
+// a .smk file, or the videos of an HQR file
+static void LoadFile(const char *name, std::vector<Video> &videos)
+{
+    std::vector<unsigned char> file;
+    if (!TestReadFile(name, file) || file.size() < 4)
+    {
+        printf("can't read %s\n", name);
+        return;
+    }
+
+    if (IsSmk(file))
+    {
+        videos.push_back({name, file});
+        return;
+    }
+
+    TestHqrBlocks(file,
+                  [&](uint32_t n, const std::vector<unsigned char> &block)
+                  {
+                      if (!IsSmk(block)) return;
+
+                      char blockName[512];
+                      snprintf(blockName, sizeof(blockName), "%s[%u]", name, n);
+                      videos.push_back({blockName, block});
+                  });
+}
+
+//----------------------------------------------------------------------------
+// Synthetic videos
+
+class BitWriter
+{
+public:
+    void Bit(int bit)
+    {
+        if (!(mBits & 7)) mData.push_back(0);
+        if (bit) mData.back() |= 1 << (mBits & 7);
+        mBits++;
+    }
+
+    void Byte(int value)
+    {
+        for (int i = 0; i < 8; i++) Bit((value >> i) & 1);
+    }
+
+    void Code(const std::vector<int> &code)
+    {
+        for (int bit : code) Bit(bit);
+    }
+
+    void Random(std::mt19937 &rnd, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; i++) Byte(rnd() & 0xFF);
+    }
+
+    std::vector<unsigned char> &Data() { return mData; }
+
+private:
+    std::vector<unsigned char> mData;
+    size_t mBits = 0;
+};
+
+struct Leaf
+{
+    int value;
+    std::vector<int> code;
+};
+
+// random tree shape: bushy near the root, a long chain now and then
+static void GenShape(std::mt19937 &rnd, std::vector<int> &shape, int depth, int maxDepth, bool chain)
+{
+    bool branch;
+
+    if (chain)
+    {
+        branch = depth < maxDepth;
+    }
+    else
+    {
+        branch = depth < 2 || (depth < maxDepth && rnd() % 100 < 68);
+    }
+
+    shape.push_back(branch);
+    if (branch)
+    {
+        GenShape(rnd, shape, depth + 1, maxDepth, false);
+        GenShape(rnd, shape, depth + 1, maxDepth, chain);
+    }
+}
+
+// walks a shape (1 = branch, 0 = leaf, prefix order) and lists the leaves with their codes
+static void ShapeLeaves(const std::vector<int> &shape, size_t &pos, std::vector<int> &code, std::vector<Leaf> &leaves)
+{
+    if (shape[pos++])
+    {
+        code.push_back(0);
+        ShapeLeaves(shape, pos, code, leaves);
+        code.back() = 1;
+        ShapeLeaves(shape, pos, code, leaves);
+        code.pop_back();
+    }
+    else
+    {
+        leaves.push_back({0, code});
+    }
+}
+
+// huff8 tree: 1, the nodes, 0
+static std::vector<Leaf> WriteTree8(std::mt19937 &rnd, BitWriter &bw, int maxDepth)
+{
+    std::vector<int> shape, code;
+    std::vector<Leaf> leaves;
+    size_t pos = 0, n = 0;
+
+    GenShape(rnd, shape, 0, maxDepth, rnd() % 4 == 0);
+    ShapeLeaves(shape, pos, code, leaves);
+    for (Leaf &leaf : leaves) leaf.value = rnd() & 0xFF;
+
+    bw.Bit(1);
+    for (int node : shape)
+    {
+        bw.Bit(node);
+        if (!node) bw.Byte(leaves[n++].value);
+    }
+    bw.Bit(0);
+
+    return leaves;
+}
+
+// huff16 tree: 1, low8 tree, hi8 tree, 3 cache values, the nodes, 0
+static void WriteTree16(std::mt19937 &rnd, BitWriter &bw, int maxDepth)
+{
+    std::vector<int> shape, code;
+    std::vector<Leaf> leaves;
+    size_t pos = 0, n = 0;
+
+    bw.Bit(1);
+    std::vector<Leaf> low = WriteTree8(rnd, bw, 9);
+    std::vector<Leaf> hi = WriteTree8(rnd, bw, 9);
+
+    GenShape(rnd, shape, 0, maxDepth, rnd() % 3 == 0);
+    ShapeLeaves(shape, pos, code, leaves);
+
+    std::vector<std::pair<int, int>> parts;
+    for (Leaf &leaf : leaves)
+    {
+        int l = rnd() % low.size(), h = rnd() % hi.size();
+        leaf.value = low[l].value | (hi[h].value << 8);
+        parts.push_back({l, h});
+    }
+
+    // cache values taken from the leaves: they become escape codes
+    for (int i = 0; i < 3; i++)
+    {
+        int value = leaves[rnd() % leaves.size()].value;
+        bw.Byte(value & 0xFF);
+        bw.Byte(value >> 8);
+    }
+
+    for (int node : shape)
+    {
+        bw.Bit(node);
+        if (!node)
+        {
+            bw.Code(low[parts[n].first].code);
+            bw.Code(hi[parts[n].second].code);
+            n++;
+        }
+    }
+    bw.Bit(0);
+}
+
+// compressed audio chunk: size, unpacked size, 1, stereo, 16 bits, trees, first levels, data
+static std::vector<unsigned char> AudioChunk(std::mt19937 &rnd, bool stereo, bool bits16, uint32_t unpacked)
+{
+    BitWriter bw;
+
+    bw.Bit(1);
+    bw.Bit(stereo);
+    bw.Bit(bits16);
+
+    int nbTrees = (stereo ? 2 : 1) * (bits16 ? 2 : 1);
+    for (int i = 0; i < nbTrees; i++) WriteTree8(rnd, bw, 12);
+
+    bw.Random(rnd, unpacked * 2 + 16);
+
+    std::vector<unsigned char> chunk(8);
+    chunk.insert(chunk.end(), bw.Data().begin(), bw.Data().end());
+    while (chunk.size() & 3) chunk.push_back(0);
+
+    uint32_t size = (uint32_t)chunk.size();
+    for (int i = 0; i < 4; i++)
+    {
+        chunk[i] = (unsigned char)(size >> (i * 8));
+        chunk[4 + i] = (unsigned char)(unpacked >> (i * 8));
+    }
+    return chunk;
+}
+
+static void Put32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static Video MakeVideo(std::mt19937 &rnd, int number)
+{
+    const uint32_t w = 64 + 16 * (rnd() % 4), h = 48 + 16 * (rnd() % 3), frames = 24;
+    const uint32_t maxAudio = 8192;
+    const char version = number & 1 ? '4' : '2';
+
+    BitWriter trees;
+    for (int i = 0; i < 4; i++) WriteTree16(rnd, trees, 10 + rnd() % 16);
+    while (trees.Data().size() & 3) trees.Data().push_back(0);
+
+    std::vector<std::vector<unsigned char>> chunks;
+    std::vector<unsigned char> types;
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        std::vector<unsigned char> chunk = AudioChunk(rnd, true, true, 4 * (1 + rnd() % (maxAudio / 4 - 1)));
+        std::vector<unsigned char> mono = AudioChunk(rnd, false, false, 1 + rnd() % (maxAudio - 1));
+        chunk.insert(chunk.end(), mono.begin(), mono.end());
+
+        // video: enough bits for the whole frame, but now and then cut short
+        BitWriter video;
+        video.Random(rnd, f % 7 == 3 ? w * h / 16 : w * h * 4);
+        chunk.insert(chunk.end(), video.Data().begin(), video.Data().end());
+        while (chunk.size() & 3) chunk.push_back(0);
+
+        chunks.push_back(chunk);
+        types.push_back(0x02 | 0x04);
+    }
+
+    std::vector<unsigned char> out = {'S', 'M', 'K', (unsigned char)version};
+    Put32(out, w);
+    Put32(out, h);
+    Put32(out, frames);
+    Put32(out, 66);  // ms per frame
+    Put32(out, 0);   // flags
+    for (int i = 0; i < 7; i++) Put32(out, i < 2 ? maxAudio : 0);
+    Put32(out, (uint32_t)trees.Data().size());
+    for (int i = 0; i < 4; i++) Put32(out, 0);
+    Put32(out, 0xF0000000 | 22050);  // compressed, 16 bits stereo
+    Put32(out, 0xC0000000 | 11025);  // compressed, 8 bits mono
+    for (int i = 2; i < 7; i++) Put32(out, 0);
+    Put32(out, 0);
+    for (const auto &chunk : chunks) Put32(out, (uint32_t)chunk.size());
+    out.insert(out.end(), types.begin(), types.end());
+    out.insert(out.end(), trees.Data().begin(), trees.Data().end());
+    for (const auto &chunk : chunks) out.insert(out.end(), chunk.begin(), chunk.end());
+
+    return {"synthetic[" + std::to_string(number) + "]", out};
+}
+
+//----------------------------------------------------------------------------
+
+// decodes every frame; checksum of the frames in crc when given. Returns the decoding time.
+static double Decode(const Video &video, uint32_t *crc)
+{
+    unsigned long w, h, frames;
+    double usf;
+    double seconds = 0;
+
+    smk s = smk_open_memory(video.data.data(), (unsigned long)video.data.size());
+    if (!s)
+    {
+        if (crc) printf("%s: can't open\n", video.name.c_str());
+        return 0;
+    }
+
+    smk_info_all(s, NULL, &frames, &usf);
+    smk_info_video(s, &w, &h, NULL);
+    smk_enable_all(s, 0xFF);
+
+    for (unsigned long f = 0; f < frames; f++)
+    {
+        char ret;
+        seconds += TestTime([&] { ret = f ? smk_next(s) : smk_first(s); }, 1);
+
+        if (!crc) continue;
+
+        *crc = TestCrc(*crc, &ret, 1);
+        *crc = TestCrc(*crc, smk_get_video(s), w * h);
+        *crc = TestCrc(*crc, smk_get_palette(s), 768);
+        for (unsigned char track = 0; track < 7; track++)
+        {
+            unsigned long size = smk_get_audio_size(s, track);
+            if (size) *crc = TestCrc(*crc, smk_get_audio(s, track), size);
+        }
+    }
+
+    smk_close(s);
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Video> videos;
+
+    for (int i = 1; i < argc; i++)
+    {
+        LoadFile(argv[i], videos);
+    }
+
+    int fromFiles = (int)videos.size();
+
+    std::mt19937 rnd(1234);
+    for (int n = 0; n < 16; n++)
+    {
+        videos.push_back(MakeVideo(rnd, n));
+    }
+
+    printf("%d video(s) from files, %d synthetic\n", fromFiles, (int)videos.size() - fromFiles);
+
+    // checksums, then whole passes until it has run for a while
+    double bytes = 0, seconds = 0;
+    uint32_t synthetic = 0;
+    int pass = 0;
+    do
+    {
+        for (size_t n = 0; n < videos.size(); n++)
+        {
+            uint32_t crc = 0;
+            bool file = (int)n < fromFiles;
+            seconds += Decode(videos[n], pass ? NULL : file ? &crc : &synthetic);
+            bytes += videos[n].data.size();
+            if (!pass && file) printf("%-24s %08x\n", videos[n].name.c_str(), crc);
+        }
+        pass++;
+    } while (seconds < 1.0);
+
+    printf("%8.1f MB/s (%d passes)\n", bytes / (1024.0 * 1024.0) / seconds, pass);
+    return TestExpect("synthetic", synthetic, SYNTHETIC_CRC);
+}
@@ -0,0 +1,363 @@
+// Streamed video playback check: time to the first frame and memory used,
+// whole block loaded (smk_open_memory, what PlayAcf did) against frames
+// read when they are decoded (smk_open_reader, what PlayAcf does with
+// HQR_Open_Stream).
+//
+//   test_smkstream                          the check: a short and a long
+//                                          video, each mode in its own
+//                                          process (peak RSS of that run)
+//   test_smkstream gen <file.hqr> <frames>  writes a synthetic video in a
+//                                          stored HQR block
+//   test_smkstream load <file.hqr>          decodes it, whole block loaded
+//   test_smkstream stream <file.hqr>        decodes it, frames read on demand
+//
+// The decoding modes print one line: time to the first frame (ms), total
+// time (ms), peak RSS (KB) and a checksum of every decoded frame. Both modes
+// must decode the same frames; streamed, the peak memory must not depend on
+// the length of the video.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "smacker.h"
+#include "test.h"
+
+static void Put32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+//----------------------------------------------------------------------------
+// Synthetic video: random trees and random bits (see test_smacker.cpp), a raw
+// 16 bits stereo audio track
+
+class BitWriter
+{
+public:
+    void Bit(int bit)
+    {
+        if (!(mBits & 7)) mData.push_back(0);
+        if (bit) mData.back() |= 1 << (mBits & 7);
+        mBits++;
+    }
+
+    void Byte(int value)
+    {
+        for (int i = 0; i < 8; i++) Bit((value >> i) & 1);
+    }
+
+    std::vector<unsigned char> &Data() { return mData; }
+
+private:
+    std::vector<unsigned char> mData;
+    size_t mBits = 0;
+};
+
+// full tree of the given depth: 1 = branch, 0 = leaf, prefix order
+static void WriteShape(std::mt19937 &rnd, BitWriter &bw, int depth, bool huff16)
+{
+    bw.Bit(depth > 0);
+    if (depth > 0)
+    {
+        WriteShape(rnd, bw, depth - 1, huff16);
+        WriteShape(rnd, bw, depth - 1, huff16);
+    }
+    else if (!huff16)
+    {
+        bw.Byte(rnd() & 0xFF);
+    }
+    else
+    {
+        // leaf value: a code of the low8 tree then one of the hi8 tree (4 bits each)
+        for (int i = 0; i < 8; i++) bw.Bit(rnd() & 1);
+    }
+}
+
+// huff16 tree: 1, low8 tree, hi8 tree, 3 cache values, the nodes, 0
+static void WriteTree16(std::mt19937 &rnd, BitWriter &bw)
+{
+    bw.Bit(1);
+    for (int i = 0; i < 2; i++)
+    {
+        bw.Bit(1);
+        WriteShape(rnd, bw, 4, false);
+        bw.Bit(0);
+    }
+    for (int i = 0; i < 6; i++) bw.Byte(rnd() & 0xFF);
+    WriteShape(rnd, bw, 6, true);
+    bw.Bit(0);
+}
+
+static std::vector<unsigned char> MakeVideo(uint32_t frames)
+{
+    const uint32_t w = 320, h = 200, audio = 8192;
+    std::mt19937 rnd(1234);
+
+    BitWriter trees;
+    for (int i = 0; i < 4; i++) WriteTree16(rnd, trees);
+    while (trees.Data().size() & 3) trees.Data().push_back(0);
+
+    std::vector<unsigned char> out = {'S', 'M', 'K', '2'};
+    Put32(out, w);
+    Put32(out, h);
+    Put32(out, frames);
+    Put32(out, 66);  // ms per frame
+    Put32(out, 0);   // flags
+    for (int i = 0; i < 7; i++) Put32(out, i ? 0 : audio);
+    Put32(out, (uint32_t)trees.Data().size());
+    for (int i = 0; i < 4; i++) Put32(out, 0);
+    Put32(out, 0x70000000 | 22050);  // raw, 16 bits stereo
+    for (int i = 1; i < 7; i++) Put32(out, 0);
+    Put32(out, 0);
+
+    // every frame: audio chunk (size included), then enough video bits for the whole frame
+    const uint32_t chunkSize = 4 + audio + w * h / 2;
+    for (uint32_t f = 0; f < frames; f++) Put32(out, chunkSize);
+    for (uint32_t f = 0; f < frames; f++) out.push_back(0x02);
+    out.insert(out.end(), trees.Data().begin(), trees.Data().end());
+
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        Put32(out, 4 + audio);
+        for (uint32_t i = 4; i < chunkSize; i++) out.push_back((unsigned char)rnd());
+    }
+    return out;
+}
+
+// one stored block: offsets table, {U32 size, U32 compressed size, S16 method}, data
+static bool WriteHQR(const char *name, const std::vector<unsigned char> &block)
+{
+    std::vector<unsigned char> out;
+    Put32(out, 8);
+    Put32(out, 8);
+    Put32(out, (uint32_t)block.size());
+    Put32(out, (uint32_t)block.size());
+    out.push_back(0);
+    out.push_back(0);
+
+    FILE *f = fopen(name, "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size() &&
+              fwrite(block.data(), 1, block.size(), f) == block.size();
+    fclose(f);
+    return ok;
+}
+
+//----------------------------------------------------------------------------
+// Same as HQR_Open_Stream / HQR_Read_Stream, on a FILE
+
+struct Stream
+{
+    FILE *file;
+    unsigned long offset;
+    unsigned long size;
+};
+
+static bool OpenStream(const char *name, Stream &stream)
+{
+    unsigned char header[10];
+
+    stream.file = fopen(name, "rb");
+    if (!stream.file) return false;
+
+    if (fread(header, 1, 4, stream.file) != 4 || fseek(stream.file, TestGet32(header), SEEK_SET))
+    {
+        return false;
+    }
+    unsigned long offset = TestGet32(header);
+
+    if (fread(header, 1, 10, stream.file) != 10 || header[8] || header[9])
+    {
+        return false;
+    }
+
+    stream.offset = offset + 10;
+    stream.size = TestGet32(header);
+    return true;
+}
+
+static unsigned long ReadStream(void *user, void *buffer, unsigned long size, unsigned long offset)
+{
+    Stream *stream = (Stream *)user;
+
+    if (offset >= stream->size) return 0;
+    if (size > stream->size - offset) size = stream->size - offset;
+
+    if (fseek(stream->file, (long)(stream->offset + offset), SEEK_SET)) return 0;
+    return (unsigned long)fread(buffer, 1, size, stream->file);
+}
+
+//----------------------------------------------------------------------------
+
+static int Decode(const char *mode, const char *name)
+{
+    Stream stream;
+    std::vector<unsigned char> block;
+    smk s = NULL;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (!OpenStream(name, stream))
+    {
+        printf("can't open %s\n", name);
+        return 1;
+    }
+
+    if (!strcmp(mode, "load"))
+    {
+        block.resize(stream.size);
+        if (ReadStream(&stream, block.data(), stream.size, 0) == stream.size)
+        {
+            s = smk_open_memory(block.data(), stream.size);
+        }
+    }
+    else
+    {
+        s = smk_open_reader(ReadStream, &stream, stream.size);
+    }
+
+    if (!s)
+    {
+        printf("%s: can't open the video\n", mode);
+        return 1;
+    }
+
+    unsigned long w, h, frames;
+    smk_info_all(s, NULL, &frames, NULL);
+    smk_info_video(s, &w, &h, NULL);
+    smk_enable_all(s, 0xFF);
+
+    uint32_t crc = 0;
+    double firstMs = 0;
+
+    for (unsigned long f = 0; f < frames; f++)
+    {
+        if ((f ? smk_next(s) : smk_first(s)) < 0)
+        {
+            printf("%s: frame %lu failed\n", mode, f);
+            return 1;
+        }
+        if (!f)
+        {
+            firstMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        crc = TestCrc(crc, smk_get_video(s), w * h);
+        crc = TestCrc(crc, smk_get_audio(s, 0), smk_get_audio_size(s, 0));
+    }
+
+    smk_close(s);
+    fclose(stream.file);
+
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%.2f %.1f %ld %08x\n", firstMs, totalMs, usage.ru_maxrss, crc);
+    return 0;
+}
+
+struct Run
+{
+    double firstMs, totalMs;
+    long rss;
+    unsigned crc;
+};
+
+// test_smkstream <args> in its own process
+static bool Spawn(const char *self, const std::string &args, Run *run)
+{
+    std::string command = std::string(self) + " " + args;
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe) return false;
+
+    bool ok = !run || fscanf(pipe, "%lf %lf %ld %x", &run->firstMs, &run->totalMs, &run->rss, &run->crc) == 4;
+    return pclose(pipe) == 0 && ok;
+}
+
+static int Check(const char *self)
+{
+    static const struct
+    {
+        const char *name;
+        int frames;
+    } videos[] = {{"short", 60}, {"long", 1200}};
+
+    Run runs[2][2];
+    int errors = 0;
+
+    printf("%-14s %12s %12s %12s\n", "", "first (ms)", "total (ms)", "peak (KB)");
+    for (int v = 0; v < 2; v++)
+    {
+        std::string file = std::string(self) + "." + videos[v].name + ".hqr";
+        if (!Spawn(self, "gen " + file + " " + std::to_string(videos[v].frames), NULL))
+        {
+            printf("can't write %s\n", file.c_str());
+            return 1;
+        }
+
+        for (int m = 0; m < 2; m++)
+        {
+            const char *mode = m ? "stream" : "load";
+            if (!Spawn(self, std::string(mode) + " " + file, &runs[v][m]))
+            {
+                printf("%s %s: failed\n", videos[v].name, mode);
+                return 1;
+            }
+            printf("%-6s %-7s %12.2f %12.1f %12ld\n", videos[v].name, mode, runs[v][m].firstMs, runs[v][m].totalMs,
+                   runs[v][m].rss);
+        }
+        remove(file.c_str());
+
+        if (runs[v][0].crc != runs[v][1].crc)
+        {
+            printf("MISMATCH: %s video decoded differently\n", videos[v].name);
+            errors++;
+        }
+    }
+
+    // streamed, the long video may not take more than 1 MB more than the short one
+    if (runs[1][1].rss - runs[0][1].rss > 1024)
+    {
+        printf("FAILED: streamed peak RSS grows with the video length (%ld KB -> %ld KB)\n", runs[0][1].rss,
+               runs[1][1].rss);
+        errors++;
+    }
+
+    return errors ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1)
+    {
+        return Check(argv[0]);
+    }
+
+    if (argc == 4 && !strcmp(argv[1], "gen"))
+    {
+        if (!WriteHQR(argv[2], MakeVideo((uint32_t)atoi(argv[3]))))
+        {
+            printf("can't write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 3 && (!strcmp(argv[1], "load") || !strcmp(argv[1], "stream")))
+    {
+        return Decode(argv[1], argv[2]);
+    }
+
+    printf("usage: test_smkstream gen <file> <frames> | load <file> | stream <file>\n");
+    return 1;
+}
@@ -0,0 +1,208 @@
+// Depth sort check and benchmark for SORT.CPP: the display order of AffScene given by Ida::DepthSort
+// (Ida/src/common/DepthSort.h).
+//
+// Frames are the boxes of ListTri and their before/after relations, built with the relation tests of
+// TreeInsert: interior (isometric) and exterior (camera angles) scenes, with loops, and piles of objects
+// which give long walks.
+// The checksum of the orders of each set was recorded with the old bit matrix walk (BaseSort /
+// BaseFindFirst of the original SORT.CPP), loops included.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "DepthSort.h"
+#include "test.h"
+
+static const int MAX_TRI = 100 + 50 + 3 + 10;  // MAX_OBJETS + MAX_EXTRAS + MAX_DARTS + MAX_FLOWS
+
+struct Box
+{
+    int32_t xmin, ymin, zmin, xmax, ymax, zmax;
+};
+
+struct Frame
+{
+    std::vector<Box> boxes;
+    std::vector<std::vector<int16_t>> preds;  // elements to display before each one, lowest first
+};
+
+static int32_t Max3(int32_t a, int32_t b, int32_t c)
+{
+    return a > b ? (a > c ? a : c) : (b > c ? b : c);
+}
+
+// BaseDistance()
+static int32_t Distance(const Frame &f, int after, int before)
+{
+    const Box &p1 = f.boxes[after];
+    const Box &p2 = f.boxes[before];
+
+    int32_t vb = Max3(p1.xmin - p2.xmax, p1.ymin - p2.ymax, p1.zmin - p2.zmax);
+    int32_t va = Max3(p2.xmin - p1.xmax, p2.ymin - p1.ymax, p2.zmin - p1.zmax);
+    int32_t v = va > vb ? va : vb;
+    return v < 0 ? 0 : v;
+}
+
+// TreeInsert relations
+static int16_t SinTab[4096 + 1024];
+static int16_t *CosTab = SinTab + 1024;
+
+static void MakeTables()
+{
+    for (int a = 0; a < 4096 + 1024; a++)
+    {
+        SinTab[a] = (int16_t)lround(sin(a * 2 * M_PI / 4096) * 16383);
+    }
+}
+
+static int32_t Relation(const Box &n, const Box &pt, bool interior, int beta, int alpha)
+{
+    int32_t dxa = n.xmin - pt.xmax, dya = n.ymin - pt.ymax, dza = n.zmin - pt.zmax;
+    int32_t dxb = pt.xmin - n.xmax, dyb = pt.ymin - n.ymax, dzb = pt.zmin - n.zmax;
+
+    if (interior)
+    {
+        return Max3(dxb, dyb, dzb) - Max3(dxa, dya, dza);
+    }
+
+    dxb -= dxa;
+    dzb -= dza;
+    dyb -= dya;
+    dxb = ((-dxb * SinTab[beta]) >> 14) * CosTab[alpha] >> 14;
+    dzb = ((dzb * CosTab[beta]) >> 14) * CosTab[alpha] >> 14;
+    dyb = (dyb * SinTab[alpha]) >> 14;
+
+    int32_t vb = abs(dxb) > abs(dyb) ? dxb : dyb;
+    if (abs(dzb) > abs(vb)) vb = dzb;
+    return vb;
+}
+
+// count boxes in a scene of size extent, with the relations of TreeInsert
+static Frame MakeFrame(std::mt19937 &rnd, int count, int extent, bool interior, bool pile)
+{
+    Frame f;
+    f.boxes.resize(count);
+    f.preds.resize(count);
+
+    int beta = rnd() % 4096, alpha = 256 + rnd() % 512;
+
+    for (int n = 0; n < count; n++)
+    {
+        Box &b = f.boxes[n];
+        int sx = 100 + rnd() % 600, sy = 200 + rnd() % 1200, sz = 100 + rnd() % 600;
+
+        if (pile)
+        {
+            // objects one behind the other, inserted from the front: the walk goes down the whole pile
+            b.xmin = (count - n) * 700;
+            b.zmin = (count - n) * 700 + (int32_t)(rnd() % 200);
+            b.ymin = 0;
+        }
+        else
+        {
+            b.xmin = (int32_t)(rnd() % extent);
+            b.zmin = (int32_t)(rnd() % extent);
+            b.ymin = (int32_t)(rnd() % 4) * 256;
+        }
+        b.xmax = b.xmin + sx;
+        b.ymax = b.ymin + sy;
+        b.zmax = b.zmin + sz;
+
+        for (int i = 0; i < n; i++)
+        {
+            int32_t vb = Relation(b, f.boxes[i], interior, beta, alpha);
+            if (vb > 0)
+                f.preds[i].push_back((int16_t)n);  // n before i
+            else if (vb < 0)
+                f.preds[n].push_back((int16_t)i);
+        }
+    }
+    return f;
+}
+
+int main()
+{
+    MakeTables();
+
+    struct Set
+    {
+        const char *name;
+        std::vector<Frame> frames;
+        uint32_t crc;
+    };
+    std::vector<Set> sets;
+
+    static const uint32_t crcs[][2] = {{0x21920E0B, 0x0B221FE3},
+                                       {0xFE4C53F7, 0x689D911A},
+                                       {0x6F9C5348, 0xA13A4D65},
+                                       {0xD097D135, 0xA26AB941}};
+
+    std::mt19937 rnd(1234);
+    int c = 0;
+    for (int count : {20, 60, 120, MAX_TRI})
+    {
+        char *name = new char[64];
+        snprintf(name, 64, "exterior %3d", count);
+        sets.push_back({name, {}, crcs[c][0]});
+        for (int n = 0; n < 200; n++) sets.back().frames.push_back(MakeFrame(rnd, count, 12000, false, false));
+
+        name = new char[64];
+        snprintf(name, 64, "interior %3d", count);
+        sets.push_back({name, {}, crcs[c][1]});
+        for (int n = 0; n < 200; n++) sets.back().frames.push_back(MakeFrame(rnd, count, 12000, true, false));
+        c++;
+    }
+    sets.push_back({"pile     163", {}, 0xA74DB658});
+    for (int n = 0; n < 50; n++) sets.back().frames.push_back(MakeFrame(rnd, MAX_TRI, 0, true, true));
+
+    int errors = 0;
+    Ida::DepthSort sort(MAX_TRI);
+    std::vector<int> order;
+
+    printf("frames        count  relations  sort (us)\n");
+
+    for (const Set &set : sets)
+    {
+        double time = 0;
+        long long relations = 0;
+        int elements = 0;
+        uint32_t crc = 0;
+
+        for (const Frame &f : set.frames)
+        {
+            int count = (int)f.boxes.size();
+            elements += count;
+
+            // the relations are loaded outside of the timing, TreeInsert builds them
+            sort.clear();
+            for (int n = 0; n < count; n++) sort.add();
+            for (int n = 0; n < count; n++)
+            {
+                for (int16_t p : f.preds[n]) sort.addBefore(p, n);
+                relations += f.preds[n].size();
+            }
+
+            order.clear();
+            time += TestTime(
+                [&] {
+                    sort.sort([&](int after, int before) { return Distance(f, after, before); },
+                              [&](int i) {
+                                  order.push_back(i);
+                                  return false;
+                              });
+                },
+                1);
+            crc = TestCrc(crc, order.data(), order.size() * sizeof(int));
+        }
+
+        int frames = (int)set.frames.size();
+        printf("%-12s  %5d  %9lld  %9.2f\n", set.name, elements / frames, relations / frames, time * 1e6 / frames);
+        errors += TestExpect(set.name, crc, set.crc);
+    }
+
+    return errors ? 1 : 0;
+}
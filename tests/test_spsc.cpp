@@ -0,0 +1,155 @@
+// SpscRingBuffer stress test: a producer thread pushes stereo float frames in random chunk sizes
+// (like SmackerStream::addNextChunk), a consumer thread pulls random sizes (like the SoLoud mixer).
+// Every frame carries its index in both channels (R = -L): a lost, duplicated, reordered or torn
+// frame breaks the sequence.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+#include "test.h"
+
+static const int CHANNELS = 2;
+
+struct Result
+{
+    unsigned long long frames = 0;
+    unsigned long long errors = 0;
+    unsigned long long underruns = 0;
+    unsigned long long overruns = 0;
+};
+
+static Result Run(size_t capacity, unsigned long long totalFrames, unsigned int seed)
+{
+    Ida::SpscRingBuffer<float> ring(capacity);
+    std::atomic<bool> done{false};
+    unsigned long long producerErrors = 0;
+    Result result;
+
+    // frame indices must stay exact as floats
+    auto value = [](unsigned long long frame) { return (float)(frame % (1 << 23)) + 1.0f; };
+
+    std::thread producer([&] {
+        std::mt19937 rnd(seed);
+        std::vector<float> chunk;
+        unsigned long long frame = 0;
+
+        while (frame < totalFrames)
+        {
+            size_t frames = std::min<unsigned long long>(1 + rnd() % 2048, totalFrames - frame);
+            chunk.resize(frames * CHANNELS);
+            for (size_t i = 0; i < frames; i++)
+            {
+                chunk[i * 2] = value(frame + i);
+                chunk[i * 2 + 1] = -value(frame + i);
+            }
+
+            // a full ring is an overrun: resend what didn't fit, like a producer that can wait would
+            size_t sent = 0;
+            while (sent < chunk.size())
+            {
+                size_t written = ring.write(chunk.data() + sent, chunk.size() - sent);
+                if (written % CHANNELS)
+                {
+                    producerErrors++;
+                }
+                if (sent + written < chunk.size())
+                {
+                    result.overruns++;
+                    std::this_thread::yield();
+                }
+                sent += written;
+            }
+            frame += frames;
+        }
+        done = true;
+    });
+
+    std::thread consumer([&] {
+        std::mt19937 rnd(seed + 1);
+        std::vector<float> out(4096 * CHANNELS);
+        unsigned long long frame = 0;
+
+        for (;;)
+        {
+            bool finished = done;
+            size_t wanted = (1 + rnd() % 4096) * CHANNELS;
+            size_t read = ring.read(out.data(), wanted);
+
+            if (read % CHANNELS)
+            {
+                result.errors++;
+            }
+
+            for (size_t i = 0; i + 1 < read; i += CHANNELS)
+            {
+                if (out[i] != value(frame) || out[i + 1] != -value(frame))
+                {
+                    if (result.errors < 10)
+                    {
+                        printf("  frame %llu: got %f %f\n", frame, out[i], out[i + 1]);
+                    }
+                    result.errors++;
+                }
+                frame++;
+            }
+
+            if (read < wanted)
+            {
+                if (finished && !ring.size())
+                {
+                    break;
+                }
+                result.underruns++;
+                std::this_thread::yield();
+            }
+        }
+        result.frames = frame;
+    });
+
+    producer.join();
+    consumer.join();
+
+    result.errors += producerErrors;
+
+    if (result.frames != totalFrames)
+    {
+        result.errors++;
+    }
+    return result;
+}
+
+int main()
+{
+    struct Case
+    {
+        size_t capacity;
+        unsigned long long frames;
+    } cases[] = {
+        {64, 2000000},      // smaller than a chunk: constant wrap, overruns and underruns
+        {4096, 10000000},   // about the size of a chunk
+        {22050 * CHANNELS * 4, 20000000},  // SmackerStream capacity
+    };
+
+    int failed = 0;
+    for (const Case &c : cases)
+    {
+        Result r;
+        double seconds = TestTime([&] { r = Run(c.capacity, c.frames, (unsigned int)c.capacity); }, 1);
+
+        printf("capacity %7zu: %llu frames, %llu errors, %llu underruns, %llu overruns, %.1f Mframes/s\n", c.capacity,
+               r.frames, r.errors, r.underruns, r.overruns, r.frames / seconds / 1e6);
+
+        if (r.errors)
+        {
+            failed++;
+        }
+    }
+
+    printf(failed ? "FAILED\n" : "OK\n");
+    return failed ? 1 : 0;
+}
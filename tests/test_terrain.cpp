@@ -0,0 +1,434 @@
+// Terrain culling check and benchmark for AffichageTerrainZBuf() of TERRAIN.CPP on Ida::TerrainCull
+// (Ida/src/common/TerrainCull.h): the points of the 65 x 65
+// grid of a cube are rotated and projected, then each quad is drawn or not from the flags of its corners
+// (MaskVisible).
+//
+// Two passes run the same frames:
+//  - full: every point projected, every quad tested, as before
+//  - cull: Ida::TerrainCull rejects the squares first, only the points and quads of the others are done
+// Both record the quads given to DrawFeuillePolyZBuf / FillBlackPolyZBuf with the flags and 2D points of
+// their corners: the lists must be identical. LongWorldRotatePoint and LongProjectPoint are the ones of
+// LIB386/transform3d.cpp, checked against the FPU routines by test_transform3d.cpp.
+//
+// Frames are fixed camera paths (orbit, fly over, ground level, from above, random) on synthetic islands,
+// and with a file argument the terrain frames captured by TERRAIN.CPP (IDA_TRANSFORM_CAPTURE,
+// transform_frames.bin): real heights and cameras, with the 640 x 480 window and ClipZFar of 48000.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "TerrainCull.h"
+#include "test.h"
+#include "transform3d.h"
+
+using Ida::TerrainCull;
+
+static const int SIDE = TerrainCull::SIDE;
+static const int POINTS = TerrainCull::POINTS;
+static const int STEP = TerrainCull::STEP;
+
+struct Frame
+{
+    TerrainCull::View view;
+    int32_t zclip;  // CameraZrClip
+};
+
+struct Island
+{
+    const char *name;
+    std::vector<int16_t> heights;  // MapSommetY
+    std::vector<Frame> frames;
+};
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// The point loop of AffichageTerrainZBuf
+
+struct Point
+{
+    int32_t zrot;
+    int16_t x2d, y2d;
+};
+
+// m: the rotation of the view in a TYPE_MAT, no translation
+static void Project(const Frame &f, const float *m, int x, int y, int z, uint8_t &flag, Point &p)
+{
+    const TerrainCull::View &v = f.view;
+
+    // LongWorldRotatePoint
+    int x0, y0, z0;
+    transform3d_rotate(&x0, &y0, &z0, &x, &y, &z, 1, m);
+
+    int zr = (int)((unsigned)v.camz - (unsigned)z0);
+    if (zr <= v.nearclip)
+    {
+        flag = 32;
+        return;
+    }
+
+    // LongProjectPoint
+    if (zr >= v.zfar || z0 > f.zclip)
+    {
+        flag = 0;
+        return;
+    }
+
+    transform3d_camera cam = {v.ratiox, v.ratioy, v.xcentre, v.ycentre, v.camx, v.camy, v.camz, 0, f.zclip};
+    int xp, yp;
+    unsigned char ok;
+    transform3d_project_long(&xp, &yp, &ok, &x0, &y0, &z0, 1, &cam);
+
+    flag = 16;
+    if (xp < v.clipxmin) flag |= 1;
+    if (xp > v.clipxmax) flag |= 2;
+    if (yp < v.clipymin) flag |= 4;
+    if (yp > v.clipymax) flag |= 8;
+
+    p.zrot = zr;
+    p.x2d = (int16_t)xp;
+    p.y2d = (int16_t)yp;
+}
+
+// MaskVisible
+static int Mask(const uint8_t *a)
+{
+    int all = a[0] & a[POINTS] & a[1] & a[POINTS + 1];
+    int any = a[0] | a[POINTS] | a[1] | a[POINTS + 1];
+    return (all & 0xFF) | ((any & 0x20) << 8);
+}
+
+struct Trace
+{
+    std::vector<int32_t> quads;  // x, z, mask and the 4 corners of each quad drawn
+    long long points = 0, tested = 0;
+
+    void clear()
+    {
+        quads.clear();
+    }
+};
+
+static void Corner(Trace &t, const uint8_t *flags, const Point *pts, int n)
+{
+    t.quads.push_back(flags[n]);
+    if (flags[n] & 16)
+    {
+        t.quads.push_back(pts[n].zrot);
+        t.quads.push_back(pts[n].x2d | (pts[n].y2d << 16));
+    }
+}
+
+static void Quads(const uint8_t *visible, const uint8_t *flags, const Point *pts, Trace &t)
+{
+    for (int z = 0; z < SIDE; z++)
+    {
+        for (int x = 0; x < SIDE; x++)
+        {
+            if (visible && !visible[(z / TerrainCull::LEAF) * TerrainCull::SQUARES + x / TerrainCull::LEAF])
+            {
+                continue;
+            }
+
+            int n = z * POINTS + x;
+            int mask = Mask(&flags[n]);
+            t.tested++;
+
+            // DrawFeuillePolyZBuf or FillBlackPolyZBuf
+            if ((mask & 0xFF) == 16 || ((mask & 0xFF) == 0 && mask))
+            {
+                t.quads.push_back(x);
+                t.quads.push_back(z);
+                t.quads.push_back(mask);
+                for (int c : {n, n + 1, n + POINTS, n + POINTS + 1}) Corner(t, flags, pts, c);
+            }
+        }
+    }
+}
+
+static void Full(const Island &island, const Frame &f, uint8_t *flags, Point *pts, Trace &t)
+{
+    float m[12] = {};
+    memcpy(m, f.view.mat, sizeof(f.view.mat));
+
+    for (int z = 0; z < POINTS; z++)
+    {
+        for (int x = 0; x < POINTS; x++)
+        {
+            int n = z * POINTS + x;
+            Project(f, m, x * STEP, island.heights[n], z * STEP, flags[n], pts[n]);
+        }
+    }
+    t.points += POINTS * POINTS;
+    Quads(nullptr, flags, pts, t);
+}
+
+static void Culled(const Island &island, const TerrainCull &cull, const Frame &f, uint8_t *flags, Point *pts,
+                   Trace &t)
+{
+    uint8_t visible[TerrainCull::SQUARES * TerrainCull::SQUARES];
+    uint8_t needed[POINTS * POINTS];
+
+    float m[12] = {};
+    memcpy(m, f.view.mat, sizeof(f.view.mat));
+
+    cull.cull(f.view, visible);
+    TerrainCull::points(visible, needed);
+
+    for (int z = 0; z < POINTS; z++)
+    {
+        for (int x = 0; x < POINTS; x++)
+        {
+            int n = z * POINTS + x;
+            if (!needed[n])
+            {
+                flags[n] = 0xEE;  // must never be read
+                continue;
+            }
+            Project(f, m, x * STEP, island.heights[n], z * STEP, flags[n], pts[n]);
+            t.points++;
+        }
+    }
+    Quads(visible, flags, pts, t);
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Islands and camera paths
+
+static void MakeCamera(Frame &f, double px, double py, double pz, double yaw, double pitch)
+{
+    // rows: right, up, back (zr = CameraZr - Z0 grows in front of the camera)
+    double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+    double fwd[3] = {sy * cp, sp, cy * cp};
+    double right[3] = {cy, 0, -sy};
+    double up[3] = {fwd[1] * right[2] - fwd[2] * right[1], fwd[2] * right[0] - fwd[0] * right[2],
+                    fwd[0] * right[1] - fwd[1] * right[0]};
+    if (up[1] < 0)
+    {
+        for (double &u : up) u = -u;
+    }
+
+    TerrainCull::View &v = f.view;
+    for (int c = 0; c < 3; c++)
+    {
+        v.mat[c] = (float)right[c];
+        v.mat[3 + c] = (float)up[c];
+        v.mat[6 + c] = (float)-fwd[c];
+    }
+    auto rot = [&](int row) {
+        return (int32_t)lrint(px * v.mat[row * 3] + py * v.mat[row * 3 + 1] + pz * v.mat[row * 3 + 2]);
+    };
+    v.camx = rot(0);
+    v.camy = rot(1);
+    v.camz = rot(2);
+
+    v.ratiox = 600.f;
+    v.ratioy = -1.f;
+    v.xcentre = 320;
+    v.ycentre = 240;
+    v.nearclip = 3000;  // CLIP_NEAR
+    v.zfar = 48000;
+    v.clipxmin = 0;
+    v.clipymin = 0;
+    v.clipxmax = 639;
+    v.clipymax = 479;
+    f.zclip = v.camz - v.nearclip;
+}
+
+static int16_t Height(double v)
+{
+    return (int16_t)std::max(-32000.0, std::min(32000.0, v));
+}
+
+static Island MakeIsland(const char *name, int kind, std::mt19937 &rnd)
+{
+    Island island = {name, std::vector<int16_t>(POINTS * POINTS), {}};
+    double phase[4];
+    for (double &p : phase) p = (rnd() % 1000) / 100.0;
+
+    for (int z = 0; z < POINTS; z++)
+    {
+        for (int x = 0; x < POINTS; x++)
+        {
+            double dx = (x - 32) / 32.0, dz = (z - 32) / 32.0;
+            double r = sqrt(dx * dx + dz * dz);
+            double h = 0;
+            switch (kind)
+            {
+            case 0: // sea
+                break;
+            case 1: // hills around a beach
+                h = (1.2 - r) * 3000 + 1200 * sin(x * 0.2 + phase[0]) * cos(z * 0.17 + phase[1]);
+                if (h < 0) h = 0;
+                break;
+            case 2: // cliffs and plateaus
+                h = ((int)((1.1 - r) * 5) * 1500) + (int)(rnd() % 200);
+                if (h < 0) h = 0;
+                break;
+            case 3: // peaks
+                h = (1.0 - r) * 9000 + 3000 * sin(x * 0.31 + phase[2]) * sin(z * 0.29 + phase[3]);
+                if (h < -500) h = -500;
+                break;
+            }
+            island.heights[z * POINTS + x] = Height(h);
+        }
+    }
+
+    // paths: 120 frames each
+    const double centre = SIDE * STEP / 2.0;
+    const double pi = 3.14159265358979;
+    for (int n = 0; n < 120; n++)
+    {
+        double t = n / 120.0;
+        Frame f;
+
+        // orbit, looking at the centre
+        double a = t * 2 * pi;
+        MakeCamera(f, centre - sin(a) * 30000, 12000, centre - cos(a) * 30000, a, -0.35);
+        island.frames.push_back(f);
+
+        // fly over, turning
+        MakeCamera(f, -8000 + t * 48000, 5000, centre + 6000 * sin(a), pi / 2 + 0.6 * sin(a * 2), -0.2);
+        island.frames.push_back(f);
+
+        // ground level, looking around
+        MakeCamera(f, centre + 3000 * cos(a), 1500, centre + 3000 * sin(a), a * 2, 0.05);
+        island.frames.push_back(f);
+
+        // from above, looking down
+        MakeCamera(f, centre + 10000 * cos(a), 30000, centre, a, -1.2);
+        island.frames.push_back(f);
+
+        // anywhere, any direction, any clip window
+        MakeCamera(f, (int)(rnd() % 100000) - 34000.0, (int)(rnd() % 40000) - 5000.0, (int)(rnd() % 100000) - 34000.0,
+                   (rnd() % 6283) / 1000.0, (rnd() % 3141) / 1000.0 - 1.57);
+        if (rnd() % 2)
+        {
+            f.view.clipxmin = (int)(rnd() % 300);
+            f.view.clipymin = (int)(rnd() % 200);
+            f.view.clipxmax = f.view.clipxmin + (int)(rnd() % 340);
+            f.view.clipymax = f.view.clipymin + (int)(rnd() % 280);
+        }
+        island.frames.push_back(f);
+    }
+    return island;
+}
+
+// frames of TERRAIN.CPP: matrix, FRatioX, FRatioY, XCentre, YCentre, CameraXr, CameraYr, CameraZr,
+// CameraZrClip, then the 65 x 65 points (x, y, z and the results of the ASM)
+static bool ReadFrames(const char *name, Island &island)
+{
+    FILE *file = fopen(name, "rb");
+    if (!file) return false;
+
+    int32_t nb;
+    while (fread(&nb, 4, 1, file) == 1 && nb == POINTS * POINTS)
+    {
+        float mat[12];
+        int32_t camera[6], point[10];
+        Frame f;
+        if (fread(mat, 4, 12, file) != 12 || fread(&f.view.ratiox, 4, 1, file) != 1 ||
+            fread(&f.view.ratioy, 4, 1, file) != 1 || fread(camera, 4, 6, file) != 6)
+            break;
+
+        memcpy(f.view.mat, mat, sizeof(f.view.mat));
+        f.view.xcentre = camera[0];
+        f.view.ycentre = camera[1];
+        f.view.camx = camera[2];
+        f.view.camy = camera[3];
+        f.view.camz = camera[4];
+        f.zclip = camera[5];
+        f.view.nearclip = camera[4] - camera[5];
+        f.view.zfar = 48000;
+        f.view.clipxmin = 0;
+        f.view.clipymin = 0;
+        f.view.clipxmax = 639;
+        f.view.clipymax = 479;
+
+        // one island per file: the heights of the last frame, the cubes around are all in
+        island.heights.resize(POINTS * POINTS);
+        for (int n = 0; n < nb && fread(point, 4, 10, file) == 10; n++)
+        {
+            island.heights[n] = (int16_t)point[1];
+        }
+        island.frames.push_back(f);
+    }
+    fclose(file);
+    return !island.frames.empty();
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+
+struct Result
+{
+    long long errors = 0, quads = 0;
+    Trace full, cull;
+    double fullUs = 0, cullUs = 0;
+};
+
+static Result Run(const Island &island)
+{
+    Result r;
+    TerrainCull cull;
+    cull.build(island.heights.data());
+
+    std::vector<uint8_t> flags(POINTS * POINTS);
+    std::vector<Point> pts(POINTS * POINTS);
+
+    for (const Frame &f : island.frames)
+    {
+        r.full.clear();
+        r.cull.clear();
+        Full(island, f, flags.data(), pts.data(), r.full);
+        Culled(island, cull, f, flags.data(), pts.data(), r.cull);
+        r.errors += r.full.quads != r.cull.quads;
+        r.quads += (long long)r.full.quads.size();
+
+        Trace t;
+        r.fullUs += TestTime([&]() { Full(island, f, flags.data(), pts.data(), t); }, 3) * 1e6;
+        r.cullUs += TestTime([&]() { Culled(island, cull, f, flags.data(), pts.data(), t); }, 3) * 1e6;
+    }
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    std::mt19937 rnd(1234);
+    std::vector<Island> islands;
+
+    islands.push_back(MakeIsland("sea", 0, rnd));
+    islands.push_back(MakeIsland("hills", 1, rnd));
+    islands.push_back(MakeIsland("cliffs", 2, rnd));
+    islands.push_back(MakeIsland("peaks", 3, rnd));
+
+    if (argc > 1)
+    {
+        islands.push_back({argv[1], {}, {}});
+        if (!ReadFrames(argv[1], islands.back()))
+        {
+            printf("can't read %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    long long errors = 0;
+
+    printf("island   frames  points/frame      quads/frame      full (us)  cull (us)  speedup  result\n");
+    printf("                 full    cull    full    cull\n");
+    for (const Island &island : islands)
+    {
+        Result r = Run(island);
+        double nb = (double)island.frames.size();
+        printf("%-8s %6d  %6.0f  %6.0f  %6.0f  %6.0f  %10.2f %10.2f  %7.1f  %s\n", island.name,
+               (int)island.frames.size(), r.full.points / nb, r.cull.points / nb, r.full.tested / nb,
+               r.cull.tested / nb, r.fullUs / nb, r.cullUs / nb, r.fullUs / r.cullUs,
+               r.errors ? "MISMATCH" : "identical");
+        errors += r.errors;
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+// Text fetch check and benchmark for MESSAGE.CPP: FindText() through the TextBank table, and InitDial()
+// reloading a file of TEXT.HQR against the TextBankCache (Ida/src/common/TextBankCache.h).
+//
+// With a TEXT.HQR argument the real banks are used (every language), otherwise synthetic ones of the
+// same shape (15 files per language, a few hundred texts each). The checksum of the number found for
+// every id of the synthetic banks was recorded with the old FindText(), a scan of BufOrder; for a real
+// TEXT.HQR it is printed.
+//
+// The dialog-heavy scene fetches texts of the island bank in a loop (GetText: id -> number, then the
+// two offsets). The island walk goes through the InitDial() pattern of the game: sys, island, gam,
+// island... (menus, inventory, holomap on top of the island).
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TextBankCache.h"
+#include "test_hqr.h"
+
+static const int MAX_TEXT_LANG = 15;  // MESSAGE.CPP
+static const int START_FILE_ISLAND = 3;
+
+// of the synthetic banks, recorded with the scan
+static const uint32_t SYNTHETIC_CRC = 0x9D3EA7CA;
+
+struct Bank
+{
+    std::vector<uint16_t> order;
+    std::vector<uint8_t> text;
+};
+
+static volatile unsigned Sink;
+
+// Load_HQR(): open, read the offset, the header and the block, expand it
+static uint32_t LoadHQR(const char *name, void *dest, int index)
+{
+    FILE *f = fopen(name, "rb");
+    if (!f) return 0;
+
+    unsigned char header[10];
+    uint32_t offset = 0, size = 0;
+
+    if (fseek(f, index * 4, SEEK_SET) == 0 && fread(header, 1, 4, f) == 4 && (offset = TestGet32(header)) &&
+        fseek(f, offset, SEEK_SET) == 0 && fread(header, 1, 10, f) == 10)
+    {
+        size = TestGet32(header);
+        uint32_t compSize = TestGet32(header + 4);
+        int method = TestGet16(header + 8);
+
+        if (method == 0)
+        {
+            if (fread(dest, 1, size, f) != size) size = 0;
+        }
+        else
+        {
+            std::vector<unsigned char> packed(compSize + 4);
+            if (fread(packed.data(), 1, compSize, f) == compSize)
+                ExpandLZ_C(dest, packed.data(), size, method + 1);
+            else
+                size = 0;
+        }
+    }
+    fclose(f);
+    return size;
+}
+
+// order + text blocks of the same shape as TEXT.HQR, stored in a .hqr so the reload cost is real
+static std::string MakeSyntheticHQR(int languages)
+{
+    std::mt19937 rnd(1234);
+    std::vector<std::vector<unsigned char>> blocks;
+
+    for (int lang = 0; lang < languages; lang++)
+    {
+        for (int file = 0; file < MAX_TEXT_LANG; file++)
+        {
+            int count = 100 + rnd() % 400;
+            int firstId = file < START_FILE_ISLAND ? 0 : 100 * (file - START_FILE_ISLAND);
+
+            std::vector<unsigned char> order(count * 2);
+            std::vector<unsigned char> text((count + 1) * 2);
+            for (int n = 0; n < count; n++)
+            {
+                int id = firstId + n * 2 + (int)(rnd() % 2);
+                order[n * 2] = (unsigned char)id;
+                order[n * 2 + 1] = (unsigned char)(id >> 8);
+
+                int offset = (int)text.size();
+                text[n * 2] = (unsigned char)offset;
+                text[n * 2 + 1] = (unsigned char)(offset >> 8);
+
+                text.push_back(1);  // flag
+                int len = 10 + rnd() % 60;
+                for (int c = 0; c < len && text.size() < 39000; c++) text.push_back('a' + rnd() % 26);
+                text.push_back(0);
+            }
+            text[count * 2] = (unsigned char)text.size();
+            text[count * 2 + 1] = (unsigned char)(text.size() >> 8);
+
+            blocks.push_back(order);
+            blocks.push_back(text);
+        }
+    }
+
+    std::vector<unsigned char> file(blocks.size() * 4);
+    for (size_t n = 0; n < blocks.size(); n++)
+    {
+        uint32_t offset = (uint32_t)file.size();
+        memcpy(&file[n * 4], &offset, 4);
+
+        uint32_t size = (uint32_t)blocks[n].size();
+        unsigned char header[10] = {};
+        memcpy(header, &size, 4);
+        memcpy(header + 4, &size, 4);
+        file.insert(file.end(), header, header + 10);
+        file.insert(file.end(), blocks[n].begin(), blocks[n].end());
+    }
+
+    std::string name = "build/text_synthetic.hqr";
+    FILE *f = fopen(name.c_str(), "wb");
+    fwrite(file.data(), 1, file.size(), f);
+    fclose(f);
+    return name;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string hqr = argc > 1 ? argv[1] : MakeSyntheticHQR(6);
+    std::vector<unsigned char> file;
+    if (!TestReadFile(hqr.c_str(), file) || file.size() < 4)
+    {
+        printf("can't read %s\n", hqr.c_str());
+        return 1;
+    }
+
+    int languages = (int)(TestGet32(&file[0]) / 4 / (MAX_TEXT_LANG * 2));
+    printf("%s: %d language(s)\n", hqr.c_str(), languages);
+
+    // BufOrder / BufText of PERSO.CPP
+    std::vector<uint16_t> bufOrder(0x10000);
+    std::vector<uint8_t> bufText(0x20000);
+    int errors = 0;
+
+    // every bank: the number of every id up to the max + 1
+    uint32_t crc = 0;
+    double time = 0;
+    long long fetches = 0;
+    std::mt19937 rnd(42);
+
+    for (int lang = 0; lang < languages; lang++)
+    {
+        for (int f = 0; f < MAX_TEXT_LANG; f++)
+        {
+            int count = LoadHQR(hqr.c_str(), bufOrder.data(), lang * MAX_TEXT_LANG * 2 + f * 2) / 2;
+            uint32_t size = LoadHQR(hqr.c_str(), bufText.data(), lang * MAX_TEXT_LANG * 2 + f * 2 + 1);
+
+            Ida::TextBank bank;
+            bank.assign(lang, f, bufOrder.data(), count, bufText.data(), size);
+
+            for (int id = -1; id <= bank.maxId() + 1; id++)
+            {
+                int num = bank.find(id);
+                crc = TestCrc(crc, &num, sizeof(num));
+            }
+            if (!count) continue;
+
+            // dialog-heavy scene: GetText() on the texts of this bank
+            std::vector<int> script(4096);
+            for (int &id : script) id = bufOrder[rnd() % count];
+
+            unsigned sum = 0;
+            time += TestTime(
+                [&] {
+                    for (int id : script)
+                    {
+                        int num = bank.find(id);
+                        sum += *(uint16_t *)&bufText[(num + 1) * 2] - *(uint16_t *)&bufText[num * 2];
+                    }
+                },
+                1);
+            Sink += sum;
+            fetches += script.size();
+        }
+    }
+
+    if (argc > 1)
+    {
+        printf("%-24s %08x\n", "banks", crc);
+    }
+    else
+    {
+        errors += TestExpect("banks", crc, SYNTHETIC_CRC);
+    }
+    printf("GetText lookup: %7.1f ns\n", time * 1e9 / fetches);
+
+    // island walk: sys, island, gam, island, ... on every island
+    std::vector<int> walk;
+    for (int round = 0; round < 20; round++)
+    {
+        for (int island = START_FILE_ISLAND; island < MAX_TEXT_LANG; island++)
+        {
+            walk.push_back(0);
+            walk.push_back(island);
+            walk.push_back(2);
+            walk.push_back(island);
+        }
+    }
+
+    auto loadTime = [&](bool cached) {
+        Ida::TextBankCache cache(16);
+        auto load = [&] {
+            for (int f : walk)
+            {
+                Ida::TextBank *bank = cached ? cache.find(0, f) : nullptr;
+                if (bank)
+                {
+                    memcpy(bufOrder.data(), bank->order().data(), bank->count() * 2);
+                    memcpy(bufText.data(), bank->text().data(), bank->text().size());
+                }
+                else
+                {
+                    int count = LoadHQR(hqr.c_str(), bufOrder.data(), f * 2) / 2;
+                    uint32_t size = LoadHQR(hqr.c_str(), bufText.data(), f * 2 + 1);
+                    if (cached) cache.insert(0, f, bufOrder.data(), count, bufText.data(), size);
+                }
+            }
+        };
+        return TestTime(load, 1) * 1e6 / walk.size();
+    };
+
+    double reload = loadTime(false);
+    double cached = loadTime(true);
+    printf("InitDial:       reload %7.1f us, cache %7.1f us (x%.1f)\n", reload, cached, reload / cached);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,373 @@
+// Batched 3D transforms (transform3d.cpp, LIB386/3D) and their speed. Checked sets:
+//  - bodies: RotTransList then ProjectList3D on objects of the game size, camera matrices
+//  - terrain: LongRotatePoint then LongProjectPoint3D on the 65 x 65 points of AffichageTerrainZBuf()
+//  - halves: matrices and projections built to fall on half integers, and just around them
+//  - wide: any float, any integer, null and negative depths
+// The checksum of each set was recorded with the FPU routines they replace (64 bits precision,
+// fistp rounding). With a file argument, recorded terrain frames are checked too: the results of
+// the ASM LongWorldRotatePoint / LongProjectPoint are in it (transform_frames.bin).
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "transform3d.h"
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Test sets
+
+struct Batch
+{
+    float mat[12];
+    transform3d_camera cam;
+    std::vector<short> x16, y16, z16;
+    std::vector<int> x32, y32, z32;
+
+    // recorded results of the ASM (captured frames)
+    std::vector<int> rx, ry, rz, proj, ret, xp, yp;
+};
+
+struct Set
+{
+    const char *name;
+    std::vector<Batch> batches;
+    uint32_t crc;   // of the results of the FPU routines
+};
+
+// camera matrix of angles alpha, beta, gamma (4096 = one turn), with translation
+static void MakeMatrix(float *m, std::mt19937 &rnd, float scale, int trans)
+{
+    auto angle = [&]() { return (double)(rnd() % 4096) * 2 * M_PI / 4096; };
+    double a = angle(), b = angle(), c = angle();
+    double ca = cos(a), sa = sin(a), cb = cos(b), sb = sin(b), cc = cos(c), sc = sin(c);
+
+    double r[9] = {cb * cc, -cb * sc, sb, sa * sb * cc + ca * sc, -sa * sb * sc + ca * cc, -sa * cb,
+                   -ca * sb * cc + sa * sc, ca * sb * sc + sa * cc, ca * cb};
+    for (int n = 0; n < 9; n++) m[n] = (float)(r[n] * scale);
+    for (int n = 9; n < 12; n++) m[n] = trans ? (float)((int)(rnd() % (2 * trans)) - trans) : 0.f;
+}
+
+// SetProjection(): FRatioX = LFactorX, FRatioY = -LFactorY / LFactorX
+static void MakeCamera(transform3d_camera &cam, int factorx, int factory, int nearclip)
+{
+    cam.ratiox = (float)factorx;
+    cam.ratioy = (float)(-(long double)factory / factorx);
+    cam.xcentre = 320;
+    cam.ycentre = 240;
+    cam.nearclip = nearclip;
+}
+
+static Set MakeBodies(std::mt19937 &rnd)
+{
+    Set set = {"bodies", {}, 0x197241EB};
+    for (int b = 0; b < 400; b++)
+    {
+        Batch batch;
+        MakeMatrix(batch.mat, rnd, 1.f, 2000);
+        MakeCamera(batch.cam, 600, 600 + (int)(rnd() % 200), 1);
+        batch.cam.x = (int)(rnd() % 2000) - 1000;
+        batch.cam.y = (int)(rnd() % 2000) - 1000;
+        batch.cam.z = 1000 + (int)(rnd() % 12000);
+
+        int size = 100 + (int)(rnd() % 3000), count = 50 + (int)(rnd() % 500);
+        for (int n = 0; n < count; n++)
+        {
+            batch.x16.push_back((short)((int)(rnd() % (2 * size)) - size));
+            batch.y16.push_back((short)(rnd() % (2 * size)));
+            batch.z16.push_back((short)((int)(rnd() % (2 * size)) - size));
+        }
+        set.batches.push_back(batch);
+    }
+    return set;
+}
+
+static Set MakeTerrain(std::mt19937 &rnd)
+{
+    Set set = {"terrain", {}, 0xC4E1E5E4};
+    for (int b = 0; b < 100; b++)
+    {
+        Batch batch;
+        MakeMatrix(batch.mat, rnd, 1.f, 0);
+        MakeCamera(batch.cam, 600, 600, 3000); // CLIP_NEAR
+        batch.cam.x = (int)(rnd() % 40000) - 20000;
+        batch.cam.y = (int)(rnd() % 40000) - 20000;
+        batch.cam.z = 20000 + (int)(rnd() % 40000);
+        batch.cam.zclip = batch.cam.z - batch.cam.nearclip;
+
+        for (int z = 0; z <= 64 * 512; z += 512)
+        {
+            for (int x = 0; x <= 64 * 512; x += 512)
+            {
+                batch.x32.push_back(x);
+                batch.y32.push_back((int)(rnd() % 12000));
+                batch.z32.push_back(z);
+            }
+        }
+        set.batches.push_back(batch);
+    }
+    return set;
+}
+
+// matrices of a few bits (exact halves), and one ulp next to them
+static Set MakeHalves(std::mt19937 &rnd)
+{
+    static const float values[] = {0.f, 0.5f, -0.5f, 0.25f, -0.75f, 1.5f, 0.125f, -1.f, 2.5f, 0.375f};
+    Set set = {"halves", {}, 0xD5260448};
+
+    for (int b = 0; b < 400; b++)
+    {
+        Batch batch;
+        for (int n = 0; n < 12; n++)
+        {
+            float v = values[rnd() % 10] * (n >= 9 ? (float)(rnd() % 64) : 1.f);
+            if (rnd() % 4 == 0) v = nextafterf(v, rnd() % 2 ? 10.f : -10.f);
+            batch.mat[n] = v;
+        }
+
+        // inv = ratiox / z on few bits too
+        MakeCamera(batch.cam, (int)(rnd() % 2048) + 1, (int)(rnd() % 2048) + 1, -8);
+        batch.cam.x = (int)(rnd() % 64) - 32;
+        batch.cam.y = (int)(rnd() % 64) - 32;
+        batch.cam.z = (int)(rnd() % 512);
+        batch.cam.zclip = batch.cam.z + 8;
+
+        for (int n = 0; n < 256; n++)
+        {
+            int z = batch.cam.z - (1 << (rnd() % 10)) * (1 + (int)(rnd() % 3));
+            batch.x16.push_back((short)((int)(rnd() % 4096) - 2048));
+            batch.y16.push_back((short)((int)(rnd() % 4096) - 2048));
+            batch.z16.push_back((short)z);
+            batch.x32.push_back(batch.x16.back() * (int)(1 + rnd() % 4));
+            batch.y32.push_back(batch.y16.back() * (int)(1 + rnd() % 4));
+            batch.z32.push_back(z);
+        }
+        set.batches.push_back(batch);
+    }
+    return set;
+}
+
+static Set MakeWide(std::mt19937 &rnd)
+{
+    Set set = {"wide", {}, 0xEFF75157};
+    for (int b = 0; b < 400; b++)
+    {
+        Batch batch;
+        for (int n = 0; n < 12; n++)
+        {
+            batch.mat[n] = ldexpf((float)((int)(rnd() % 0x1000000) - 0x800000), (int)(rnd() % 40) - 50);
+        }
+        batch.cam.ratiox = ldexpf((float)(rnd() % 0x1000000), (int)(rnd() % 20) - 20);
+        batch.cam.ratioy = ldexpf((float)((int)(rnd() % 0x1000000) - 0x800000), (int)(rnd() % 20) - 23);
+        batch.cam.xcentre = (int)(rnd() % 2000) - 1000;
+        batch.cam.ycentre = (int)(rnd() % 2000) - 1000;
+        batch.cam.x = (int)rnd();
+        batch.cam.y = (int)rnd();
+        batch.cam.z = (int)(rnd() % 200) - 100;
+        batch.cam.nearclip = (int)(rnd() % 20) - 10;
+        batch.cam.zclip = (int)rnd();
+
+        for (int n = 0; n < 256; n++)
+        {
+            batch.x16.push_back((short)rnd());
+            batch.y16.push_back((short)rnd());
+            batch.z16.push_back((short)((int)(rnd() % 200) - 100));
+            int shift = rnd() % 32;
+            batch.x32.push_back((int)rnd() >> shift);
+            batch.y32.push_back((int)rnd() >> shift);
+            batch.z32.push_back(rnd() % 2 ? (int)(rnd() % 200) - 100 : (int)rnd());
+        }
+        set.batches.push_back(batch);
+    }
+    return set;
+}
+
+static bool ReadFrames(const char *name, Set &set)
+{
+    FILE *file = fopen(name, "rb");
+    if (!file) return false;
+
+    int32_t nb;
+    while (fread(&nb, 4, 1, file) == 1 && nb > 0)
+    {
+        Batch batch;
+        int32_t camera[6], point[10];
+        if (fread(batch.mat, 4, 12, file) != 12 || fread(&batch.cam.ratiox, 4, 1, file) != 1 ||
+            fread(&batch.cam.ratioy, 4, 1, file) != 1 || fread(camera, 4, 6, file) != 6)
+            break;
+
+        batch.cam.xcentre = camera[0];
+        batch.cam.ycentre = camera[1];
+        batch.cam.x = camera[2];
+        batch.cam.y = camera[3];
+        batch.cam.z = camera[4];
+        batch.cam.zclip = camera[5];
+        batch.cam.nearclip = 0;
+
+        for (int n = 0; n < nb && fread(point, 4, 10, file) == 10; n++)
+        {
+            batch.x32.push_back(point[0]);
+            batch.y32.push_back(point[1]);
+            batch.z32.push_back(point[2]);
+            batch.rx.push_back(point[3]);
+            batch.ry.push_back(point[4]);
+            batch.rz.push_back(point[5]);
+            batch.proj.push_back(point[6]);
+            batch.ret.push_back(point[7]);
+            batch.xp.push_back(point[8]);
+            batch.yp.push_back(point[9]);
+        }
+        set.batches.push_back(batch);
+    }
+    fclose(file);
+    return true;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+
+// checksum of the results of a set, and the points different from the recorded ones
+static uint32_t Check(const Set &set, long long &points, long long &recorded)
+{
+    uint32_t crc = 0;
+    for (const Batch &b : set.batches)
+    {
+        // 32 bits: rotation, then projection of the rotated points
+        size_t n32 = b.x32.size();
+        if (n32)
+        {
+            std::vector<int> rx(n32), ry(n32), rz(n32), xp(n32), yp(n32);
+            std::vector<unsigned char> ok(n32);
+            transform3d_rotate(rx.data(), ry.data(), rz.data(), b.x32.data(), b.y32.data(), b.z32.data(), (int)n32,
+                               b.mat);
+            transform3d_project_long(xp.data(), yp.data(), ok.data(), rx.data(), ry.data(), rz.data(), (int)n32,
+                                     &b.cam);
+
+            crc = TestCrc(crc, rx.data(), n32 * 4);
+            crc = TestCrc(crc, ry.data(), n32 * 4);
+            crc = TestCrc(crc, rz.data(), n32 * 4);
+            crc = TestCrc(crc, ok.data(), n32);
+            crc = TestCrc(crc, xp.data(), n32 * 4);
+            crc = TestCrc(crc, yp.data(), n32 * 4);
+
+            // recorded: the library must give what the ASM gave
+            for (size_t n = 0; n < n32 && !b.rx.empty(); n++)
+            {
+                recorded += rx[n] != b.rx[n] || ry[n] != b.ry[n] || rz[n] != b.rz[n] ||
+                            (b.proj[n] && (ok[n] != b.ret[n] || xp[n] != b.xp[n] || yp[n] != b.yp[n]));
+            }
+            points += n32;
+        }
+
+        // 16 bits: RotTransList, then ProjectList3D of its results
+        size_t n16 = b.x16.size();
+        if (n16)
+        {
+            std::vector<short> rx(n16), ry(n16), rz(n16);
+            std::vector<int> dst(n16);
+            int bbox[4] = {INT_MAX, INT_MIN, INT_MAX, INT_MIN};
+            transform3d_rottrans(rx.data(), ry.data(), rz.data(), b.x16.data(), b.y16.data(), b.z16.data(), (int)n16,
+                                 b.mat);
+            transform3d_project(dst.data(), rx.data(), ry.data(), rz.data(), (int)n16, &b.cam, bbox);
+
+            crc = TestCrc(crc, rx.data(), n16 * 2);
+            crc = TestCrc(crc, ry.data(), n16 * 2);
+            crc = TestCrc(crc, rz.data(), n16 * 2);
+            crc = TestCrc(crc, dst.data(), n16 * 4);
+            crc = TestCrc(crc, bbox, sizeof(bbox));
+            points += n16;
+        }
+    }
+    return crc;
+}
+
+/*──────────────────────────────────────────────────────────────────────────*/
+// Timings: microseconds per batch
+
+static volatile int Sink;
+
+static void Bench(const Set &bodies, const Set &terrain)
+{
+    // bodies: RotTransList + ProjectList3D
+    double time = 0;
+    int batches = 0;
+    for (size_t b = 0; b < bodies.batches.size(); b += 8, batches++)
+    {
+        const Batch &batch = bodies.batches[b];
+        int n = (int)batch.x16.size();
+        std::vector<short> rx(n), ry(n), rz(n);
+        std::vector<int> dst(n);
+        int bbox[4] = {INT_MAX, INT_MIN, INT_MAX, INT_MIN};
+
+        time += TestTime(
+            [&]() {
+                transform3d_rottrans(rx.data(), ry.data(), rz.data(), batch.x16.data(), batch.y16.data(),
+                                     batch.z16.data(), n, batch.mat);
+                transform3d_project(dst.data(), rx.data(), ry.data(), rz.data(), n, &batch.cam, bbox);
+                Sink = dst[n - 1];
+            },
+            200);
+    }
+    printf("bodies  (RotTransList + ProjectList3D)        %8.2f us\n", time * 1e6 / batches);
+
+    // terrain: LongRotatePoint + LongProjectPoint3D
+    time = 0;
+    batches = 0;
+    for (size_t b = 0; b < terrain.batches.size(); b += 4, batches++)
+    {
+        const Batch &batch = terrain.batches[b];
+        int n = (int)batch.x32.size();
+        std::vector<int> rx(n), ry(n), rz(n), xp(n), yp(n);
+        std::vector<unsigned char> ok(n);
+
+        time += TestTime(
+            [&]() {
+                transform3d_rotate(rx.data(), ry.data(), rz.data(), batch.x32.data(), batch.y32.data(),
+                                   batch.z32.data(), n, batch.mat);
+                transform3d_project_long(xp.data(), yp.data(), ok.data(), rx.data(), ry.data(), rz.data(), n,
+                                         &batch.cam);
+                Sink = xp[n - 1];
+            },
+            50);
+    }
+    printf("terrain (LongRotatePoint + LongProjectPoint)  %8.2f us\n", time * 1e6 / batches);
+}
+
+int main(int argc, char *argv[])
+{
+    std::mt19937 rnd(1234);
+    std::vector<Set> sets;
+
+    sets.push_back(MakeBodies(rnd));
+    sets.push_back(MakeTerrain(rnd));
+    sets.push_back(MakeHalves(rnd));
+    sets.push_back(MakeWide(rnd));
+
+    Set frames = {argc > 1 ? argv[1] : nullptr, {}, 0};
+    if (argc > 1 && !ReadFrames(argv[1], frames))
+    {
+        printf("can't read %s\n", argv[1]);
+        return 1;
+    }
+
+    int errors = 0;
+    for (const Set &set : sets)
+    {
+        long long points = 0, recorded = 0;
+        errors += TestExpect(set.name, Check(set, points, recorded), set.crc);
+    }
+    if (frames.name)
+    {
+        long long points = 0, recorded = 0;
+        Check(frames, points, recorded);
+        printf("%s: %lld points, %lld different from the ASM\n", frames.name, points, recorded);
+        errors += recorded != 0;
+    }
+
+    Bench(sets[0], sets[1]);
+
+    return errors ? 1 : 0;
+}
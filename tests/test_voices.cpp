@@ -0,0 +1,310 @@
+// VoicePool check and benchmark: the sample voice bookkeeping of SAMPLE.CPP on Ida::VoicePool
+// (Ida/src/common/VoicePool.h) with hundreds of sounds playing at once, headless.
+//
+// A mixer thread stands for SoLoud: it holds its lock while mixing a block, ends the one shot voices
+// whose length is over and reports them like the ~SampleWaveInstance() does. The game thread plays,
+// looks up by user number (IsSamplePlaying, StopOneSample) and stops sounds each frame.
+//
+// The pool keeps a free stack, a user index and the finished reports, and steals by class and age.
+// The mixer counts a play on a voice it is still mixing as an error (a voice given away too early),
+// and every voice the pool has in use must still be mixed.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "VoicePool.h"
+
+static const int NB_CLASSES = 3;  // one shot, repeat, loop (SAMPLE.CPP steal order)
+
+class Mixer
+{
+public:
+    explicit Mixer(int voices) : mSlots(voices) {}
+
+    void attach(Ida::VoicePool *pool)
+    {
+        mPool = pool;
+    }
+
+    void start()
+    {
+        mRun = true;
+        mThread = std::thread([this] {
+            while (mRun)
+            {
+                mix();
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        });
+    }
+
+    void end()
+    {
+        mRun = false;
+        mThread.join();
+    }
+
+    void play(int voice, uint32_t serial, int blocks, bool loop)
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        Slot &s = mSlots[voice];
+        if (s.active)
+        {
+            mErrors++;
+        }
+        s = {true, loop, blocks, serial};
+    }
+
+    void stop(int voice)
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        kill(voice);
+    }
+
+    bool isValid(int voice, uint32_t serial)
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mSlots[voice].active && mSlots[voice].serial == serial;
+    }
+
+    int playing()
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        int count = 0;
+        for (const Slot &s : mSlots) count += s.active;
+        return count;
+    }
+
+    int errors() const
+    {
+        return mErrors;
+    }
+
+private:
+    struct Slot
+    {
+        bool active = false;
+        bool loop = false;
+        int blocks = 0;
+        uint32_t serial = 0;
+    };
+
+    void kill(int voice)
+    {
+        Slot &s = mSlots[voice];
+        if (!s.active) return;
+        s.active = false;
+        if (mPool) mPool->finished(voice, s.serial);  // instance destructor
+    }
+
+    void mix()
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (int voice = 0; voice < (int)mSlots.size(); voice++)
+        {
+            Slot &s = mSlots[voice];
+            if (s.active && !s.loop && --s.blocks <= 0)
+            {
+                kill(voice);
+            }
+        }
+    }
+
+    std::vector<Slot> mSlots;
+    Ida::VoicePool *mPool = nullptr;
+    std::mutex mLock;
+    std::thread mThread;
+    std::atomic<bool> mRun{false};
+    int mErrors = 0;
+};
+
+// SAMPLE.CPP
+class PoolManager
+{
+public:
+    PoolManager(Mixer &mixer, int voices) : mMixer(mixer), mPool(voices, NB_CLASSES)
+    {
+        mixer.attach(&mPool);
+    }
+
+    int play(uint32_t user, int klass, int blocks)
+    {
+        mPool.collect([](int) {});
+
+        int hnum = mPool.allocate(user, klass);
+        if (hnum == Ida::VoicePool::None)
+        {
+            hnum = mPool.victim();
+            mMixer.stop(hnum);
+            mPool.release(hnum);
+            hnum = mPool.allocate(user, klass);
+            mSteals++;
+        }
+
+        mMixer.play(hnum, mPool.serial(hnum), blocks, klass == 2);
+        return hnum;
+    }
+
+    // GetHandleIndice: no collect(), a voice ended but not collected yet fails isValid()
+    int find(uint32_t user)
+    {
+        int hnum = mPool.findUser(user);
+        return hnum != Ida::VoicePool::None && mMixer.isValid(hnum, mPool.serial(hnum)) ? hnum : -1;
+    }
+
+    void stop(int hnum)
+    {
+        mMixer.stop(hnum);
+        mPool.release(hnum);
+    }
+
+    int steals() const
+    {
+        return mSteals;
+    }
+
+    // every voice in use is still mixed
+    int check()
+    {
+        mPool.collect([](int) {});
+
+        int errors = 0;
+        mPool.forEach([&](int hnum) {
+            if (!mMixer.isValid(hnum, mPool.serial(hnum))) errors++;
+        });
+        return errors;
+    }
+
+private:
+    Mixer &mMixer;
+    Ida::VoicePool mPool;
+    int mSteals = 0;
+};
+
+struct Result
+{
+    double playUs = 0;
+    double findUs = 0;
+    double concurrent = 0;
+    int steals = 0;
+    int errors = 0;
+};
+
+static const int FRAMES = 1500;
+static const int PLAYS_PER_FRAME = 3;
+static const int FINDS_PER_FRAME = 16;
+static const int USERS = 600;
+
+static Result Run(int voices, unsigned seed)
+{
+    Mixer mixer(voices);
+    PoolManager manager(mixer, voices);
+    std::mt19937 rnd(seed);
+    Result result;
+    double playTime = 0, findTime = 0;
+    long long plays = 0, finds = 0, concurrent = 0;
+
+    mixer.start();
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int n = 0; n < PLAYS_PER_FRAME; n++)
+        {
+            int r = rnd() % 100;
+            int klass = r < 85 ? 0 : r < 95 ? 1 : 2;
+            manager.play(rnd() % USERS, klass, 50 + rnd() % 400);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int n = 0; n < FINDS_PER_FRAME; n++)
+        {
+            int hnum = manager.find(rnd() % USERS);
+            if (hnum >= 0 && rnd() % 8 == 0)
+            {
+                manager.stop(hnum);  // StopOneSample (the only way out of a loop)
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        playTime += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        findTime += std::chrono::duration<double, std::micro>(t2 - t1).count();
+        plays += PLAYS_PER_FRAME;
+        finds += FINDS_PER_FRAME;
+        concurrent += mixer.playing();
+
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    mixer.end();
+
+    result.playUs = playTime / plays;
+    result.findUs = findTime / finds;
+    result.concurrent = (double)concurrent / FRAMES;
+    result.steals = manager.steals();
+    result.errors = mixer.errors() + manager.check();
+    return result;
+}
+
+// single thread checks of the pool rules
+static int CheckPool()
+{
+    int errors = 0;
+    Ida::VoicePool pool(4, NB_CLASSES);
+
+    int a = pool.allocate(7, 2);  // loop
+    int b = pool.allocate(7, 0);  // one shot
+    int c = pool.allocate(9, 1);  // repeat
+    int d = pool.allocate(7, 0);  // one shot, newer
+    errors += pool.allocate(1, 0) != Ida::VoicePool::None;
+    errors += pool.used() != 4;
+
+    errors += pool.findUser(7) != d;   // newest of the user
+    errors += pool.victim() != b;      // oldest one shot
+    pool.release(b);
+    errors += pool.victim() != d;
+    pool.release(d);
+    errors += pool.victim() != c;      // then repeats
+    errors += pool.findUser(7) != a;
+    pool.release(c);
+    errors += pool.victim() != a;      // then loops
+    errors += pool.findUser(9) != Ida::VoicePool::None;
+
+    // late report of a voice reused since: ignored
+    uint32_t old = pool.serial(a);
+    pool.release(a);
+    int e = pool.allocate(3, 0);
+    pool.finished(e, old);
+    errors += pool.collect([](int) {}) != 0;
+    errors += !pool.inUse(e);
+
+    pool.finished(e, pool.serial(e));
+    errors += pool.collect([](int) {}) != 1;
+    errors += pool.used() != 0;
+
+    return errors;
+}
+
+int main()
+{
+    int errors = CheckPool();
+    printf("pool rules: %s\n", errors ? "FAILED" : "ok");
+
+    printf("%d frames, %d plays and %d user lookups per frame, %d user numbers\n\n", FRAMES, PLAYS_PER_FRAME,
+           FINDS_PER_FRAME, USERS);
+    printf("voices  playing  steals  play (us)  lookup (us)  errors\n");
+
+    for (int voices : {12, 32, 128, 256})
+    {
+        Result pool = Run(voices, 1234);
+
+        printf("%6d  %7.1f  %6d  %9.3f  %11.3f  %6d\n", voices, pool.concurrent, pool.steals, pool.playUs, pool.findUs,
+               pool.errors);
+        errors += pool.errors;
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+// Zone index check and benchmark for CheckZoneSce() of OBJECT.CPP: every object of a cube tests its
+// position against the zones of the scene each frame.
+//
+// Two passes run the same frames on the same zones:
+//  - scan:  every one of the NbZones zones of ListZone, the reference
+//  - index: ObjectGrid over the XZ boxes (change cube zones with the prefetch margin), the camera zones
+//           always candidates for the object followed by the camera
+// Both record what CheckZoneSce does (prefetch, change cube and its early return, camera zones activated
+// and released, scenaric zone, other zones entered), the traces must be identical. The frame cost must
+// stay flat when the number of zones grows to MAX_ZONES and beyond.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ObjectGrid.h"
+#include "test.h"
+
+static const int SIZE_BRICK_XZ = 512;
+static const int SIZE_BRICK_Y = 256;
+static const int CUBE_SIZE = 64 * SIZE_BRICK_XZ;
+static const int MAX_ZONES = 255;
+static const int PREFETCH_ZONE_MARGIN = 4 * SIZE_BRICK_XZ;
+
+static const int ZONE_ON = 2;  // COMMON.H
+static const int ZONE_ACTIVE = 4;
+
+static const int NUM_PERSO = 0;
+static const int NUM_FOLLOW = 0;  // NumObjFollow
+static const int NB_OBJETS = 50;
+static const int FRAMES = 400;
+
+struct Zone  // the part of T_ZONE used here
+{
+    int32_t x0, y0, z0, x1, y1, z1;
+    int32_t info7;
+    int16_t type, num;
+};
+
+struct Object
+{
+    int32_t x, y, z;
+    int32_t dx, dz;
+};
+
+// FNV-1a of the events
+struct Trace
+{
+    uint64_t hash = 14695981039346656037ull;
+    long long events = 0;
+
+    void add(int kind, int a, int b)
+    {
+        for (int v : {kind, a, b})
+        {
+            hash = (hash ^ (uint32_t)v) * 1099511628211ull;
+        }
+        events++;
+    }
+};
+
+static bool Inside(const Zone &z, int x, int y, int zz)
+{
+    return x >= z.x0 && x < z.x1 && y >= z.y0 && y <= z.y1 && zz >= z.z0 && zz < z.z1;
+}
+
+static bool InsidePrefetch(const Zone &z, int x, int y, int zz)
+{
+    const int m = PREFETCH_ZONE_MARGIN;
+    return x >= z.x0 - m && x < z.x1 + m && y >= z.y0 - m && y <= z.y1 + m && zz >= z.z0 - m && zz < z.z1 + m;
+}
+
+// the body of the CheckZoneSce() loop for one zone, false for the early return
+static bool TestZone(std::vector<Zone> &zones, int n, int numobj, int x, int y, int z, bool &foundcamera,
+                     Trace &trace)
+{
+    Zone &ptrz = zones[n];
+
+    if (ptrz.type == -1) return true;  // ZoneTypes::Disabled
+
+    if (ptrz.type == 0 && numobj == NUM_PERSO && (ptrz.info7 & ZONE_ON) && InsidePrefetch(ptrz, x, y, z))
+    {
+        trace.add(1, numobj, n);  // PrefetchScene
+    }
+
+    if (Inside(ptrz, x, y, z))
+    {
+        switch (ptrz.type)
+        {
+        case 0:
+            if (numobj == NUM_PERSO && (ptrz.info7 & ZONE_ON))
+            {
+                trace.add(2, numobj, n);  // GereZoneChangeCube
+                return false;
+            }
+            break;
+
+        case 1:
+            if (!foundcamera && numobj == NUM_FOLLOW && (ptrz.info7 & ZONE_ON))
+            {
+                if (!(ptrz.info7 & ZONE_ACTIVE)) trace.add(3, numobj, n);  // SetZoneCamera
+                ptrz.info7 |= ZONE_ACTIVE;
+                foundcamera = true;
+            }
+            break;
+
+        case 2:
+            trace.add(4, numobj, ptrz.num);  // ZoneSce
+            break;
+
+        default:
+            trace.add(5, numobj, n);
+            break;
+        }
+    }
+    else if (ptrz.type == 1 && numobj == NUM_FOLLOW)
+    {
+        if (ptrz.info7 & ZONE_ACTIVE) trace.add(6, numobj, n);  // camera zone left
+        ptrz.info7 &= ~ZONE_ACTIVE;
+    }
+    return true;
+}
+
+class ZoneIndex
+{
+public:
+    void build(const std::vector<Zone> &zones)
+    {
+        int count = (int)zones.size();
+        if (mGrid.capacity() < count)
+        {
+            mGrid.reset(count > MAX_ZONES ? count : MAX_ZONES);
+            mList.resize(mGrid.capacity());
+        }
+        else
+        {
+            mGrid.clear();
+        }
+
+        mCameras.clear();
+        for (int n = 0; n < count; n++)
+        {
+            const Zone &z = zones[n];
+            if (z.type == -1) continue;
+            if (z.type == 1) mCameras.push_back((int16_t)n);
+
+            int margin = z.type == 0 ? PREFETCH_ZONE_MARGIN : 0;
+            mGrid.insert(n, std::min(z.x0, z.x1) - margin, std::min(z.z0, z.z1) - margin,
+                         std::max(z.x0, z.x1) + margin, std::max(z.z0, z.z1) + margin);
+        }
+    }
+
+    int query(int x, int z, bool cameras, const int16_t **list)
+    {
+        *list = mList.data();
+        return mGrid.query(x, z, x, z, mList.data(), mCameras.data(), cameras ? (int)mCameras.size() : 0);
+    }
+
+private:
+    Ida::ObjectGrid mGrid;
+    std::vector<int16_t> mCameras;
+    std::vector<int16_t> mList;
+};
+
+// zones of a cube: mostly small scenaric, message, bonus and ladder zones, some cameras covering a room,
+// a few change cube zones on the borders, some disabled and some upside down
+static std::vector<Zone> MakeZones(int count, unsigned seed)
+{
+    std::mt19937 rnd(seed);
+    std::vector<Zone> zones(count);
+
+    for (int n = 0; n < count; n++)
+    {
+        Zone &z = zones[n];
+        int r = rnd() % 100;
+        int size = r < 10 ? 8 + rnd() % 8 : 1 + rnd() % 4;  // cameras are larger
+        int sx = size * SIZE_BRICK_XZ, sz = (1 + rnd() % 4) * SIZE_BRICK_XZ;
+
+        z.type = r < 10 ? 1 : r < 15 ? 0 : r < 45 ? 2 : r < 60 ? 4 : r < 75 ? 5 : r < 85 ? 6 : r < 95 ? 8 : -1;
+        z.x0 = (int32_t)(rnd() % (CUBE_SIZE - sx));
+        z.z0 = (int32_t)(rnd() % (CUBE_SIZE - sz));
+        z.y0 = (int32_t)(rnd() % 8) * SIZE_BRICK_Y;
+        z.x1 = z.x0 + sx;
+        z.z1 = z.z0 + sz;
+        z.y1 = z.y0 + (2 + rnd() % 8) * SIZE_BRICK_Y;
+        if (z.type == 1)
+        {
+            z.y0 = 0;  // a whole room
+            z.y1 = 25 * SIZE_BRICK_Y;
+        }
+        z.info7 = rnd() % 8 ? ZONE_ON : 0;
+        z.num = (int16_t)n;
+
+        if (rnd() % 50 == 0) std::swap(z.x0, z.x1);
+    }
+    return zones;
+}
+
+struct Result
+{
+    uint64_t hash;
+    long long events;
+    double frameUs;
+};
+
+template <bool Indexed>
+static Result Run(int count)
+{
+    std::vector<Zone> zones = MakeZones(count, 1234 + count);
+    std::vector<Object> objects(NB_OBJETS);
+    std::mt19937 rnd(42);
+    for (Object &o : objects)
+    {
+        o = {(int32_t)(rnd() % CUBE_SIZE), (int32_t)(rnd() % (8 * SIZE_BRICK_Y)), (int32_t)(rnd() % CUBE_SIZE),
+             (int32_t)(rnd() % 129) - 64, (int32_t)(rnd() % 129) - 64};
+    }
+
+    ZoneIndex index;
+    if (Indexed) index.build(zones);  // scene load
+
+    Trace trace;
+    double seconds = TestTime([&] {
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            for (int numobj = 0; numobj < NB_OBJETS; numobj++)
+            {
+                Object &o = objects[numobj];
+                if (numobj == NUM_PERSO && frame % 16 == 0)
+                {
+                    o.x = (int32_t)(rnd() % CUBE_SIZE);  // the hero walks everywhere
+                    o.z = (int32_t)(rnd() % CUBE_SIZE);
+                }
+                o.x = (o.x + o.dx + CUBE_SIZE) % CUBE_SIZE;
+                o.z = (o.z + o.dz + CUBE_SIZE) % CUBE_SIZE;
+
+                bool foundcamera = false;
+                if (Indexed)
+                {
+                    const int16_t *list;
+                    int nb = index.query(o.x, o.z, numobj == NUM_FOLLOW, &list);
+                    for (int c = 0; c < nb; c++)
+                    {
+                        if (!TestZone(zones, list[c], numobj, o.x, o.y, o.z, foundcamera, trace)) break;
+                    }
+                }
+                else
+                {
+                    for (int n = 0; n < count; n++)
+                    {
+                        if (!TestZone(zones, n, numobj, o.x, o.y, o.z, foundcamera, trace)) break;
+                    }
+                }
+            }
+        }
+    }, 1);
+
+    return {trace.hash, trace.events, seconds * 1e6 / FRAMES};
+}
+
+int main()
+{
+    int errors = 0;
+
+    printf("%d objects, %d frames\n\n", NB_OBJETS, FRAMES);
+    printf(" zones  events   scan (us/frame)  index (us/frame)  speedup  result\n");
+
+    for (int count : {16, 64, 128, MAX_ZONES, 512, 1024, 4096})
+    {
+        Result scan = Run<false>(count);
+        Result index = Run<true>(count);
+        bool same = scan.hash == index.hash && scan.events == index.events;
+
+        printf("%6d  %6lld  %16.2f  %16.2f  %7.1f  %s\n", count, scan.events, scan.frameUs, index.frameUs,
+               scan.frameUs / index.frameUs, same ? "identical" : "MISMATCH");
+        errors += !same;
+    }
+
+    return errors ? 1 : 0;
+}